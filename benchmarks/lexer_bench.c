@@ -0,0 +1,168 @@
+/*
+ * Lexer throughput benchmark.
+ *
+ * Generates an identifier-heavy CX program (declarations, assignments,
+ * while loops and prints over a few hundred distinct names, roughly one
+ * keyword for every four identifiers) and times tokenize() on it: the flex
+ * scanner reading the buffer in place, keyword lookup through the perfect
+ * hash, identifier interning and the token buffer. The same input is then
+ * scanned by a second build of the scanner that recognizes keywords with
+ * the old strcmp chain (see LEXER_STRCMP in the Makefile). Prints tokens/sec
+ * and MB/sec for both, best of several rounds, and the speedup.
+ *
+ * Usage: lexer_bench [statement count]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../components/tokens.h"
+#include "../components/source.h"
+#include "../components/interner.h"
+
+#define DEFAULT_STATEMENTS 1000000
+#define ROUNDS 5
+
+// Identifier stems; several start like a keyword so the {ID} rule and the
+// hash see near misses as well as hits
+static const char *const stems[] = {
+    "x", "y", "count", "index", "total", "value", "result", "temp",
+    "numbers", "logger", "string", "iffy", "elsewhere", "whilst",
+    "format", "done", "function", "caller", "printer", "truth", "falsey"
+};
+
+#define STEM_COUNT ((int)(sizeof(stems) / sizeof(stems[0])))
+
+static double secondsNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static unsigned int nextRandom(unsigned int *seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 16;
+}
+
+/**
+ * @brief Writes one of the generated names, e.g. "total_17".
+ */
+static size_t writeName(char *out, unsigned int *seed) {
+    unsigned int pick = nextRandom(seed);
+    return (size_t)sprintf(out, "%s_%u", stems[pick % STEM_COUNT], pick % 16);
+}
+
+/**
+ * @brief Builds a program of the given number of statements into a padded
+ *        source buffer.
+ */
+static void buildProgram(SourceBuffer *source, long statements) {
+    size_t capacity = (size_t)statements * 96 + SOURCE_PADDING;
+    char *text = malloc(capacity);
+    if (!text) {
+        printf("Error: Could not allocate %zu bytes of source\n", capacity);
+        exit(1);
+    }
+    unsigned int seed = 42;
+    size_t length = 0;
+    for (long i = 0; i < statements; i++) {
+        char *out = text + length;
+        char *start = out;
+        switch (nextRandom(&seed) % 4) {
+            case 0:
+                out += sprintf(out, "num ");
+                out += writeName(out, &seed);
+                out += sprintf(out, " = ");
+                out += writeName(out, &seed);
+                out += sprintf(out, " + 1;\n");
+                break;
+            case 1:
+                out += writeName(out, &seed);
+                out += sprintf(out, " = ");
+                out += writeName(out, &seed);
+                out += sprintf(out, " * ");
+                out += writeName(out, &seed);
+                out += sprintf(out, " - ");
+                out += writeName(out, &seed);
+                out += sprintf(out, ";\n");
+                break;
+            case 2:
+                out += sprintf(out, "while (");
+                out += writeName(out, &seed);
+                out += sprintf(out, " < ");
+                out += writeName(out, &seed);
+                out += sprintf(out, ") { ");
+                out += writeName(out, &seed);
+                out += sprintf(out, " = ");
+                out += writeName(out, &seed);
+                out += sprintf(out, "; }\n");
+                break;
+            default:
+                out += sprintf(out, "print ");
+                out += writeName(out, &seed);
+                out += sprintf(out, ";\n");
+                break;
+        }
+        length += (size_t)(out - start);
+    }
+    memset(text + length, 0, SOURCE_PADDING);
+    source->data = text;
+    source->length = length;
+    source->mapSize = 0;
+    source->mapped = 0;
+}
+
+// The baseline scanner, linked in from benchmarks/lexer_strcmp.o
+void tokenizeStrcmp(SourceBuffer *source);
+void freeTokensStrcmp();
+extern int tokenCountStrcmp;
+
+/**
+ * @brief Returns the best time of several rounds of one scanner over source.
+ *        count receives the tokens scanned, END sentinel excluded.
+ */
+static double timeScanner(SourceBuffer *source, void (*scan)(SourceBuffer *), void (*release)(),
+                          const int *tokenTotal, int *count) {
+    double best = 1e30;
+    for (int round = 0; round < ROUNDS; round++) {
+        double start = secondsNow();
+        scan(source);
+        double elapsed = secondsNow() - start;
+        if (elapsed < best) best = elapsed;
+        *count = *tokenTotal - 1;
+        release();
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    long statements = argc > 1 ? atol(argv[1]) : DEFAULT_STATEMENTS;
+    if (statements <= 0) {
+        printf("Usage: %s [statement count]\n", argv[0]);
+        return 1;
+    }
+
+    SourceBuffer source;
+    buildProgram(&source, statements);
+
+    int scanned = 0, scannedStrcmp = 0;
+    double best = timeScanner(&source, tokenize, freeTokens, &tokenCount, &scanned);
+    double bestStrcmp = timeScanner(&source, tokenizeStrcmp, freeTokensStrcmp, &tokenCountStrcmp, &scannedStrcmp);
+
+    if (scanned != scannedStrcmp) {
+        printf("Error: scanners disagree (%d vs %d tokens)\n", scanned, scannedStrcmp);
+        return 1;
+    }
+
+    printf("Lexing %ld identifier-heavy statements, %.1f MB, %d tokens (best of %d):\n",
+           statements, source.length / 1e6, scanned, ROUNDS);
+    printf("  perfect hash:  %7.2f Mtokens/sec, %7.2f MB/sec\n",
+           scanned / best / 1e6, source.length / best / 1e6);
+    printf("  strcmp chain:  %7.2f Mtokens/sec, %7.2f MB/sec\n",
+           scannedStrcmp / bestStrcmp / 1e6, source.length / bestStrcmp / 1e6);
+    printf("  speedup:       %7.2fx\n", bestStrcmp / best);
+
+    freeSource(&source);
+    freeInterner();
+    return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * Expression parser throughput benchmark.
+ *
+ * Tokenizes three generated expressions and times parseExpression() on each:
+ * a flat chain of N terms mixing every arithmetic operator, a chain mixing
+ * relational and logical operators, and a single term wrapped in N nested
+ * parentheses. The parser is iterative, so none of them grows the C stack.
+ * Prints tokens/sec and the number of AST nodes built.
+ *
+ * Usage: parse_bench [term count]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../components/tokens.h"
+#include "../components/source.h"
+#include "../components/memory.h"
+#include "../components/parsers/header/expressions.h"
+
+#define DEFAULT_TERMS 1000000
+
+static double secondsNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Builds "t0 op0 t1 op1 ... tN-1" into a padded source buffer.
+ */
+static void buildChain(SourceBuffer *source, long terms, const char *const *ops, int opCount) {
+    size_t capacity = (size_t)terms * 16 + SOURCE_PADDING;
+    char *text = malloc(capacity);
+    if (!text) {
+        printf("Error: Could not allocate %zu bytes of source\n", capacity);
+        exit(1);
+    }
+    size_t length = 0;
+    for (long i = 0; i < terms; i++) {
+        length += (size_t)sprintf(text + length, "%ld", i % 1000 + 1);
+        if (i + 1 < terms) {
+            length += (size_t)sprintf(text + length, " %s ", ops[i % opCount]);
+        }
+    }
+    memset(text + length, 0, SOURCE_PADDING);
+    source->data = text;
+    source->length = length;
+    source->mapSize = 0;
+    source->mapped = 0;
+}
+
+/**
+ * @brief Builds "1+((( ... 1 ... )))" with the given nesting depth.
+ *
+ * The leading term keeps the first '(' off token 0, which the parser's
+ * bracket balancing never sees.
+ */
+static void buildNested(SourceBuffer *source, long depth) {
+    size_t length = (size_t)depth * 2 + 3;
+    char *text = malloc(length + SOURCE_PADDING);
+    if (!text) {
+        printf("Error: Could not allocate %zu bytes of source\n", length);
+        exit(1);
+    }
+    memcpy(text, "1+", 2);
+    memset(text + 2, '(', (size_t)depth);
+    text[depth + 2] = '1';
+    memset(text + depth + 3, ')', (size_t)depth);
+    memset(text + length, 0, SOURCE_PADDING);
+    source->data = text;
+    source->length = length;
+    source->mapSize = 0;
+    source->mapped = 0;
+}
+
+static void run(const char *name, SourceBuffer *source) {
+    tokenize(source);
+    unsigned int before = nodeCount();
+    double start = secondsNow();
+    NodeId root = parseExpression(0);
+    double elapsed = secondsNow() - start;
+
+    if (!root || current->type != END) {
+        printf("Error: %s did not parse to the end of input\n", name);
+        exit(1);
+    }
+    // tokenCount includes the END sentinel
+    int parsed = tokenCount - 1;
+    printf("  %-11s %9d tokens, %8u nodes, %7.2f Mtokens/sec\n",
+           name, parsed, nodeCount() - before, parsed / elapsed / 1e6);
+
+    freeTokens();
+    freeSource(source);
+}
+
+int main(int argc, char *argv[]) {
+    long terms = argc > 1 ? atol(argv[1]) : DEFAULT_TERMS;
+    if (terms <= 0) {
+        printf("Usage: %s [term count]\n", argv[0]);
+        return 1;
+    }
+
+    static const char *const arithmetic[] = { "+", "*", "-", "/" };
+    static const char *const conditions[] = { "<", "&&", ">=", "||", "==", "+", "!=" };
+    SourceBuffer source;
+
+    printf("Expression parsing:\n");
+    buildChain(&source, terms, arithmetic, 4);
+    run("arithmetic", &source);
+    buildChain(&source, terms, conditions, 7);
+    run("conditions", &source);
+    buildNested(&source, terms);
+    run("nested", &source);
+
+    freeArena();
+    freeInterner();
+    return 0;
+}
@@ -0,0 +1,339 @@
+/*
+ * Integer printing benchmark.
+ *
+ * First times the print_num runtime the compiler actually emits: it
+ * compiles a CX program that prints N integers (10^7 by default, half of
+ * them negative), assembles and links it with nasm and ld, and runs it with
+ * its output sent to /dev/null. A copy of the program that computes the same
+ * values without printing them is timed as well and subtracted, so the rate
+ * covers print_num, print_newline and the buffered writes. One run is piped
+ * back and checked byte for byte against printf. This part needs ./cmmx
+ * (make builds it first) and nasm; it is skipped if either is missing.
+ *
+ * Then compares C models of the routine with the one it replaced:
+ *
+ *   divide:     one hardware div by 10 per digit into a scratch buffer, then
+ *               a copy into the output buffer (unsigned only)
+ *   reciprocal: digits counted against a table of powers of ten, then
+ *               written straight into the output buffer two at a time from a
+ *               "00".."99" table, dividing by 100 with a reciprocal multiply
+ *
+ * The compiler no longer emits the divide routine, so that comparison can
+ * only be made between models. The divisor in the old model is read through
+ * a volatile so the compiler cannot turn its div into a multiply. Checks
+ * that both produce the same bytes, then prints integers/sec for each.
+ *
+ * Usage: print_bench [integer count] [compiler]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_INTEGERS 10000000
+#define OUTPUT_BUFFER_BYTES 65536
+#define ROUNDS 3
+#define DEFAULT_COMPILER "./cmmx"
+
+static char outBuf[OUTPUT_BUFFER_BYTES];
+static size_t outLen = 0;
+static unsigned long long outChecksum = 0;
+static int checksumming = 0;
+
+static volatile unsigned long long ten = 10;
+
+static const char digitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static double secondsNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Stands in for the write syscall. Timed runs just empty the buffer;
+ *        the checking run folds them into a checksum.
+ */
+static void outFlush(void) {
+    if (checksumming) {
+        for (size_t i = 0; i < outLen; i++) {
+            outChecksum = outChecksum * 31 + (unsigned char)outBuf[i];
+        }
+    }
+    outLen = 0;
+}
+
+static void outWrite(const char *text, size_t length) {
+    if (outLen + length > OUTPUT_BUFFER_BYTES) {
+        outFlush();
+    }
+    memcpy(outBuf + outLen, text, length);
+    outLen += length;
+}
+
+/**
+ * @brief The old print_num: div per digit, then out_write.
+ */
+static void printDivide(unsigned long long value) {
+    char scratch[32];
+    char *digit = scratch + sizeof(scratch);
+    do {
+        *--digit = (char)('0' + value % ten);
+        value /= ten;
+    } while (value);
+    outWrite(digit, (size_t)(scratch + sizeof(scratch) - digit));
+}
+
+/**
+ * @brief The new print_num.
+ */
+static void printReciprocal(long long signedValue) {
+    static const unsigned long long pow10[19] = {
+        10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+        100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL,
+        1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+        1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+        1000000000000000000ULL, 10000000000000000000ULL
+    };
+    if (outLen > OUTPUT_BUFFER_BYTES - 21) {
+        outFlush();
+    }
+    char *position = outBuf + outLen;
+    unsigned long long value = (unsigned long long)signedValue;
+    if (signedValue < 0) {
+        *position++ = '-';
+        value = 0 - value;
+    }
+
+    int digits = 1;
+    while (digits < 20 && value >= pow10[digits - 1]) {
+        digits++;
+    }
+    char *end = position + digits;
+    outLen = (size_t)(end - outBuf);
+
+    // Constant division compiles to the same multiply and shifts print_num uses
+    while (value >= 100) {
+        unsigned long long pair = value % 100;
+        value /= 100;
+        end -= 2;
+        memcpy(end, digitPairs + 2 * pair, 2);
+    }
+    if (value >= 10) {
+        memcpy(end - 2, digitPairs + 2 * value, 2);
+    } else {
+        end[-1] = (char)('0' + value);
+    }
+}
+
+/**
+ * @brief Runs a shell command, returning 1 if it exited with status 0.
+ */
+static int run(const char *command) {
+    return system(command) == 0;
+}
+
+/**
+ * @brief Writes a CX program that prints base + i * 7919 for i from 0 to
+ *        count - 1, with base = -3960 * count so half the values are
+ *        negative. With printing 0 it sums the same values and prints only
+ *        the total, for timing the loop alone.
+ */
+static int writeProgram(const char *path, long count, int printing) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return 0;
+    }
+    fprintf(file, "num n = %ld;\n", count);
+    fprintf(file, "num base = 0 - 3960 * n;\n");
+    fprintf(file, "num sum = 0;\n");
+    fprintf(file, "num i = 0;\n");
+    fprintf(file, "while (i < n) {\n");
+    if (printing) {
+        fprintf(file, "  print base + i * 7919;\n");
+    } else {
+        fprintf(file, "  sum = sum + base + i * 7919;\n");
+    }
+    fprintf(file, "  i = i + 1;\n");
+    fprintf(file, "}\n");
+    fprintf(file, "print sum;\n");
+    return fclose(file) == 0;
+}
+
+/**
+ * @brief Compiles, assembles and links directory/name.cx into
+ *        directory/name.
+ */
+static int buildProgram(const char *compiler, const char *nasm, const char *directory, const char *name) {
+    char command[1024];
+    snprintf(command, sizeof(command),
+             "%s %s/%s.cx > /dev/null && %s -f elf64 %s/%s.asm -o %s/%s.o && ld %s/%s.o -o %s/%s",
+             compiler, directory, name, nasm, directory, name, directory, name,
+             directory, name, directory, name);
+    return run(command);
+}
+
+/**
+ * @brief Returns the best wall-clock time of running a program with its
+ *        output discarded.
+ */
+static double timeProgram(const char *directory, const char *name) {
+    char command[512];
+    snprintf(command, sizeof(command), "%s/%s > /dev/null", directory, name);
+    double best = 1e30;
+    for (int round = 0; round < ROUNDS; round++) {
+        double start = secondsNow();
+        if (!run(command)) {
+            return -1;
+        }
+        double elapsed = secondsNow() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+/**
+ * @brief Checks the printing program's output against printf of the same
+ *        values, comparing checksums of the whole stream.
+ */
+static int checkOutput(const char *directory, long count) {
+    char command[512];
+    snprintf(command, sizeof(command), "%s/print", directory);
+    FILE *pipe = popen(command, "r");
+    if (!pipe) {
+        return 0;
+    }
+    unsigned long long actual = 0;
+    int c;
+    while ((c = fgetc(pipe)) != EOF) {
+        actual = actual * 31 + (unsigned char)c;
+    }
+    if (pclose(pipe) != 0) {
+        return 0;
+    }
+
+    unsigned long long expected = 0;
+    long long base = -3960LL * count;
+    char line[32];
+    for (long i = 0; i < count; i++) {
+        int length = snprintf(line, sizeof(line), "%lld\n", base + (long long)i * 7919);
+        for (int k = 0; k < length; k++) {
+            expected = expected * 31 + (unsigned char)line[k];
+        }
+    }
+    // The program ends by printing its unused sum, 0
+    expected = expected * 31 + '0';
+    expected = expected * 31 + '\n';
+    return actual == expected;
+}
+
+/**
+ * @brief Times the print_num the compiler emits. Returns 0 if it could not
+ *        be built, 1 otherwise.
+ */
+static int benchEmitted(long count, const char *compiler) {
+    const char *nasm = getenv("NASM") ? getenv("NASM") : "nasm";
+    char directory[] = "/tmp/print_benchXXXXXX";
+    if (access(compiler, X_OK) != 0 || !mkdtemp(directory)) {
+        return 0;
+    }
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/print.cx", directory);
+    int built = writeProgram(path, count, 1) && buildProgram(compiler, nasm, directory, "print");
+    snprintf(path, sizeof(path), "%s/loop.cx", directory);
+    built = built && writeProgram(path, count, 0) && buildProgram(compiler, nasm, directory, "loop");
+
+    int ok = 0;
+    if (built) {
+        if (!checkOutput(directory, count)) {
+            printf("Error: emitted print_num output differs from printf\n");
+            exit(1);
+        }
+        double printing = timeProgram(directory, "print");
+        double looping = timeProgram(directory, "loop");
+        if (printing > 0 && looping >= 0) {
+            printf("Emitted print_num, %ld signed integers (best of %d):\n", count, ROUNDS);
+            printf("  whole program:      %8.3f s\n", printing);
+            printf("  loop alone:         %8.3f s\n", looping);
+            printf("  print_num:          %8.2f Mints/sec\n", count / (printing - looping) / 1e6);
+            ok = 1;
+        }
+    }
+
+    char command[512];
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+    run(command);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    long count = argc > 1 ? atol(argv[1]) : DEFAULT_INTEGERS;
+    if (count <= 0) {
+        printf("Usage: %s [integer count] [compiler]\n", argv[0]);
+        return 1;
+    }
+
+    if (!benchEmitted(count, argc > 2 ? argv[2] : DEFAULT_COMPILER)) {
+        printf("Emitted print_num: skipped, needs the compiler and nasm\n");
+    }
+
+    // The old routine is unsigned, so compare on non-negative values
+    checksumming = 1;
+    for (long i = 0; i < count; i++) {
+        printDivide((unsigned long long)i * 7919);
+    }
+    outFlush();
+    unsigned long long checksumDivide = outChecksum;
+    outChecksum = 0;
+    for (long i = 0; i < count; i++) {
+        printReciprocal((long long)i * 7919);
+    }
+    outFlush();
+    if (checksumDivide != outChecksum) {
+        printf("Error: routines disagree (%llu vs %llu)\n", checksumDivide, outChecksum);
+        return 1;
+    }
+    checksumming = 0;
+
+    double bestDivide = 1e30, bestReciprocal = 1e30, bestSigned = 1e30;
+    for (int round = 0; round < ROUNDS; round++) {
+        double start = secondsNow();
+        for (long i = 0; i < count; i++) {
+            printDivide((unsigned long long)i * 7919);
+            outWrite("\n", 1);
+        }
+        outFlush();
+        double elapsed = secondsNow() - start;
+        if (elapsed < bestDivide) bestDivide = elapsed;
+
+        start = secondsNow();
+        for (long i = 0; i < count; i++) {
+            printReciprocal((long long)i * 7919);
+            outWrite("\n", 1);
+        }
+        outFlush();
+        elapsed = secondsNow() - start;
+        if (elapsed < bestReciprocal) bestReciprocal = elapsed;
+
+        start = secondsNow();
+        for (long i = 0; i < count; i++) {
+            printReciprocal((long long)i * 7919 - (long long)count * 3960);
+            outWrite("\n", 1);
+        }
+        outFlush();
+        elapsed = secondsNow() - start;
+        if (elapsed < bestSigned) bestSigned = elapsed;
+    }
+
+    printf("C models of print_num, %ld integers (best of %d, checksum %llu):\n", count, ROUNDS, checksumDivide);
+    printf("  div per digit:      %8.2f Mints/sec\n", count / bestDivide / 1e6);
+    printf("  reciprocal pairs:   %8.2f Mints/sec\n", count / bestReciprocal / 1e6);
+    printf("  signed, half < 0:   %8.2f Mints/sec\n", count / bestSigned / 1e6);
+    printf("  speedup:            %8.2fx\n", bestDivide / bestReciprocal);
+    return 0;
+}
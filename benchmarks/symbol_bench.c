@@ -0,0 +1,113 @@
+/*
+ * Symbol table lookup microbenchmark.
+ *
+ * Declares N distinct variables (10^5 by default) and looks every one of
+ * them up repeatedly through the hash-indexed symbol table. For comparison
+ * it also times the linear scan lookupSymbol() used to do, on a sample of
+ * the same names. Prints lookups/sec for both.
+ *
+ * Usage: symbol_bench [symbol count]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../components/symbol_table.h"
+
+#define DEFAULT_SYMBOLS 100000
+#define ROUNDS 5
+#define LINEAR_SAMPLE 2000
+
+static double secondsNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief The lookup the symbol table performed before it was hashed.
+ */
+static int lookupLinear(InternId name) {
+    for (int i = 0; i < symCount; i++) {
+        if (symTable[i].name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char *argv[]) {
+    long count = argc > 1 ? atol(argv[1]) : DEFAULT_SYMBOLS;
+    if (count <= 0) {
+        printf("Usage: %s [symbol count]\n", argv[0]);
+        return 1;
+    }
+
+    InternId *names = malloc((size_t)count * sizeof(InternId));
+    if (!names) {
+        printf("Error: Could not allocate %ld names\n", count);
+        return 1;
+    }
+
+    initSymbolTable();
+    char buffer[32];
+    double start = secondsNow();
+    for (long i = 0; i < count; i++) {
+        int length = snprintf(buffer, sizeof(buffer), "var_%ld", i);
+        names[i] = internString(buffer, (size_t)length);
+        insertSymbol(names[i], (int)i, TYPE_NUMBER);
+    }
+    double insertTime = secondsNow() - start;
+
+    // Look names up in a scrambled order so the probe sequence is not sequential
+    long *order = malloc((size_t)count * sizeof(long));
+    if (!order) {
+        printf("Error: Could not allocate %ld indices\n", count);
+        return 1;
+    }
+    unsigned int seed = 42;
+    for (long i = 0; i < count; i++) {
+        seed = seed * 1103515245u + 12345u;
+        order[i] = (long)((seed >> 8) % (unsigned long)count);
+    }
+
+    double bestHash = 1e30;
+    unsigned long checksumHash = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        start = secondsNow();
+        for (long i = 0; i < count; i++) {
+            checksumHash += (unsigned long)lookupSymbol(names[order[i]]);
+        }
+        double elapsed = secondsNow() - start;
+        if (elapsed < bestHash) bestHash = elapsed;
+    }
+
+    long sample = count < LINEAR_SAMPLE ? count : LINEAR_SAMPLE;
+    unsigned long checksumLinear = 0, checksumSample = 0;
+    start = secondsNow();
+    for (long i = 0; i < sample; i++) {
+        checksumLinear += (unsigned long)lookupLinear(names[order[i]]);
+    }
+    double linearTime = secondsNow() - start;
+    for (long i = 0; i < sample; i++) {
+        checksumSample += (unsigned long)lookupSymbol(names[order[i]]);
+    }
+
+    if (checksumLinear != checksumSample) {
+        printf("Error: lookups disagree (%lu vs %lu)\n", checksumLinear, checksumSample);
+        return 1;
+    }
+
+    double hashRate = count / bestHash;
+    double linearRate = sample / linearTime;
+    printf("Symbol lookups over %ld declared symbols (best of %d, checksum %lu):\n", count, ROUNDS, checksumHash);
+    printf("  insert:        %8.2f Msymbols/sec\n", count / insertTime / 1e6);
+    printf("  hash lookup:   %8.2f Mlookups/sec\n", hashRate / 1e6);
+    printf("  linear scan:   %8.4f Mlookups/sec (%ld-lookup sample)\n", linearRate / 1e6, sample);
+    printf("  speedup:       %8.0fx\n", hashRate / linearRate);
+
+    freeSymbolTable();
+    freeInterner();
+    free(order);
+    free(names);
+    return 0;
+}
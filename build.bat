@@ -6,19 +6,30 @@ cd utils
 flex lexer.l
 cd ..
 
+REM Generate the keyword perfect hash used by the lexer
+gcc utils/keyword_gen.c -o utils/keyword_gen.exe
+utils\keyword_gen.exe > components\keywords.h
+
 REM Create directories if they don't exist
 mkdir obj 2>nul
 mkdir obj\components 2>nul
 mkdir obj\components\parsers 2>nul
 mkdir obj\components\generator 2>nul
+mkdir obj\components\optimizer 2>nul
+mkdir obj\components\ir 2>nul
 mkdir obj\utils 2>nul
 
 REM Compile individual source files
 gcc -c components/tokens.c -o obj/components/tokens.o
+gcc -c components/source.c -o obj/components/source.o
+gcc -c components/interner.c -o obj/components/interner.o
+gcc -c components/log.c -o obj/components/log.o
 gcc -c utils/lex.yy.c -o obj/utils/lex.yy.o
 gcc -c compiler.c -o obj/compiler.o
 gcc -c components/memory.c -o obj/components/memory.o
 gcc -c components/symbol_table.c -o obj/components/symbol_table.o
+gcc -c components/symbol_trail.c -o obj/components/symbol_trail.o
+gcc -c components/ast_walk.c -o obj/components/ast_walk.o
 gcc -c components/ast_visualizer.c -o obj/components/ast_visualizer.o
 gcc -c components/ast_json_exporter.c -o obj/components/ast_json_exporter.o
 gcc -c components/parsers/parser.c -o obj/components/parsers/parser.o
@@ -28,10 +39,21 @@ gcc -c components/parsers/conditionals.c -o obj/components/parsers/conditionals.
 gcc -c components/parsers/functions.c -o obj/components/parsers/functions.o
 gcc -c components/parsers/loops.c -o obj/components/parsers/loops.o
 gcc -c components/generator/codegen.c -o obj/components/generator/codegen.o
+gcc -c components/generator/emitter.c -o obj/components/generator/emitter.o
+gcc -c components/generator/backend.c -o obj/components/generator/backend.o
+gcc -c components/generator/regalloc.c -o obj/components/generator/regalloc.o
+gcc -c components/optimizer/optimizer.c -o obj/components/optimizer/optimizer.o
+gcc -c components/optimizer/fold.c -o obj/components/optimizer/fold.o
+gcc -c components/optimizer/constprop.c -o obj/components/optimizer/constprop.o
+gcc -c components/optimizer/dce.c -o obj/components/optimizer/dce.o
+gcc -c components/ir/ir.c -o obj/components/ir/ir.o
+gcc -c components/ir/lower.c -o obj/components/ir/lower.o
+gcc -c components/ir/verify.c -o obj/components/ir/verify.o
+gcc -c components/ir/liveness.c -o obj/components/ir/liveness.o
 gcc -c semantic.c -o obj/semantic.o
 
 REM Link all object files
-gcc obj/compiler.o obj/components/memory.o obj/components/symbol_table.o obj/components/tokens.o obj/components/ast_visualizer.o obj/components/ast_json_exporter.o obj/components/parsers/parser.o obj/components/parsers/expressions.o obj/components/parsers/statements.o obj/components/parsers/conditionals.o obj/components/parsers/functions.o obj/components/parsers/loops.o obj/components/generator/codegen.o obj/semantic.o obj/utils/lex.yy.o -o cmpx.exe
+gcc obj/compiler.o obj/components/memory.o obj/components/symbol_table.o obj/components/symbol_trail.o obj/components/tokens.o obj/components/source.o obj/components/interner.o obj/components/log.o obj/components/ast_walk.o obj/components/ast_visualizer.o obj/components/ast_json_exporter.o obj/components/parsers/parser.o obj/components/parsers/expressions.o obj/components/parsers/statements.o obj/components/parsers/conditionals.o obj/components/parsers/functions.o obj/components/parsers/loops.o obj/components/generator/codegen.o obj/components/generator/emitter.o obj/components/generator/backend.o obj/components/generator/regalloc.o obj/components/optimizer/optimizer.o obj/components/optimizer/fold.o obj/components/optimizer/constprop.o obj/components/optimizer/dce.o obj/components/ir/ir.o obj/components/ir/lower.o obj/components/ir/verify.o obj/components/ir/liveness.o obj/semantic.o obj/utils/lex.yy.o -o cmpx.exe
 
 echo Build completed!
 
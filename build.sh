@@ -7,11 +7,17 @@ cd utils
 flex lexer.l
 cd ..
 
+# Generate the keyword perfect hash used by the lexer
+gcc utils/keyword_gen.c -o utils/keyword_gen
+./utils/keyword_gen > components/keywords.h
+
 # Create directories if they don't exist
 mkdir -p obj
 mkdir -p obj/components
 mkdir -p obj/components/parsers
 mkdir -p obj/components/generator
+mkdir -p obj/components/optimizer
+mkdir -p obj/components/ir
 mkdir -p obj/utils
 
 # Add compiler flags for debugging and warnings
@@ -19,10 +25,15 @@ CFLAGS="-g -Wall -Wextra -Werror=implicit-function-declaration"
 
 # Compile individual source files with improved flags
 gcc $CFLAGS -c components/tokens.c -o obj/components/tokens.o
+gcc $CFLAGS -c components/source.c -o obj/components/source.o
+gcc $CFLAGS -c components/interner.c -o obj/components/interner.o
+gcc $CFLAGS -c components/log.c -o obj/components/log.o
 gcc $CFLAGS -c utils/lex.yy.c -o obj/utils/lex.yy.o
 gcc $CFLAGS -c compiler.c -o obj/compiler.o
 gcc $CFLAGS -c components/memory.c -o obj/components/memory.o
 gcc $CFLAGS -c components/symbol_table.c -o obj/components/symbol_table.o
+gcc $CFLAGS -c components/symbol_trail.c -o obj/components/symbol_trail.o
+gcc $CFLAGS -c components/ast_walk.c -o obj/components/ast_walk.o
 gcc $CFLAGS -c components/ast_visualizer.c -o obj/components/ast_visualizer.o
 gcc $CFLAGS -c components/ast_json_exporter.c -o obj/components/ast_json_exporter.o
 gcc $CFLAGS -c components/parsers/parser.c -o obj/components/parsers/parser.o
@@ -32,10 +43,21 @@ gcc $CFLAGS -c components/parsers/conditionals.c -o obj/components/parsers/condi
 gcc $CFLAGS -c components/parsers/functions.c -o obj/components/parsers/functions.o
 gcc $CFLAGS -c components/parsers/loops.c -o obj/components/parsers/loops.o
 gcc $CFLAGS -c components/generator/codegen.c -o obj/components/generator/codegen.o
+gcc $CFLAGS -c components/generator/emitter.c -o obj/components/generator/emitter.o
+gcc $CFLAGS -c components/generator/backend.c -o obj/components/generator/backend.o
+gcc $CFLAGS -c components/generator/regalloc.c -o obj/components/generator/regalloc.o
+gcc $CFLAGS -c components/optimizer/optimizer.c -o obj/components/optimizer/optimizer.o
+gcc $CFLAGS -c components/optimizer/fold.c -o obj/components/optimizer/fold.o
+gcc $CFLAGS -c components/optimizer/constprop.c -o obj/components/optimizer/constprop.o
+gcc $CFLAGS -c components/optimizer/dce.c -o obj/components/optimizer/dce.o
+gcc $CFLAGS -c components/ir/ir.c -o obj/components/ir/ir.o
+gcc $CFLAGS -c components/ir/lower.c -o obj/components/ir/lower.o
+gcc $CFLAGS -c components/ir/verify.c -o obj/components/ir/verify.o
+gcc $CFLAGS -c components/ir/liveness.c -o obj/components/ir/liveness.o
 gcc $CFLAGS -c semantic.c -o obj/semantic.o
 
 # Link all object files with debugging information
-gcc $CFLAGS obj/compiler.o obj/components/memory.o obj/components/symbol_table.o obj/components/tokens.o obj/components/ast_visualizer.o obj/components/ast_json_exporter.o obj/components/parsers/parser.o obj/components/parsers/expressions.o obj/components/parsers/statements.o obj/components/parsers/conditionals.o obj/components/parsers/functions.o obj/components/parsers/loops.o obj/components/generator/codegen.o obj/semantic.o obj/utils/lex.yy.o -o cmpx
+gcc $CFLAGS obj/compiler.o obj/components/memory.o obj/components/symbol_table.o obj/components/symbol_trail.o obj/components/tokens.o obj/components/source.o obj/components/interner.o obj/components/log.o obj/components/ast_walk.o obj/components/ast_visualizer.o obj/components/ast_json_exporter.o obj/components/parsers/parser.o obj/components/parsers/expressions.o obj/components/parsers/statements.o obj/components/parsers/conditionals.o obj/components/parsers/functions.o obj/components/parsers/loops.o obj/components/generator/codegen.o obj/components/generator/emitter.o obj/components/generator/backend.o obj/components/generator/regalloc.o obj/components/optimizer/optimizer.o obj/components/optimizer/fold.o obj/components/optimizer/constprop.o obj/components/optimizer/dce.o obj/components/ir/ir.o obj/components/ir/lower.o obj/components/ir/verify.o obj/components/ir/liveness.o obj/semantic.o obj/utils/lex.yy.o -o cmpx
 
 echo "Build completed!"
 
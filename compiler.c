@@ -3,27 +3,99 @@
 #include <string.h>
 #include "utils/help.c"
 #include "components/symbol_table.h"
+#include "components/source.h"
+#include "components/log.h"
 #include "parser.h"
 #include "components/parsers/header/parser.h"
 #include "components/ast_visualizer.h"
 #include "components/ast_json_exporter.h"
 #include "semantic.h"
+#include "components/memory.h"
+#include "components/generator/codegen.h"
+#include "components/optimizer/optimizer.h"
 
-extern ASTNode *astHead;
+extern NodeId astHead;
 
 struct Stack;
 
 extern Token* current;
-extern Token* head;
-extern void tokenize(FILE *file);
-extern ASTNode* statement();
+extern void tokenize(SourceBuffer *source);
+extern void tokenizeLazily(SourceBuffer *source);
+extern NodeId statement();
 extern void freeArena();
 extern struct Stack bracesStack;
 extern struct Stack parenStack;
 extern int isEmpty(struct Stack *stack);
 
 int statementCount = 0;
-int verboseOutput = 0;
+
+// Set by --stream: compile one top-level statement at a time
+static int streamMode = 0;
+
+// Set by --emit=: what a whole-program compile writes
+static EmitTarget emitTarget = EMIT_ASSEMBLY;
+
+static void checkBalanced() {
+    if (!isEmpty(&bracesStack)) {
+        printf("Syntax Error: Unclosed braces '{' detected\n");
+        exit(1);
+    }
+    if (!isEmpty(&parenStack)) {
+        printf("Syntax Error: Unclosed parentheses '(' detected\n");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Compiles the source one top-level statement at a time.
+ *
+ * Each statement is scanned, parsed, checked and emitted before the next is
+ * read. Then its AST nodes and tokens are released and the source pages
+ * before the next statement are handed back, so the node pool, the token
+ * buffer and the resident source only ever hold about the largest
+ * statement. Only the symbol table and the interned names grow with the
+ * program. The whole-program AST outputs (JSON export, visualizer) are
+ * skipped.
+ *
+ * @param source The loaded source, scanned lazily by tokenizeLazily().
+ * @param outputFile The assembly file to write.
+ */
+static void compileStreaming(SourceBuffer *source, const char *outputFile) {
+    FILE *asmFile = beginStreamingAssembly(outputFile);
+    unsigned int peakNodes = 0;
+    int count = 0;
+
+    while (current->type != END) {
+        ArenaMark mark = arenaMark();
+        NodeId node = statement();
+        if (!node) {
+            printf("Warning: statement() returned NULL\n");
+            continue;
+        }
+        if (nodeCount() > peakNodes) {
+            peakNodes = nodeCount();
+        }
+        annotateTypes(mark.nodes);
+        analyzeStatement(node);
+        node = optimizeAST(node, 0);
+        if (node) {
+            generateStatement(node, asmFile);
+        }
+        arenaReset(mark);
+        dropParsedTokens();
+        releaseSourceBefore(source, current->offset);
+        count++;
+    }
+
+    checkBalanced();
+    if (count == 0) {
+        printf("Error: AST is empty. No code to analyze.\n");
+        exit(1);
+    }
+    endStreamingAssembly(asmFile, outputFile);
+    LOG_INFO(LOG_DRIVER, "Streamed %d statements, peak %u AST nodes\n", count, peakNodes);
+    logOptimizerStats();
+}
 
 /**
  * @brief Compiles the given file.
@@ -34,8 +106,8 @@ int verboseOutput = 0;
 void compileFile(const char* filename) {
     initSymbolTable();
     
-    FILE *file = fopen(filename, "r");
-    if (!file) {
+    SourceBuffer source;
+    if (!loadSource(filename, &source)) {
         printf("Error: Could not open file '%s'\n", filename);
         exit(1);
     }
@@ -48,53 +120,67 @@ void compileFile(const char* filename) {
     if (dotPos) {
         *dotPos = '\0';
     }
-    strcat(outputFile, ".asm");
+    strcat(outputFile, emitTarget == EMIT_IR ? ".ir" : ".asm");
     
-    if (verboseOutput) {
-        printf("Output file will be: %s\n", outputFile);
-    } else {
-        printf("Compiling %s to %s\n", filename, outputFile);
-    }
+    printf("Compiling %s to %s\n", filename, outputFile);
 
-    char source[10000] = {0}; 
-    char line[1000];
-    while (fgets(line, sizeof(line), file)) {
-        if (strlen(source) + strlen(line) >= sizeof(source) - 1) {
-            printf("Error: Source file too large for buffer\n");
-            fclose(file);
-            exit(1);
-        }
-        strcat(source, line);
+    if (streamMode) {
+        tokenizeLazily(&source);
+    } else {
+        tokenize(&source);
     }
-    tokenize(file);
-    fclose(file);
     
-    current = head;
-    if (!current) {
+    if (current->type == END) {
         printf("Error: No tokens to parse\n");
         exit(1);
     }
+
+    if (streamMode) {
+        compileStreaming(&source, outputFile);
+        printf("\nCompilation completed successfully.\n");
+        freeArena(); 
+        freeTokens();
+        freeSymbolTable();
+        freeInterner();
+        freeSource(&source);
+        return;
+    }
     
-    #define MAX_STATEMENTS 100
-    ASTNode* statements[MAX_STATEMENTS];
-    ASTNode* prevNode = NULL;
-    astHead = NULL;
+    int statementCapacity = 64;
+    NodeId *statements = malloc(statementCapacity * sizeof(NodeId));
+    if (!statements) {
+        printf("Fatal error: Memory allocation failed for %d statements\n", statementCapacity);
+        exit(1);
+    }
+    NodeId prevNode = NULL_NODE;
+    astHead = NULL_NODE;
     
     int statementCount = 0;
     
-    while (current && current->type != END_OF_FILE && statementCount < MAX_STATEMENTS) {
-        ASTNode* node = statement();
+    while (current->type != END) {
+        NodeId node = statement();
         if (!node) {
             printf("Warning: statement() returned NULL\n");
             continue;
         }
+        if (statementCount == statementCapacity) {
+            int grownCapacity = statementCapacity * 2;
+            NodeId *grown = realloc(statements, grownCapacity * sizeof(NodeId));
+            if (!grown) {
+                printf("Fatal error: Memory allocation failed for %d statements\n", grownCapacity);
+                free(statements);
+                exit(1);
+            }
+            statements = grown;
+            statementCapacity = grownCapacity;
+        }
         statements[statementCount++] = node;
         if (statementCount == 1) {
             astHead = node;
-            printf("AST head set to node type: %d\n", node->type);
+            LOG_DEBUG(LOG_PARSER, "AST head set to node type: %d\n", nodeType(node));
         } else if (prevNode) {
-            prevNode->next = node;
-            printf("Linked node %d to node %d\n", statementCount-2, statementCount-1);
+            setNodeNext(prevNode, node);
+            LOG_TRACE(LOG_PARSER, "Linked node %d to node %d\n", statementCount-2, statementCount-1);
         }
         prevNode = node;
     }
@@ -108,52 +194,85 @@ void compileFile(const char* filename) {
     #endif
 
     exportASTsToSingleJSON(statements, statementCount, "ast_json/ast_all_statements.json");
+    free(statements);
 
-    if (!isEmpty(&bracesStack)) {
-        printf("Syntax Error: Unclosed braces '{' detected\n");
-        exit(1);
-    }
-    if (!isEmpty(&parenStack)) {
-        printf("Syntax Error: Unclosed parentheses '(' detected\n");
-        exit(1);
-    }
+    checkBalanced();
     
-    printf("\nParsing completed. Starting semantic analysis...\n");
+    LOG_INFO(LOG_DRIVER, "\nParsing completed. Starting semantic analysis...\n");
+    LOG_INFO(LOG_DRIVER, "AST: %u nodes in %zu bytes\n", nodeCount(), nodePoolBytes());
     
     if (!astHead) {
         printf("Error: AST is empty. No code to analyze.\n");
         exit(1);
     } else {
-        printf("AST head is not NULL, type: %d\n", astHead->type);
+        LOG_DEBUG(LOG_DRIVER, "AST head is node %u, type: %d\n", astHead, nodeType(astHead));
         
-        ASTNode* temp = astHead;
+        NodeId temp = astHead;
         int count = 0;
         while (temp && count < 5) {
-            printf("Node %d: type %d\n", count, temp->type);
-            temp = temp->next;
+            LOG_DEBUG(LOG_DRIVER, "Node %d: type %d\n", count, nodeType(temp));
+            temp = nodeNext(temp);
             count++;
         }
     }
-    analyzeAndGenerateCode(astHead, outputFile);
+    analyzeAndGenerateCode(astHead, outputFile, emitTarget);
     
     printf("\nCompilation completed successfully.\n");
     freeArena(); 
+    freeTokens();
+    freeSymbolTable();
+    freeInterner();
+    freeSource(&source);
 }
 
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        printf("Usage: %s <filename.cx>\n", argv[0]);
+    char *filename = NULL;
+    int loggingRequested = 0;
+
+    for (int i = 1; i < argc; i++) {
+        char *arg = argv[i];
+        if (strcmp(arg, "-help") == 0 || strcmp(arg, "--help") == 0 || 
+            strcmp(arg, "-h") == 0 || strcmp(arg, "--h") == 0 || 
+            strcmp(arg, "-H") == 0 || strcmp(arg, "--H") == 0) {
+            help();
+            exit(0);
+        } else if (arg[0] == '-' && arg[1] == 'v' && strspn(arg + 1, "v") == strlen(arg + 1)) {
+            // -v, -vv and -vvv raise every category to info, debug and trace
+            setLogLevel((int)strlen(arg + 1));
+            loggingRequested = 1;
+        } else if (strcmp(arg, "--stream") == 0) {
+            streamMode = 1;
+        } else if (strcmp(arg, "--emit=ir") == 0) {
+            emitTarget = EMIT_IR;
+        } else if (strcmp(arg, "--emit=asm") == 0) {
+            emitTarget = EMIT_ASSEMBLY;
+        } else if (strncmp(arg, "--log=", 6) == 0) {
+            if (!parseLogSpec(arg + 6)) {
+                printf("Error: Invalid log specification '%s'\n", arg + 6);
+                exit(1);
+            }
+            loggingRequested = 1;
+        } else if (!filename) {
+            filename = arg;
+        } else {
+            printf("Usage: %s [-v|-vv|-vvv] [--log=<spec>] [--stream] [--emit=asm|ir] <filename.cx>\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!filename) {
+        printf("Usage: %s [-v|-vv|-vvv] [--log=<spec>] [--stream] [--emit=asm|ir] <filename.cx>\n", argv[0]);
+        return 1;
+    }
+    if (streamMode && emitTarget == EMIT_IR) {
+        printf("Error: --emit=ir needs the whole program and cannot be used with --stream\n");
         return 1;
     }
-    if (strcmp(argv[1], "-help") == 0 || strcmp(argv[1], "--help") == 0 || 
-        strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--h") == 0 || 
-        strcmp(argv[1], "-H") == 0 || strcmp(argv[1], "--H") == 0) {
-        help();
-        exit(0);
+    if (LOG_MAX_LEVEL == LOG_LEVEL_OFF && loggingRequested) {
+        printf("Warning: Logging was compiled out of this build\n");
     }
-    
-    char *filename = argv[1];
+
     char *dot = strrchr(filename, '.'); 
 
     if (dot == NULL || strcmp(dot, ".cx") != 0) {
@@ -161,7 +280,7 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
-    compileFile(argv[1]);
+    compileFile(filename);
 
     return 0;
 }
@@ -5,10 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "symbol_table.h"
-
-#define ARENA_BLOCK_SIZE 8192 // 8KB blocks for memory pooling in order to remove memory leaks
-
-typedef struct ASTNode ASTNode;
+#include "interner.h"
 
 typedef enum
 {
@@ -33,157 +30,262 @@ typedef enum
     NODE_RETURN
 } NodeType;
 
-// Arena allocator structure
-typedef struct Arena
+// Saved node pool size for arenaReset()
+typedef struct
 {
-    char *block;
-    size_t offset;
-    size_t size;
-    struct Arena *next;
-} Arena;
+    unsigned int nodes;
+} ArenaMark;
+
+// Index of a node in the node pool. Node 0 is reserved as the null node: its
+// type is NODE_UNKNOWN and its payload and next link are all zero.
+typedef unsigned int NodeId;
+#define NULL_NODE 0
+
+// Operator of a binary, logical, relational or comparison node, assigned
+// once by the parser so later passes switch on an integer
+typedef enum {
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_EQ,
+    OP_NE,
+    OP_LT,
+    OP_GT,
+    OP_LE,
+    OP_GE,
+    OP_AND,
+    OP_OR,
+    OP_COUNT
+} OpCode;
+
+/**
+ * @brief Returns the source spelling of an operator, e.g. "<=".
+ */
+static inline const char *opCodeText(OpCode op) {
+    static const char *const text[OP_COUNT] = {
+        "+", "-", "*", "/", "==", "!=", "<", ">", "<=", ">=", "&&", "||"
+    };
+    return op < OP_COUNT ? text[op] : "?";
+}
 
 typedef struct {
-    char name[50];
+    InternId name;
     int type;  
 } FunctionParam;
 
 
 struct FuncDefNode {
-    char name[50];
+    InternId name;
     FunctionParam *params; 
     int paramCount;         
-    struct ASTNode *body;
+    NodeId body;
     int returnType;     
 };
 
 struct FuncCallNode {
-    char name[50];
-    struct ASTNode *args;  
+    InternId name;
+    NodeId args;  
     int argCount;     
 };
 
 struct ReturnNode {
-    struct ASTNode *expr; 
+    NodeId expr; 
 };
 
 
-typedef struct ASTNode {
-    NodeType type;
-    
-    union {
-        // For number literals
-        int number;
-        
-        // For string literals
-        struct {
-            char value[100];
-        } stringLiteral;
-        
-        // For boolean literals
-        struct {
-            char value[32];
-        } booleanLiteral;
-        
-        // For variable references
-        struct {
-            char name[MAX_VAR_NAME_LENGTH];
-        } varRef;
-        
-        // For binary operations (+, -, *, /)
-        struct {
-            char op;
-            struct ASTNode *left;
-            struct ASTNode *right;
-        } binaryOp;
-        
-        // For logical operations (&&, ||)
-        struct {
-            char op[3];
-            struct ASTNode *left;
-            struct ASTNode *right;
-        } logicalOp;
-        
-        // For relational operations (==, !=, <, >, <=, >=)
-        struct {
-            char op[3];
-            struct ASTNode *left;
-            struct ASTNode *right;
-        } relOp;
-        
-        // For comparison operations
-        struct {
-            char op[3];
-            struct ASTNode *left;
-            struct ASTNode *right;
-        } compOp;
-        
-        // For assignment operations
-        struct {
-            char name[MAX_VAR_NAME_LENGTH];
-            struct ASTNode *expr;
-        } assign;
-        
-        // For variable declarations
-        struct {
-            char name[MAX_VAR_NAME_LENGTH];
-            struct ASTNode *value;
-            int type;  // Variable type (num, str, etc.)
-        } varDecl;
-        
-        // For print statements
-        struct {
-            struct ASTNode *expr;
-        } print;
-        
-        // For if statements
-        struct {
-            struct ASTNode *condition;
-            struct ASTNode *thenStmt;
-            struct ASTNode *elseStmt;
-        } ifNode;
-        
-        // For while loops
-        struct {
-            struct ASTNode *condition;
-            struct ASTNode *body;
-        } whileNode;
-        
-        // For do-while loops
-        struct {
-            struct ASTNode *body;
-            struct ASTNode *condition;
-        } doWhileNode;
-        
-        // For for loops
-        struct {
-            struct ASTNode *initialization;
-            struct ASTNode *condition;
-            struct ASTNode *increment;
-            struct ASTNode *body;
-        } forNode;
-        
-        // For function definitions
-        struct {
-            char name[MAX_VAR_NAME_LENGTH];
-            struct ASTNode *params;
-            struct ASTNode *body;
-        } funcDef;
-        
-        // For function calls
-        struct {
-            char name[MAX_VAR_NAME_LENGTH];
-            struct ASTNode *args;
-        } funcCall;
-    };
+// Fixed 16-byte payload of a node. Children are NodeIds and names and string
+// literals are InternIds, so no payload holds a pointer or inline text.
+typedef union {
+    // For number literals
+    int number;
+    
+    // For string literals (interned text between the quotes)
+    struct {
+        InternId value;
+    } stringLiteral;
+    
+    // For boolean literals (1 for true, 0 for false)
+    struct {
+        int value;
+    } booleanLiteral;
+    
+    // For variable references
+    struct {
+        InternId name;
+        int symbol;  // Resolved symTable id, -1 until resolved
+    } varRef;
+    
+    // For binary operations (+, -, *, /)
+    struct {
+        OpCode op;
+        NodeId left;
+        NodeId right;
+    } binaryOp;
+    
+    // For logical operations (&&, ||)
+    struct {
+        OpCode op;
+        NodeId left;
+        NodeId right;
+    } logicalOp;
+    
+    // For relational operations (==, !=, <, >, <=, >=)
+    struct {
+        OpCode op;
+        NodeId left;
+        NodeId right;
+    } relOp;
+    
+    // For comparison operations
+    struct {
+        OpCode op;
+        NodeId left;
+        NodeId right;
+    } compOp;
+    
+    // For assignment operations
+    struct {
+        InternId name;
+        NodeId expr;
+        int symbol;
+    } assign;
+    
+    // For variable declarations
+    struct {
+        InternId name;
+        NodeId value;
+        int type;  // Variable type (num, str, etc.)
+        int symbol;
+    } varDecl;
+    
+    // For print statements
+    struct {
+        NodeId expr;
+    } print;
     
-    struct ASTNode *next;
-} ASTNode;
+    // For if statements
+    struct {
+        NodeId condition;
+        NodeId thenStmt;
+        NodeId elseStmt;
+    } ifNode;
+    
+    // For while loops
+    struct {
+        NodeId condition;
+        NodeId body;
+    } whileNode;
+    
+    // For do-while loops
+    struct {
+        NodeId body;
+        NodeId condition;
+    } doWhileNode;
+    
+    // For for loops
+    struct {
+        NodeId initialization;
+        NodeId condition;
+        NodeId increment;
+        NodeId body;
+    } forNode;
+    
+    // For function definitions
+    struct {
+        InternId name;
+        NodeId params;
+        NodeId body;
+    } funcDef;
+    
+    // For function calls
+    struct {
+        InternId name;
+        NodeId args;
+    } funcCall;
+} NodePayload;
+
+_Static_assert(sizeof(NodePayload) == 16, "NodePayload must stay 16 bytes");
+
+// Structure-of-arrays node pool. A node is 26 bytes spread over five
+// parallel arrays, and nodes sit in the order the parser created them.
+typedef struct {
+    unsigned char *types;
+    NodePayload *payloads;
+    NodeId *next;
+    unsigned int *visits;     // Epoch of the last walk that marked the node
+    signed char *valueTypes;  // VariableType of an expression, set by annotateTypes()
+    unsigned int count;
+    unsigned int capacity;
+    unsigned int visitEpoch;  // Epoch handed out by the latest beginVisit()
+} NodePool;
+
+extern NodePool nodePool;
+
+/**
+ * @brief Returns the type tag of a node.
+ */
+static inline NodeType nodeType(NodeId node) {
+    return (NodeType)nodePool.types[node];
+}
+
+/**
+ * @brief Returns a node's payload.
+ *
+ * The pointer is only valid until the next allocateNode(), which may move the
+ * pool. Never hold it across a call that can parse.
+ */
+static inline NodePayload *nodeData(NodeId node) {
+    return &nodePool.payloads[node];
+}
+
+/**
+ * @brief Returns the statement that follows a node, or NULL_NODE.
+ */
+static inline NodeId nodeNext(NodeId node) {
+    return nodePool.next[node];
+}
+
+/**
+ * @brief Changes a node's type tag in place, for passes that rewrite nodes.
+ *        The caller sets a payload that matches the new type.
+ */
+static inline void setNodeType(NodeId node, NodeType type) {
+    nodePool.types[node] = (unsigned char)type;
+}
+
+static inline void setNodeNext(NodeId node, NodeId next) {
+    nodePool.next[node] = next;
+}
+
+/**
+ * @brief Returns 1 if the node was marked during the walk owning this epoch.
+ */
+static inline int nodeVisited(NodeId node, unsigned int epoch) {
+    return nodePool.visits[node] == epoch;
+}
+
+static inline void markNodeVisited(NodeId node, unsigned int epoch) {
+    nodePool.visits[node] = epoch;
+}
+
+/**
+ * @brief Returns the cached type of an expression node, or TYPE_UNKNOWN for
+ *        statements and nodes annotateTypes() has not reached.
+ */
+static inline VariableType nodeValueType(NodeId node) {
+    return (VariableType)nodePool.valueTypes[node];
+}
 
+static inline void setNodeValueType(NodeId node, VariableType type) {
+    nodePool.valueTypes[node] = (signed char)type;
+}
 
-Arena *createArena();
-void *allocateFromArena(Arena *arena, size_t size);
 void freeArena();
-ASTNode *allocateNode(NodeType type);
+NodeId allocateNode(NodeType type);
+unsigned int beginVisit();
+unsigned int nodeCount();
+size_t nodePoolBytes();
 
 #endif // AST_H
 
@@ -1,279 +1,143 @@
 #include "ast_json_exporter.h"
+#include "ast_walk.h"
+#include "log.h"
 #include <stdio.h>
 #include <stdlib.h>
 
-// Keep track of visited nodes to prevent infinite recursion
-#define MAX_VISITED_NODES 1000
-void* jsonVisitedNodes[MAX_VISITED_NODES];
-int jsonVisitedCount = 0;
+// Visit epoch of the current export, to prevent infinite recursion
+static unsigned int jsonEpoch = 0;
 
-// Node ID mapping
-typedef struct {
-    void* node;
-    int id;
-} NodeIDMapping;
-
-#define MAX_NODE_MAPPINGS 1000
-NodeIDMapping nodeIDMappings[MAX_NODE_MAPPINGS];
-int nodeIDCount = 0;
-
-// Check if a node has been visited
-int jsonHasBeenVisited(void* node) {
-    for (int i = 0; i < jsonVisitedCount; i++) {
-        if (jsonVisitedNodes[i] == node) {
-            return 1;
-        }
-    }
-    return 0;
-}
-
-// Add a node to the visited list
-void jsonMarkVisited(void* node) {
-    if (jsonVisitedCount < MAX_VISITED_NODES) {
-        jsonVisitedNodes[jsonVisitedCount++] = node;
-    }
-}
-
-// Reset the visited nodes list
+// Reset the visited nodes
 void jsonResetVisited() {
-    jsonVisitedCount = 0;
-}
-
-// Get node ID or assign a new one
-int getNodeID(void* node) {
-    for (int i = 0; i < nodeIDCount; i++) {
-        if (nodeIDMappings[i].node == node) {
-            return nodeIDMappings[i].id;
-        }
-    }
-    
-    // Node not found, assign a new ID
-    if (nodeIDCount < MAX_NODE_MAPPINGS) {
-        nodeIDMappings[nodeIDCount].node = node;
-        nodeIDMappings[nodeIDCount].id = nodeIDCount;
-        return nodeIDCount++;
-    }
-    
-    // Too many nodes, return -1 as error
-    return -1;
-}
-
-// Reset the node ID mappings
-void resetNodeIDs() {
-    nodeIDCount = 0;
+    jsonEpoch = beginVisit();
 }
 
 // Reset the JSON exporter state
 void resetJSONExporter() {
     jsonResetVisited();
-    resetNodeIDs();
 }
 
-// Helper function to write AST node to JSON
-void writeNodeToJSON(ASTNode* node, FILE* file, int isLast) {
-    if (!node) {
-        fprintf(file, "null");
-        return;
+// Names of the node types as written to the "type" key
+static const char *jsonTypeName(NodeId node) {
+    switch (nodeType(node)) {
+        case NODE_NUMBER: return "NUMBER";
+        case NODE_BINARY_OP: return "BINARY_OP";
+        case NODE_ASSIGN: return "ASSIGN";
+        case NODE_VAR_DECL: return "VAR_DECL";
+        case NODE_IF: return "IF";
+        case NODE_WHILE: return "WHILE";
+        case NODE_DO_WHILE: return "DO_WHILE";
+        case NODE_FOR: return "FOR";
+        case NODE_FUNC_DEF: return "FUNC_DEF";
+        case NODE_FUNC_CALL: return "FUNC_CALL";
+        case NODE_LOGICAL_OP: return "LOGICAL_OP";
+        case NODE_RELATIONAL_OP: return "RELATIONAL_OP";
+        case NODE_COMPARISON_OP: return "COMPARISON_OP";
+        case NODE_PRINT: return "PRINT";
+        case NODE_STRING_LITERAL: return "STRING_LITERAL";
+        case NODE_BOOLEAN_LITERAL: return "BOOLEAN_LITERAL";
+        case NODE_VAR_REF: return "VAR_REF";
+        case NODE_RETURN: return "RETURN";
+        default: return "UNKNOWN";
     }
+}
 
-    int nodeID = getNodeID(node);
+// Starts the key of child slot index, or of "next" once the children are done
+static void writeChildKey(NodeId node, int index, FILE* file) {
+    if (index < nodeChildCount(node)) {
+        fprintf(file, ",\n  \"%s\": ", nodeChildName(node, index));
+    } else if (nodeNext(node)) {
+        fprintf(file, ",\n  \"next\": ");
+    }
+}
+
+// Opens a node's object with its scalar fields
+static WalkAction enterJSON(NodeId node, void *context) {
+    FILE* file = context;
 
     // Check if this node has been visited before
-    if (jsonHasBeenVisited(node)) {
-        fprintf(file, "{ \"type\": \"REFERENCE\", \"id\": %d }", nodeID);
-        return;
+    if (nodeVisited(node, jsonEpoch)) {
+        fprintf(file, "{ \"type\": \"REFERENCE\", \"id\": %u }", node);
+        return WALK_PRUNE;
     }
 
     // Mark this node as visited
-    jsonMarkVisited(node);
+    markNodeVisited(node, jsonEpoch);
 
     fprintf(file, "{\n");
-    fprintf(file, "  \"id\": %d,\n", nodeID);
+    fprintf(file, "  \"id\": %u,\n", node);
+    fprintf(file, "  \"type\": \"%s\"", jsonTypeName(node));
 
-    switch (node->type) {
+    switch (nodeType(node)) {
         case NODE_NUMBER:
-            fprintf(file, "  \"type\": \"NUMBER\",\n");
-            fprintf(file, "  \"value\": %d", node->number);
+            fprintf(file, ",\n  \"value\": %d", nodeData(node)->number);
             break;
-
         case NODE_BINARY_OP:
-            fprintf(file, "  \"type\": \"BINARY_OP\",\n");
-            fprintf(file, "  \"operator\": \"%c\",\n", node->binaryOp.op);
-            fprintf(file, "  \"left\": ");
-            writeNodeToJSON(node->binaryOp.left, file, 0);
-            // Removed explicit comma here to avoid double commas
-            // fprintf(file, ",\n");
-            fprintf(file, "\n");
-            fprintf(file, "  \"right\": ");
-            writeNodeToJSON(node->binaryOp.right, file, 1);
+        case NODE_LOGICAL_OP:
+        case NODE_RELATIONAL_OP:
+        case NODE_COMPARISON_OP:
+            fprintf(file, ",\n  \"operator\": \"%s\"", opCodeText(nodeData(node)->binaryOp.op));
             break;
-
         case NODE_ASSIGN:
-            fprintf(file, "  \"type\": \"ASSIGN\",\n");
-            fprintf(file, "  \"name\": \"%s\",\n", node->assign.name);
-            fprintf(file, "  \"expr\": ");
-            writeNodeToJSON(node->assign.expr, file, 1);
+            fprintf(file, ",\n  \"name\": \"%s\"", internedText(nodeData(node)->assign.name));
             break;
-
         case NODE_VAR_DECL:
-            fprintf(file, "  \"type\": \"VAR_DECL\",\n");
-            fprintf(file, "  \"name\": \"%s\",\n", node->varDecl.name);
-            fprintf(file, "  \"value\": ");
-            writeNodeToJSON(node->varDecl.value, file, 1);
-            break;
-
-        case NODE_IF:
-            fprintf(file, "  \"type\": \"IF\",\n");
-            fprintf(file, "  \"condition\": ");
-            writeNodeToJSON(node->ifNode.condition, file, 0);
-            fprintf(file, ",\n");
-            fprintf(file, "  \"then\": ");
-            writeNodeToJSON(node->ifNode.thenStmt, file, node->ifNode.elseStmt == NULL);
-            if (node->ifNode.elseStmt) {
-                fprintf(file, ",\n");
-                fprintf(file, "  \"else\": ");
-                writeNodeToJSON(node->ifNode.elseStmt, file, 1);
-            }
-            break;
-
-        case NODE_WHILE:
-            fprintf(file, "  \"type\": \"WHILE\",\n");
-            fprintf(file, "  \"condition\": ");
-            writeNodeToJSON(node->whileNode.condition, file, 0);
-            fprintf(file, ",\n");
-            fprintf(file, "  \"body\": ");
-            writeNodeToJSON(node->whileNode.body, file, 1);
+            fprintf(file, ",\n  \"name\": \"%s\"", internedText(nodeData(node)->varDecl.name));
             break;
-
-        case NODE_DO_WHILE:
-            fprintf(file, "  \"type\": \"DO_WHILE\",\n");
-            fprintf(file, "  \"body\": ");
-            writeNodeToJSON(node->doWhileNode.body, file, 0);
-            fprintf(file, ",\n");
-            fprintf(file, "  \"condition\": ");
-            writeNodeToJSON(node->doWhileNode.condition, file, 1);
-            break;
-
-        case NODE_FOR:
-            fprintf(file, "  \"type\": \"FOR\",\n");
-            fprintf(file, "  \"init\": ");
-            writeNodeToJSON(node->forNode.initialization, file, 0);
-            fprintf(file, ",\n");
-            fprintf(file, "  \"condition\": ");
-            writeNodeToJSON(node->forNode.condition, file, 0);
-            fprintf(file, ",\n");
-            fprintf(file, "  \"increment\": ");
-            writeNodeToJSON(node->forNode.increment, file, 0);
-            fprintf(file, ",\n");
-            fprintf(file, "  \"body\": ");
-            writeNodeToJSON(node->forNode.body, file, 1);
-            break;
-
         case NODE_FUNC_DEF:
-            fprintf(file, "  \"type\": \"FUNC_DEF\",\n");
-            fprintf(file, "  \"name\": \"%s\",\n", node->funcDef.name);
-            fprintf(file, "  \"params\": ");
-            writeNodeToJSON(node->funcDef.params, file, 0);
-            fprintf(file, ",\n");
-            fprintf(file, "  \"body\": ");
-            writeNodeToJSON(node->funcDef.body, file, 1);
+            fprintf(file, ",\n  \"name\": \"%s\"", internedText(nodeData(node)->funcDef.name));
             break;
-
         case NODE_FUNC_CALL:
-            fprintf(file, "  \"type\": \"FUNC_CALL\",\n");
-            fprintf(file, "  \"name\": \"%s\",\n", node->funcCall.name);
-            fprintf(file, "  \"args\": ");
-            writeNodeToJSON(node->funcCall.args, file, 1);
-            break;
-
-        case NODE_LOGICAL_OP:
-            fprintf(file, "  \"type\": \"LOGICAL_OP\",\n");
-            fprintf(file, "  \"operator\": \"%s\",\n", node->logicalOp.op);
-            fprintf(file, "  \"left\": ");
-            writeNodeToJSON(node->logicalOp.left, file, 0);
-            // Removed explicit comma here to avoid double commas
-            // fprintf(file, ",\n");
-            fprintf(file, "\n");
-            fprintf(file, "  \"right\": ");
-            writeNodeToJSON(node->logicalOp.right, file, 1);
+            fprintf(file, ",\n  \"name\": \"%s\"", internedText(nodeData(node)->funcCall.name));
             break;
-
-        case NODE_RELATIONAL_OP:
-            fprintf(file, "  \"type\": \"RELATIONAL_OP\",\n");
-            fprintf(file, "  \"operator\": \"%s\",\n", node->relOp.op);
-            fprintf(file, "  \"left\": ");
-            writeNodeToJSON(node->relOp.left, file, 0);
-            // Removed explicit comma here to avoid double commas
-            // fprintf(file, ",\n");
-            fprintf(file, "\n");
-            fprintf(file, "  \"right\": ");
-            writeNodeToJSON(node->relOp.right, file, 1);
-            break;
-
-        case NODE_COMPARISON_OP:
-            fprintf(file, "  \"type\": \"COMPARISON_OP\",\n");
-            fprintf(file, "  \"operator\": \"%s\",\n", node->compOp.op);
-            fprintf(file, "  \"left\": ");
-            writeNodeToJSON(node->compOp.left, file, 0);
-            // Removed explicit comma here to avoid double commas
-            // fprintf(file, ",\n");
-            fprintf(file, "\n");
-            fprintf(file, "  \"right\": ");
-            writeNodeToJSON(node->compOp.right, file, 1);
-            break;
-
-        case NODE_PRINT:
-            fprintf(file, "  \"type\": \"PRINT\",\n");
-            fprintf(file, "  \"expr\": ");
-            writeNodeToJSON(node->print.expr, file, 1);
-            break;
-
         case NODE_STRING_LITERAL:
-            fprintf(file, "  \"type\": \"STRING_LITERAL\",\n");
-            fprintf(file, "  \"value\": \"%s\"", node->stringLiteral.value);
+            fprintf(file, ",\n  \"value\": \"%s\"", internedText(nodeData(node)->stringLiteral.value));
             break;
-
         case NODE_BOOLEAN_LITERAL:
-            fprintf(file, "  \"type\": \"BOOLEAN_LITERAL\",\n");
-            fprintf(file, "  \"value\": \"%s\"", node->booleanLiteral.value);
+            fprintf(file, ",\n  \"value\": \"%s\"", nodeData(node)->booleanLiteral.value ? "true" : "false");
             break;
-
         case NODE_VAR_REF:
-            fprintf(file, "  \"type\": \"VAR_REF\",\n");
-            fprintf(file, "  \"name\": \"%s\"", node->varRef.name);
-            break;
-
-        case NODE_RETURN:
-            fprintf(file, "  \"type\": \"RETURN\",\n");
-            fprintf(file, "  \"expr\": ");
-            writeNodeToJSON(node->assign.expr, file, 1);
-            break;
-
-        case NODE_UNKNOWN:
-            fprintf(file, "  \"type\": \"UNKNOWN\"");
+            fprintf(file, ",\n  \"name\": \"%s\"", internedText(nodeData(node)->varRef.name));
             break;
         default:
-            fprintf(file, "  \"type\": \"UNKNOWN\",\n");
-            fprintf(file, "  \"typeValue\": %d", node->type);
+            if (nodeType(node) > NODE_RETURN) {
+                fprintf(file, ",\n  \"typeValue\": %d", nodeType(node));
+            }
             break;
     }
 
-    // Add next node if it exists
-    if (node->next) {
-        fprintf(file, ",\n");
-        fprintf(file, "  \"next\": ");
-        // Pass isLast as 1 only if current node is last, else 0
-        writeNodeToJSON(node->next, file, isLast ? 1 : 0);
+    writeChildKey(node, 0, file);
+    return WALK_CHILDREN;
+}
+
+// Fills an empty slot with null and starts the next key
+static void afterChildJSON(NodeId node, int index, void *context) {
+    FILE* file = context;
+    if (!nodeChild(node, index)) {
+        fprintf(file, "null");
     }
+    writeChildKey(node, index + 1, file);
+}
+
+static void leaveJSON(NodeId node, void *context) {
+    (void)node;
+    fprintf((FILE*)context, "\n}");
+}
+
+// "next" is a key inside the node's object, so it is walked as a last child
+static const AstVisitor jsonVisitor = { enterJSON, afterChildJSON, leaveJSON, WALK_NEXT_NESTED };
 
-    fprintf(file, "\n}");
-    if (!isLast) {
-        fprintf(file, ",");
+// Writes a node and everything under it as one JSON object
+void writeNodeToJSON(NodeId node, FILE* file) {
+    if (!node) {
+        fprintf(file, "null");
+        return;
     }
+    walkAST(node, &jsonVisitor, file);
 }
 
 // Function to export AST to JSON
-void exportASTToJSON(ASTNode* node, const char* filename) {
+void exportASTToJSON(NodeId node, const char* filename) {
     FILE* file = fopen(filename, "w");
     if (!file) {
         printf("Error: Could not open file '%s' for writing\n", filename);
@@ -284,16 +148,16 @@ void exportASTToJSON(ASTNode* node, const char* filename) {
     fprintf(file, "  \"ast\": ");
     
     jsonResetVisited();
-    writeNodeToJSON(node, file, 1);
+    writeNodeToJSON(node, file);
     
     fprintf(file, "\n}\n");
     
     fclose(file);
-    printf("AST exported to %s\n", filename);
+    LOG_INFO(LOG_DRIVER, "AST exported to %s\n", filename);
 }
 
 // Function to export multiple AST nodes to a single JSON file
-void exportASTsToSingleJSON(ASTNode** nodes, int count, const char* filename) {
+void exportASTsToSingleJSON(NodeId *nodes, int count, const char* filename) {
     FILE* file = fopen(filename, "w");
     if (!file) {
         printf("Error: Could not open file '%s' for writing\n", filename);
@@ -310,8 +174,14 @@ void exportASTsToSingleJSON(ASTNode** nodes, int count, const char* filename) {
         fprintf(file, "      \"id\": %d,\n", i);
         fprintf(file, "      \"ast\": ");
         
+        // The array already lists every statement, so the link to the
+        // following one is written as a reference instead of repeating the
+        // rest of the program under each entry
         jsonResetVisited();
-        writeNodeToJSON(nodes[i], file, 1);
+        if (nodeNext(nodes[i])) {
+            markNodeVisited(nodeNext(nodes[i]), jsonEpoch);
+        }
+        writeNodeToJSON(nodes[i], file);
         
         fprintf(file, "\n    }");
         if (i < count - 1) {
@@ -324,6 +194,6 @@ void exportASTsToSingleJSON(ASTNode** nodes, int count, const char* filename) {
     fprintf(file, "}\n");
 
     fclose(file);
-    printf("All ASTs exported to %s\n", filename);
+    LOG_INFO(LOG_DRIVER, "All ASTs exported to %s\n", filename);
 }
 
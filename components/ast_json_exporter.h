@@ -4,10 +4,10 @@
 #include "ast.h"
 
 // Function to export AST to JSON
-void exportASTToJSON(ASTNode* node, const char* filename);
+void exportASTToJSON(NodeId node, const char* filename);
 
 // Function to export multiple AST nodes to a single JSON file
-void exportASTsToSingleJSON(ASTNode** nodes, int count, const char* filename);
+void exportASTsToSingleJSON(NodeId *nodes, int count, const char* filename);
 
 // Function to reset the JSON exporter state between compilations
 void resetJSONExporter();
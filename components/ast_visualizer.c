@@ -1,4 +1,6 @@
 #include "ast_visualizer.h"
+#include "ast_walk.h"
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -9,198 +11,124 @@ void printIndent(int depth) {
     }
 }
 
-// Keep track of visited nodes to prevent infinite recursion
-#define MAX_VISITED_NODES 1000
-void* visitedNodes[MAX_VISITED_NODES];
-int visitedCount = 0;
+// Visit epoch of the current visualization, to prevent infinite recursion
+static unsigned int visualizerEpoch = 0;
 
-// Check if a node has been visited
-int hasBeenVisited(void* node) {
-    for (int i = 0; i < visitedCount; i++) {
-        if (visitedNodes[i] == node) {
-            return 1;
-        }
-    }
-    return 0;
+// Reset the visited nodes
+void resetVisited() {
+    visualizerEpoch = beginVisit();
 }
 
-// Add a node to the visited list
-void markVisited(void* node) {
-    if (visitedCount < MAX_VISITED_NODES) {
-        visitedNodes[visitedCount++] = node;
+// Prints a child slot's label, e.g. "LEFT:", at the parent's depth
+static void printLabel(const char *name, int depth) {
+    printIndent(depth);
+    for (const char *c = name; *c; c++) {
+        putchar(toupper((unsigned char)*c));
     }
+    printf(":\n");
 }
 
-// Reset the visited nodes list
-void resetVisited() {
-    visitedCount = 0;
-}
+// Prints a node's header line and the label of its first child
+static WalkAction enterVisualize(NodeId node, void *context) {
+    int *depth = context;
 
-// Function to visualize the AST
-void visualizeAST(ASTNode* node, int depth) {
-    if (!node) return;
-    
     // Check if this node has been visited before
-    if (hasBeenVisited(node)) {
-        printIndent(depth);
+    if (nodeVisited(node, visualizerEpoch)) {
+        printIndent(*depth);
         printf("CIRCULAR REFERENCE DETECTED\n");
-        return;
+        return WALK_PRUNE;
     }
     
     // Mark this node as visited
-    markVisited(node);
+    markNodeVisited(node, visualizerEpoch);
     
-    printIndent(depth);
+    printIndent(*depth);
     
-    switch (node->type) {
+    switch (nodeType(node)) {
         case NODE_NUMBER:
-            printf("NUMBER: %d\n", node->number);
+            printf("NUMBER: %d\n", nodeData(node)->number);
             break;
-            
         case NODE_BINARY_OP:
-            printf("BINARY_OP: %c\n", node->binaryOp.op);
-            printIndent(depth);
-            printf("LEFT:\n");
-            visualizeAST(node->binaryOp.left, depth + 1);
-            printIndent(depth);
-            printf("RIGHT:\n");
-            visualizeAST(node->binaryOp.right, depth + 1);
+            printf("BINARY_OP: %s\n", opCodeText(nodeData(node)->binaryOp.op));
             break;
-            
         case NODE_ASSIGN:
-            printf("ASSIGN: %s\n", node->assign.name);
-            printIndent(depth);
-            printf("EXPR:\n");
-            visualizeAST(node->assign.expr, depth + 1);
+            printf("ASSIGN: %s\n", internedText(nodeData(node)->assign.name));
             break;
-            
         case NODE_VAR_DECL:
-            printf("VAR_DECL: %s\n", node->varDecl.name);
-            printIndent(depth);
-            printf("VALUE:\n");
-            visualizeAST(node->varDecl.value, depth + 1);
+            printf("VAR_DECL: %s\n", internedText(nodeData(node)->varDecl.name));
             break;
-            
         case NODE_IF:
             printf("IF\n");
-            printIndent(depth);
-            printf("CONDITION:\n");
-            visualizeAST(node->ifNode.condition, depth + 1);
-            printIndent(depth);
-            printf("THEN:\n");
-            visualizeAST(node->ifNode.thenStmt, depth + 1);
-            if (node->ifNode.elseStmt) {
-                printIndent(depth);
-                printf("ELSE:\n");
-                visualizeAST(node->ifNode.elseStmt, depth + 1);
-            }
             break;
-            
         case NODE_WHILE:
             printf("WHILE\n");
-            printIndent(depth);
-            printf("CONDITION:\n");
-            visualizeAST(node->whileNode.condition, depth + 1);
-            printIndent(depth);
-            printf("BODY:\n");
-            visualizeAST(node->whileNode.body, depth + 1);
             break;
-            
         case NODE_DO_WHILE:
             printf("DO_WHILE\n");
-            printIndent(depth);
-            printf("BODY:\n");
-            visualizeAST(node->doWhileNode.body, depth + 1);
-            printIndent(depth);
-            printf("CONDITION:\n");
-            visualizeAST(node->doWhileNode.condition, depth + 1);
             break;
-            
         case NODE_FOR:
             printf("FOR\n");
-            printIndent(depth);
-            printf("INIT:\n");
-            visualizeAST(node->forNode.initialization, depth + 1);
-            printIndent(depth);
-            printf("CONDITION:\n");
-            visualizeAST(node->forNode.condition, depth + 1);
-            printIndent(depth);
-            printf("INCREMENT:\n");
-            visualizeAST(node->forNode.increment, depth + 1);
-            printIndent(depth);
-            printf("BODY:\n");
-            visualizeAST(node->forNode.body, depth + 1);
             break;
-            
         case NODE_FUNC_DEF:
-            printf("FUNC_DEF: %s\n", node->funcDef.name);
-            printIndent(depth);
-            printf("PARAMS:\n");
-            visualizeAST(node->funcDef.params, depth + 1);
-            printIndent(depth);
-            printf("BODY:\n");
-            visualizeAST(node->funcDef.body, depth + 1);
+            printf("FUNC_DEF: %s\n", internedText(nodeData(node)->funcDef.name));
             break;
-            
         case NODE_FUNC_CALL:
-            printf("FUNC_CALL: %s\n", node->funcCall.name);
-            printIndent(depth);
-            printf("ARGS:\n");
-            visualizeAST(node->funcCall.args, depth + 1);
+            printf("FUNC_CALL: %s\n", internedText(nodeData(node)->funcCall.name));
             break;
-            
         case NODE_LOGICAL_OP:
-            printf("LOGICAL_OP: %s\n", node->logicalOp.op);
-            printIndent(depth);
-            printf("LEFT:\n");
-            visualizeAST(node->logicalOp.left, depth + 1);
-            printIndent(depth);
-            printf("RIGHT:\n");
-            visualizeAST(node->logicalOp.right, depth + 1);
+            printf("LOGICAL_OP: %s\n", opCodeText(nodeData(node)->logicalOp.op));
             break;
-            
         case NODE_RELATIONAL_OP:
-            printf("RELATIONAL_OP: %s\n", node->relOp.op);
-            printIndent(depth);
-            printf("LEFT:\n");
-            visualizeAST(node->relOp.left, depth + 1);
-            printIndent(depth);
-            printf("RIGHT:\n");
-            visualizeAST(node->relOp.right, depth + 1);
+            printf("RELATIONAL_OP: %s\n", opCodeText(nodeData(node)->relOp.op));
             break;
-            
         case NODE_COMPARISON_OP:
-            printf("COMPARISON_OP: %s\n", node->compOp.op);
-            printIndent(depth);
-            printf("LEFT:\n");
-            visualizeAST(node->compOp.left, depth + 1);
-            printIndent(depth);
-            printf("RIGHT:\n");
-            visualizeAST(node->compOp.right, depth + 1);
+            printf("COMPARISON_OP: %s\n", opCodeText(nodeData(node)->compOp.op));
             break;
-            
         case NODE_PRINT:
             printf("PRINT\n");
-            printIndent(depth);
-            printf("EXPR:\n");
-            visualizeAST(node->print.expr, depth + 1);
             break;
-            
         default:
-            printf("UNKNOWN NODE TYPE: %d\n", node->type);
+            printf("UNKNOWN NODE TYPE: %d\n", nodeType(node));
             break;
     }
-    
-    // Visualize the next node in the list
-    if (node->next) {
-        printIndent(depth - 1);
+
+    if (nodeChildCount(node) > 0) {
+        printLabel(nodeChildName(node, 0), *depth);
+    }
+    (*depth)++;
+    return WALK_CHILDREN;
+}
+
+// Labels the next child; an if without an else gets no ELSE label
+static void afterChildVisualize(NodeId node, int index, void *context) {
+    int *depth = context;
+    if (index + 1 < nodeChildCount(node) &&
+        !(nodeType(node) == NODE_IF && !nodeChild(node, index + 1))) {
+        printLabel(nodeChildName(node, index + 1), *depth - 1);
+    }
+}
+
+static void leaveVisualize(NodeId node, void *context) {
+    int *depth = context;
+    (*depth)--;
+    // The walk continues with the next statement at the same depth
+    if (nodeNext(node)) {
+        printIndent(*depth - 1);
         printf("NEXT:\n");
-        visualizeAST(node->next, depth);
     }
 }
 
+static const AstVisitor visualizerVisitor = {
+    enterVisualize, afterChildVisualize, leaveVisualize, WALK_NEXT_TAIL
+};
+
+// Function to visualize the AST
+void visualizeAST(NodeId node, int depth) {
+    walkAST(node, &visualizerVisitor, &depth);
+}
+
 // Wrapper function to reset visited nodes before visualization
-void visualizeASTRoot(ASTNode* node) {
+void visualizeASTRoot(NodeId node) {
     resetVisited();
     visualizeAST(node, 0);
 }
@@ -4,9 +4,9 @@
 #include "ast.h"
 
 // Function to visualize the AST
-void visualizeAST(ASTNode* node, int depth);
+void visualizeAST(NodeId node, int depth);
 
 // Wrapper function to reset visited nodes before visualization
-void visualizeASTRoot(ASTNode* node);
+void visualizeASTRoot(NodeId node);
 
 #endif // AST_VISUALIZER_H
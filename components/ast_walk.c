@@ -0,0 +1,220 @@
+#include "ast_walk.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define INITIAL_WALK_FRAMES 64
+
+// A node being walked and the next child slot to visit. pending is set while
+// a child is being walked, so its afterChild runs once the child is done.
+typedef struct {
+    NodeId node;
+    int child;
+    int pending;
+} WalkFrame;
+
+// Shared by every walk; a nested walkAST() from a callback works above the
+// caller's frames
+static WalkFrame *frames = NULL;
+static int frameCount = 0;
+static int frameCapacity = 0;
+
+/**
+ * @brief Returns how many child slots a node has, whether or not they are set.
+ *        The next link is not a child.
+ */
+int nodeChildCount(NodeId node) {
+    switch (nodeType(node)) {
+        case NODE_BINARY_OP:
+        case NODE_LOGICAL_OP:
+        case NODE_RELATIONAL_OP:
+        case NODE_COMPARISON_OP:
+        case NODE_WHILE:
+        case NODE_DO_WHILE:
+        case NODE_FUNC_DEF:
+            return 2;
+        case NODE_ASSIGN:
+        case NODE_VAR_DECL:
+        case NODE_PRINT:
+        case NODE_FUNC_CALL:
+        case NODE_RETURN:
+            return 1;
+        case NODE_IF:
+            return 3;
+        case NODE_FOR:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Returns child slot index of a node, in evaluation order.
+ *
+ * @return The child, or NULL_NODE for an empty or out of range slot.
+ */
+NodeId nodeChild(NodeId node, int index) {
+    NodePayload *data = nodeData(node);
+    switch (nodeType(node)) {
+        case NODE_BINARY_OP:
+        case NODE_LOGICAL_OP:
+        case NODE_RELATIONAL_OP:
+        case NODE_COMPARISON_OP:
+            // The four operator payloads share one layout
+            return index == 0 ? data->binaryOp.left : index == 1 ? data->binaryOp.right : NULL_NODE;
+        case NODE_ASSIGN:
+        case NODE_RETURN:
+            return index == 0 ? data->assign.expr : NULL_NODE;
+        case NODE_VAR_DECL:
+            return index == 0 ? data->varDecl.value : NULL_NODE;
+        case NODE_PRINT:
+            return index == 0 ? data->print.expr : NULL_NODE;
+        case NODE_IF:
+            switch (index) {
+                case 0: return data->ifNode.condition;
+                case 1: return data->ifNode.thenStmt;
+                case 2: return data->ifNode.elseStmt;
+            }
+            return NULL_NODE;
+        case NODE_WHILE:
+            return index == 0 ? data->whileNode.condition : index == 1 ? data->whileNode.body : NULL_NODE;
+        case NODE_DO_WHILE:
+            return index == 0 ? data->doWhileNode.body : index == 1 ? data->doWhileNode.condition : NULL_NODE;
+        case NODE_FOR:
+            switch (index) {
+                case 0: return data->forNode.initialization;
+                case 1: return data->forNode.condition;
+                case 2: return data->forNode.body;
+                case 3: return data->forNode.increment;
+            }
+            return NULL_NODE;
+        case NODE_FUNC_DEF:
+            return index == 0 ? data->funcDef.params : index == 1 ? data->funcDef.body : NULL_NODE;
+        case NODE_FUNC_CALL:
+            return index == 0 ? data->funcCall.args : NULL_NODE;
+        default:
+            return NULL_NODE;
+    }
+}
+
+/**
+ * @brief Returns the name of a child slot, as used for the JSON keys.
+ */
+const char *nodeChildName(NodeId node, int index) {
+    switch (nodeType(node)) {
+        case NODE_BINARY_OP:
+        case NODE_LOGICAL_OP:
+        case NODE_RELATIONAL_OP:
+        case NODE_COMPARISON_OP:
+            return index == 0 ? "left" : "right";
+        case NODE_ASSIGN:
+        case NODE_PRINT:
+        case NODE_RETURN:
+            return "expr";
+        case NODE_VAR_DECL:
+            return "value";
+        case NODE_IF: {
+            static const char *const names[] = { "condition", "then", "else" };
+            return names[index];
+        }
+        case NODE_WHILE:
+            return index == 0 ? "condition" : "body";
+        case NODE_DO_WHILE:
+            return index == 0 ? "body" : "condition";
+        case NODE_FOR: {
+            static const char *const names[] = { "init", "condition", "body", "increment" };
+            return names[index];
+        }
+        case NODE_FUNC_DEF:
+            return index == 0 ? "params" : "body";
+        case NODE_FUNC_CALL:
+            return "args";
+        default:
+            return "";
+    }
+}
+
+/**
+ * @brief Runs a node's enter callback and pushes a frame for it unless it was
+ *        pruned.
+ */
+static void enterNode(NodeId node, const AstVisitor *visitor, void *context) {
+    WalkAction action = visitor->enter ? visitor->enter(node, context) : WALK_CHILDREN;
+    if (action == WALK_PRUNE) {
+        return;
+    }
+    if (frameCount == frameCapacity) {
+        int capacity = frameCapacity ? frameCapacity * 2 : INITIAL_WALK_FRAMES;
+        WalkFrame *grown = realloc(frames, capacity * sizeof(WalkFrame));
+        if (!grown) {
+            printf("Fatal error: Memory allocation failed for %d AST walk frames\n", capacity);
+            exit(1);
+        }
+        frames = grown;
+        frameCapacity = capacity;
+    }
+    frames[frameCount].node = node;
+    frames[frameCount].child = action == WALK_SKIP_CHILDREN ? nodeChildCount(node) : 0;
+    frames[frameCount].pending = 0;
+    frameCount++;
+}
+
+/**
+ * @brief Walks the AST under root depth-first with an explicit stack.
+ *
+ * Each node gets enter, then afterChild once per child slot, then leave. In
+ * WALK_NEXT_TAIL mode a node's frame is replaced by its next statement once
+ * it is left, so a statement list of any length takes one frame; the stack
+ * only grows with nesting, and never uses the native call stack.
+ *
+ * @param root The first node; NULL_NODE walks nothing.
+ * @param visitor The callbacks and how to follow next links.
+ * @param context Passed to every callback.
+ */
+void walkAST(NodeId root, const AstVisitor *visitor, void *context) {
+    int base = frameCount;
+    if (root) {
+        enterNode(root, visitor, context);
+    }
+
+    while (frameCount > base) {
+        // Frames may move when a child is pushed, so index instead of holding
+        // a pointer
+        int top = frameCount - 1;
+        NodeId node = frames[top].node;
+        int count = nodeChildCount(node);
+
+        if (frames[top].pending) {
+            frames[top].pending = 0;
+            if (visitor->afterChild) {
+                visitor->afterChild(node, frames[top].child - 1, context);
+            }
+        }
+
+        if (frames[top].child < count) {
+            NodeId child = nodeChild(node, frames[top].child);
+            frames[top].child++;
+            frames[top].pending = 1;
+            if (child) {
+                enterNode(child, visitor, context);
+            }
+            continue;
+        }
+
+        if (visitor->next == WALK_NEXT_NESTED && frames[top].child == count) {
+            frames[top].child++;
+            if (nodeNext(node)) {
+                enterNode(nodeNext(node), visitor, context);
+                continue;
+            }
+        }
+
+        if (visitor->leave) {
+            visitor->leave(node, context);
+        }
+        frameCount--;
+
+        if (visitor->next == WALK_NEXT_TAIL && nodeNext(node)) {
+            enterNode(nodeNext(node), visitor, context);
+        }
+    }
+}
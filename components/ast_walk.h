@@ -0,0 +1,36 @@
+#ifndef AST_WALK_H
+#define AST_WALK_H
+
+#include "ast.h"
+
+// What a walk does with a node after its enter callback
+typedef enum {
+    WALK_PRUNE,          // Drop the node: no children, no leave, no next
+    WALK_SKIP_CHILDREN,  // Call leave and follow next, but skip the children
+    WALK_CHILDREN        // Walk the children, then leave
+} WalkAction;
+
+// How a walk follows the next links between statements
+typedef enum {
+    WALK_NEXT_TAIL,      // Walk next after the node is left, at the same depth
+    WALK_NEXT_NESTED     // Walk next as the node's last child, before leave
+} WalkNextMode;
+
+// Callbacks for walkAST(); any of them may be NULL
+typedef struct {
+    // Pre-order visit. NULL means every node is WALK_CHILDREN.
+    WalkAction (*enter)(NodeId node, void *context);
+    // Called after child slot index is done, including empty slots
+    void (*afterChild)(NodeId node, int index, void *context);
+    // Post-order visit
+    void (*leave)(NodeId node, void *context);
+    WalkNextMode next;
+} AstVisitor;
+
+int nodeChildCount(NodeId node);
+NodeId nodeChild(NodeId node, int index);
+const char *nodeChildName(NodeId node, int index);
+
+void walkAST(NodeId root, const AstVisitor *visitor, void *context);
+
+#endif // AST_WALK_H
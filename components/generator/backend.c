@@ -0,0 +1,522 @@
+#include "codegen.h"
+#include "regalloc.h"
+#include "../log.h"
+#include "../memory.h"
+
+// Print routine for each register type
+static const char *const printRoutines[] = {
+    [IR_NUM] = "print_num",
+    [IR_LOG] = "print_log",
+    [IR_STR] = "print_str",
+};
+
+// Flag-setting instruction for each comparison (signed compares)
+static const char *const setccFor[IR_OPCODE_COUNT] = {
+    [IR_EQ] = "sete",
+    [IR_NE] = "setne",
+    [IR_LT] = "setl",
+    [IR_GT] = "setg",
+    [IR_LE] = "setle",
+    [IR_GE] = "setge",
+};
+
+static const char *const arithmeticFor[IR_OPCODE_COUNT] = {
+    [IR_ADD] = "add",
+    [IR_SUB] = "sub",
+    [IR_MUL] = "imul",
+    [IR_AND] = "and",
+    [IR_OR] = "or",
+};
+
+// The comparison that gives the same result with its operands swapped
+static const IrOpcode swappedCompare[IR_OPCODE_COUNT] = {
+    [IR_EQ] = IR_EQ,
+    [IR_NE] = IR_NE,
+    [IR_LT] = IR_GT,
+    [IR_GT] = IR_LT,
+    [IR_LE] = IR_GE,
+    [IR_GE] = IR_LE,
+};
+
+// Stands for the stack top in a phi copy, where a value saved to break a
+// cycle waits when no register is free
+#define STACK_TEMP -3
+
+// A phi copy on a jump: home dest gets the value in home source, or the
+// immediate when source is HOME_IMMEDIATE
+typedef struct {
+    int dest;
+    int source;
+    long long immediate;
+} PhiCopy;
+
+// A register used for an intermediate value, pushed first and popped after
+// if it had to be borrowed from a live value
+typedef struct {
+    int reg;
+    int borrowed;
+} Scratch;
+
+// Home of each virtual register, from allocateRegisters()
+static const int *homes = NULL;
+
+// Position of the instruction being emitted
+static int position = 0;
+
+static PhiCopy *copies = NULL;
+static int copyCapacity = 0;
+
+/**
+ * @brief Returns the assembly operand of a register or slot home, with size
+ *        the width written for a slot. Each call gets its own buffer, for up
+ *        to four operands per instruction.
+ */
+static const char *homeOperand(int home, const char *size) {
+    static char operands[4][32];
+    static int next = 0;
+    char *operand = operands[next];
+    next = (next + 1) % 4;
+    if (IS_REGISTER_HOME(home)) {
+        return machineRegisterNames[home];
+    }
+    snprintf(operand, sizeof(operands[0]), "%s [rbp - %d]", size, 8 * (home - MACHINE_REGISTERS + 1));
+    return operand;
+}
+
+static long long immediateOf(int reg) {
+    return irInstruction(irProgram.definitions[reg])->immediate;
+}
+
+/**
+ * @brief Returns the assembly operand of a virtual register: its machine
+ *        register, its slot, or the constant itself.
+ */
+static const char *operandOf(int reg) {
+    static char immediates[2][24];
+    static int next = 0;
+    if (homes[reg] != HOME_IMMEDIATE) {
+        return homeOperand(homes[reg], "qword");
+    }
+    char *operand = immediates[next];
+    next = (next + 1) % 2;
+    snprintf(operand, sizeof(immediates[0]), "%lld", immediateOf(reg));
+    return operand;
+}
+
+static unsigned int registerMask(int reg) {
+    return reg != IR_NONE && IS_REGISTER_HOME(homes[reg]) ? 1u << homes[reg] : 0;
+}
+
+/**
+ * @brief Returns a machine register that holds no value at the current
+ *        position and is not in avoid, or -1 if there is none.
+ */
+static int freeRegister(unsigned int avoid) {
+    for (int r = 0; r < MACHINE_REGISTERS; r++) {
+        if (!(avoid & 1u << r) && registerOccupant(r, position) == IR_NONE) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Finds a scratch register outside avoid. With every register in
+ *        use, one is pushed and must be given back with releaseScratch().
+ */
+static Scratch takeScratch(EmitBuffer *out, unsigned int avoid) {
+    Scratch scratch = { freeRegister(avoid), 0 };
+    if (scratch.reg == -1) {
+        scratch.reg = 0;
+        while (avoid & 1u << scratch.reg) {
+            scratch.reg++;
+        }
+        scratch.borrowed = 1;
+        emitFormat(out, "    push %s\n", machineRegisterNames[scratch.reg]);
+    }
+    return scratch;
+}
+
+static void releaseScratch(EmitBuffer *out, Scratch scratch) {
+    if (scratch.borrowed) {
+        emitFormat(out, "    pop %s\n", machineRegisterNames[scratch.reg]);
+    }
+}
+
+/**
+ * @brief Emits target = target op source. imul has no two-operand form
+ *        with an immediate, so that takes the three-operand one.
+ */
+static void emitArithmetic(EmitBuffer *out, IrOpcode op, const char *target, int source) {
+    if (op == IR_MUL && homes[source] == HOME_IMMEDIATE) {
+        emitFormat(out, "    imul %s, %s, %s\n", target, target, operandOf(source));
+    } else {
+        emitFormat(out, "    %s %s, %s\n", arithmeticFor[op], target, operandOf(source));
+    }
+}
+
+/**
+ * @brief Emits a two-operand arithmetic instruction. The result is built in
+ *        its own register, or in a scratch register when it lives in a slot.
+ *        When that register already holds the right operand, a commutative
+ *        op reads the left one instead and a subtraction is negated first.
+ */
+static void emitBinary(EmitBuffer *out, const IrInstruction *instruction) {
+    int left = instruction->operands[0];
+    int right = instruction->operands[1];
+    int dest = homes[instruction->dest];
+    Scratch scratch = { dest, 0 };
+    if (!IS_REGISTER_HOME(dest)) {
+        scratch = takeScratch(out, registerMask(left) | registerMask(right));
+    }
+    const char *target = machineRegisterNames[scratch.reg];
+
+    if (homes[right] == scratch.reg && homes[left] != scratch.reg) {
+        if (instruction->op == IR_SUB) {
+            emitFormat(out, "    neg %s\n", target);
+            emitArithmetic(out, IR_ADD, target, left);
+        } else {
+            emitArithmetic(out, instruction->op, target, left);
+        }
+    } else {
+        if (homes[left] != scratch.reg) {
+            emitFormat(out, "    mov %s, %s\n", target, operandOf(left));
+        }
+        emitArithmetic(out, instruction->op, target, right);
+    }
+
+    if (scratch.reg != dest) {
+        emitFormat(out, "    mov %s, %s\n", homeOperand(dest, "qword"), target);
+        releaseScratch(out, scratch);
+    }
+}
+
+/**
+ * @brief Emits a signed division, which idiv does in rdx:rax. Values that
+ *        live through the division in either register are saved around it,
+ *        and a divisor idiv cannot read where it is goes through the stack.
+ */
+static void emitDivision(EmitBuffer *out, const IrInstruction *instruction) {
+    int left = instruction->operands[0];
+    int right = instruction->operands[1];
+    int dest = homes[instruction->dest];
+    int saveRdx = registerLiveThrough(REG_RDX, position);
+    int saveRax = registerLiveThrough(REG_RAX, position);
+    int stackDivisor = homes[right] == HOME_IMMEDIATE || homes[right] == REG_RAX || homes[right] == REG_RDX;
+
+    if (saveRdx) {
+        emitLiteral(out, "    push rdx\n");
+    }
+    if (saveRax) {
+        emitLiteral(out, "    push rax\n");
+    }
+    if (stackDivisor) {
+        emitFormat(out, "    push %s\n", operandOf(right));
+    }
+    if (homes[left] != REG_RAX) {
+        emitFormat(out, "    mov rax, %s\n", operandOf(left));
+    }
+    emitLiteral(out, "    cqo\n");
+    if (stackDivisor) {
+        emitLiteral(out, "    idiv qword [rsp]\n");
+        emitLiteral(out, "    add rsp, 8\n");
+    } else {
+        emitFormat(out, "    idiv %s\n", operandOf(right));
+    }
+    if (dest != REG_RAX) {
+        emitFormat(out, "    mov %s, rax\n", homeOperand(dest, "qword"));
+    }
+    if (saveRax) {
+        emitLiteral(out, "    pop rax\n");
+    }
+    if (saveRdx) {
+        emitLiteral(out, "    pop rdx\n");
+    }
+}
+
+/**
+ * @brief Emits a comparison producing 0 or 1. cmp cannot take an immediate
+ *        or two slots on the left, so the operands are swapped or the left
+ *        one loaded into a scratch register.
+ */
+static void emitComparison(EmitBuffer *out, const IrInstruction *instruction) {
+    int left = instruction->operands[0];
+    int right = instruction->operands[1];
+    IrOpcode op = instruction->op;
+    if (homes[left] == HOME_IMMEDIATE) {
+        left = instruction->operands[1];
+        right = instruction->operands[0];
+        op = swappedCompare[op];
+    }
+
+    Scratch scratch = { IR_NONE, 0 };
+    const char *leftOperand = operandOf(left);
+    if (homes[left] == HOME_IMMEDIATE || (IS_SLOT_HOME(homes[left]) && IS_SLOT_HOME(homes[right]))) {
+        scratch = takeScratch(out, registerMask(right));
+        emitFormat(out, "    mov %s, %s\n", machineRegisterNames[scratch.reg], leftOperand);
+        leftOperand = machineRegisterNames[scratch.reg];
+    }
+    emitFormat(out, "    cmp %s, %s\n", leftOperand, operandOf(right));
+    if (scratch.reg != IR_NONE) {
+        releaseScratch(out, scratch);
+    }
+
+    int dest = homes[instruction->dest];
+    if (IS_REGISTER_HOME(dest)) {
+        emitFormat(out, "    %s %s\n", setccFor[op], machineByteNames[dest]);
+        emitFormat(out, "    movzx %s, %s\n", machineRegisterNames[dest], machineByteNames[dest]);
+    } else {
+        emitFormat(out, "    mov %s, 0\n", homeOperand(dest, "qword"));
+        emitFormat(out, "    %s %s\n", setccFor[op], homeOperand(dest, "byte"));
+    }
+}
+
+/**
+ * @brief Emits a print call. The print routines are free to change the
+ *        caller-saved registers, so those holding a value needed after the
+ *        call are pushed around it.
+ */
+static void emitPrint(EmitBuffer *out, const IrInstruction *instruction) {
+    int value = instruction->operands[0];
+    int saved[MACHINE_REGISTERS];
+    int savedCount = 0;
+    for (int r = 0; r < MACHINE_REGISTERS; r++) {
+        if ((callClobbered & 1u << r) && registerLiveThrough(r, position)) {
+            saved[savedCount++] = r;
+            emitFormat(out, "    push %s\n", machineRegisterNames[r]);
+        }
+    }
+    if (homes[value] != REG_RDI) {
+        emitFormat(out, "    mov rdi, %s\n", operandOf(value));
+    }
+    emitFormat(out, "    call %s\n", printRoutines[irRegisterType(value)]);
+    emitLiteral(out, "    call print_newline\n");
+    while (savedCount > 0) {
+        emitFormat(out, "    pop %s\n", machineRegisterNames[saved[--savedCount]]);
+    }
+}
+
+/**
+ * @brief Emits a move between two homes, through scratch or the stack when
+ *        both are slots.
+ */
+static void emitMove(EmitBuffer *out, int dest, int source, int scratch) {
+    if (IS_SLOT_HOME(dest) && IS_SLOT_HOME(source)) {
+        if (scratch == -1) {
+            emitFormat(out, "    push %s\n", homeOperand(source, "qword"));
+            emitFormat(out, "    pop %s\n", homeOperand(dest, "qword"));
+            return;
+        }
+        emitFormat(out, "    mov %s, %s\n", machineRegisterNames[scratch], homeOperand(source, "qword"));
+        source = scratch;
+    }
+    emitFormat(out, "    mov %s, %s\n", homeOperand(dest, "qword"), homeOperand(source, "qword"));
+}
+
+/**
+ * @brief Emits the phi copies for a jump from block to target as if they
+ *        all happened at once: a copy waits while another still reads its
+ *        destination, and a cycle of copies is broken by saving one
+ *        destination in a free register, or on the stack if there is none.
+ */
+static void emitPhiCopies(EmitBuffer *out, int block, int target) {
+    int predIndex = irPredecessorIndex(target, block);
+    int count = 0;
+    for (int i = irBlock(target)->first; i != IR_NONE && irInstruction(i)->op == IR_PHI;
+         i = irInstruction(i)->next) {
+        int operand = irInstruction(i)->operands[predIndex];
+        int dest = homes[irInstruction(i)->dest];
+        if (homes[operand] == dest) {
+            continue;
+        }
+        if (count == copyCapacity) {
+            copyCapacity = copyCapacity ? copyCapacity * 2 : 16;
+            copies = growArray(copies, copyCapacity, sizeof(PhiCopy), "phi copies");
+        }
+        copies[count].dest = dest;
+        copies[count].source = homes[operand];
+        copies[count].immediate = homes[operand] == HOME_IMMEDIATE ? immediateOf(operand) : 0;
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    // Registers free at the jump: one for slot to slot copies, one for a
+    // cycle
+    int scratch = freeRegister(0);
+    int cycleTemp = scratch == -1 ? -1 : freeRegister(1u << scratch);
+
+    while (count > 0) {
+        int ready = -1;
+        for (int i = 0; i < count && ready == -1; i++) {
+            ready = i;
+            for (int j = 0; j < count; j++) {
+                if (j != i && copies[j].source == copies[i].dest) {
+                    ready = -1;
+                    break;
+                }
+            }
+        }
+        if (ready == -1) {
+            // Every copy is on a cycle: save one destination and read it
+            // from the saved copy instead
+            int saved = copies[0].dest;
+            int temp = cycleTemp;
+            if (temp == -1) {
+                emitFormat(out, "    push %s\n", homeOperand(saved, "qword"));
+                temp = STACK_TEMP;
+            } else {
+                emitFormat(out, "    mov %s, %s\n", machineRegisterNames[temp], homeOperand(saved, "qword"));
+            }
+            for (int j = 0; j < count; j++) {
+                if (copies[j].source == saved) {
+                    copies[j].source = temp;
+                }
+            }
+            continue;
+        }
+
+        const PhiCopy *copy = &copies[ready];
+        if (copy->source == HOME_IMMEDIATE) {
+            emitFormat(out, "    mov %s, %lld\n", homeOperand(copy->dest, "qword"), copy->immediate);
+        } else if (copy->source == STACK_TEMP) {
+            emitFormat(out, "    pop %s\n", homeOperand(copy->dest, "qword"));
+        } else {
+            emitMove(out, copy->dest, copy->source, scratch);
+        }
+        copies[ready] = copies[--count];
+    }
+}
+
+static void emitInstruction(EmitBuffer *out, int block, const IrInstruction *instruction) {
+    int dest = instruction->dest != IR_NONE ? homes[instruction->dest] : HOME_IMMEDIATE;
+    position = instruction->position;
+
+    switch (instruction->op) {
+        case IR_CONST:
+            // Constants that fit are used in place as immediates
+            if (dest == HOME_IMMEDIATE) {
+                break;
+            }
+            if (IS_REGISTER_HOME(dest)) {
+                emitFormat(out, "    mov %s, %lld\n", machineRegisterNames[dest], instruction->immediate);
+            } else {
+                Scratch scratch = takeScratch(out, 0);
+                emitFormat(out, "    mov %s, %lld\n", machineRegisterNames[scratch.reg], instruction->immediate);
+                emitFormat(out, "    mov %s, %s\n", homeOperand(dest, "qword"), machineRegisterNames[scratch.reg]);
+                releaseScratch(out, scratch);
+            }
+            break;
+
+        case IR_STRING: {
+            int label = addStringLiteral((InternId)instruction->immediate);
+            if (IS_REGISTER_HOME(dest)) {
+                emitFormat(out, "    lea %s, [rel str_%d]\n", machineRegisterNames[dest], label);
+            } else {
+                Scratch scratch = takeScratch(out, 0);
+                emitFormat(out, "    lea %s, [rel str_%d]\n", machineRegisterNames[scratch.reg], label);
+                emitFormat(out, "    mov %s, %s\n", homeOperand(dest, "qword"), machineRegisterNames[scratch.reg]);
+                releaseScratch(out, scratch);
+            }
+            break;
+        }
+
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_AND:
+        case IR_OR:
+            emitBinary(out, instruction);
+            break;
+
+        case IR_DIV:
+            emitDivision(out, instruction);
+            break;
+
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_GT:
+        case IR_LE:
+        case IR_GE:
+            emitComparison(out, instruction);
+            break;
+
+        case IR_PHI:
+            // Written by the copies at the end of each predecessor
+            break;
+
+        case IR_PRINT:
+            emitPrint(out, instruction);
+            break;
+
+        case IR_JUMP:
+            emitPhiCopies(out, block, instruction->targets[0]);
+            if (instruction->targets[0] != block + 1) {
+                emitFormat(out, "    jmp .block_%d\n", instruction->targets[0]);
+            }
+            break;
+
+        case IR_BRANCH: {
+            int condition = instruction->operands[0];
+            int home = homes[condition];
+            if (home == HOME_IMMEDIATE) {
+                // Known at compile time: only one way is ever taken
+                int taken = instruction->targets[immediateOf(condition) ? 0 : 1];
+                if (taken != block + 1) {
+                    emitFormat(out, "    jmp .block_%d\n", taken);
+                }
+                break;
+            }
+            if (IS_REGISTER_HOME(home)) {
+                emitFormat(out, "    test %s, %s\n", machineRegisterNames[home], machineRegisterNames[home]);
+            } else {
+                emitFormat(out, "    cmp %s, 0\n", homeOperand(home, "qword"));
+            }
+            if (instruction->targets[1] == block + 1) {
+                emitFormat(out, "    jne .block_%d\n", instruction->targets[0]);
+            } else {
+                emitFormat(out, "    je .block_%d\n", instruction->targets[1]);
+                if (instruction->targets[0] != block + 1) {
+                    emitFormat(out, "    jmp .block_%d\n", instruction->targets[0]);
+                }
+            }
+            break;
+        }
+
+        case IR_EXIT:
+            emitExit(out);
+            break;
+
+        default:
+            printf("Error: Unknown IR opcode %s\n", irOpcodeName(instruction->op));
+            break;
+    }
+}
+
+/**
+ * @brief Appends the x86-64 code for irProgram, which must have passed
+ *        verifyIR(), after the _start label.
+ *
+ * Each virtual register lives where allocateRegisters() put it: a machine
+ * register, a stack slot of one frame below rbp, or nowhere for a constant
+ * used as an immediate. Instructions work on those homes directly and only
+ * reach for a scratch register when x86 needs one. Phis cost nothing where
+ * they are; the jumps into their block copy the operands.
+ */
+void emitIRProgram(EmitBuffer *out) {
+    LiveInterval *intervals = computeLiveIntervals();
+    homes = allocateRegisters(intervals);
+
+    if (allocatorStats.stackSlots > 0) {
+        emitLiteral(out, "    mov rbp, rsp\n");
+        emitFormat(out, "    sub rsp, %d\n", (8 * allocatorStats.stackSlots + 15) & ~15);
+    }
+    for (int b = 0; b < irProgram.blockCount; b++) {
+        emitFormat(out, ".block_%d:\n", b);
+        for (int i = irBlock(b)->first; i != IR_NONE; i = irInstruction(i)->next) {
+            emitInstruction(out, b, irInstruction(i));
+        }
+    }
+}
@@ -1,472 +1,810 @@
 #include "codegen.h"
 #include "../ast.h"
+#include "../ast_walk.h"
 #include "../symbol_table.h"
+#include "../ir/ir.h"
+#include "../log.h"
+#include "../memory.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-extern ASTNode* astHead;
+extern NodeId astHead;
 
-#define MAX_CODEGEN_VISITED_NODES 1000
-static ASTNode* codegenVisitedNodes[MAX_CODEGEN_VISITED_NODES];
-static int codegenVisitedCount = 0;
+// Visit epoch of the current code generation walk
+static unsigned int codegenEpoch = 0;
 
-static int codegenHasVisited(ASTNode* node) {
-    for (int i = 0; i < codegenVisitedCount; i++) {
-        if (codegenVisitedNodes[i] == node) {
-            return 1;
-        }
+void codegenResetVisited() {
+    codegenEpoch = beginVisit();
+}
+
+// Flag-setting instruction for each relational opcode (signed compares)
+static const char *const setccFor[OP_COUNT] = {
+    [OP_EQ] = "sete",
+    [OP_NE] = "setne",
+    [OP_LT] = "setl",
+    [OP_GT] = "setg",
+    [OP_LE] = "setle",
+    [OP_GE] = "setge",
+};
+
+// Bytes of block-local frame reserved so far by a --stream compile
+static int streamedFrameBytes = 0;
+
+// Generated code, and the .data section that is only known once the code is
+// done. Both are written to the file in one call.
+static EmitBuffer textBuffer;
+static EmitBuffer dataBuffer;
+static size_t bytesWritten = 0;
+
+// Size of the runtime's output buffer in .bss
+#define OUTPUT_BUFFER_BYTES 65536
+
+// A --stream compile writes its text buffer out once it grows past this
+#define STREAM_FLUSH_BYTES 65536
+
+#define INITIAL_LITERAL_CAPACITY 64
+#define INITIAL_LABEL_CAPACITY 16
+
+// Number of the last if or while label. It only ever grows, so labels stay
+// unique even when --stream hands out the same node ids to every statement.
+static unsigned int labelCount = 0;
+
+// Label numbers of the ifs and whiles the walk is inside, innermost last
+static unsigned int *openLabels = NULL;
+static int openLabelCount = 0;
+static int openLabelCapacity = 0;
+
+// Literal pool: stringLiterals[i] is the text of str_i, and literalSlots is
+// an open-addressing table (linear probing) from that text to i. Slots hold
+// i + 1 so that zero marks an empty slot.
+static InternId *stringLiterals = NULL;
+static int stringLiteralCount = 0;
+static int stringLiteralCapacity = 0;
+static int *literalSlots = NULL;
+static unsigned int literalSlotCapacity = 0;
+
+/**
+ * @brief Returns the memory operand of a resolved variable: its .data label
+ *        for globals, or its stack slot below rbp for block locals.
+ */
+static const char *variableOperand(int symbol) {
+    static char operand[64];
+    if (symTable[symbol].slot) {
+        snprintf(operand, sizeof(operand), "[rbp - %d]", 8 * symTable[symbol].slot);
+    } else {
+        snprintf(operand, sizeof(operand), "[%s]", internedText(symTable[symbol].name));
     }
-    return 0;
+    return operand;
 }
 
-static void codegenMarkVisited(ASTNode* node) {
-    if (codegenVisitedCount < MAX_CODEGEN_VISITED_NODES) {
-        codegenVisitedNodes[codegenVisitedCount++] = node;
+static void resetStringLiterals() {
+    stringLiteralCount = 0;
+    if (literalSlots) {
+        memset(literalSlots, 0, literalSlotCapacity * sizeof(int));
     }
 }
 
-void codegenResetVisited() {
-    codegenVisitedCount = 0;
+/**
+ * @brief Doubles the literal slot table and reinserts every literal.
+ */
+static void growLiteralSlots() {
+    unsigned int capacity = literalSlotCapacity ? literalSlotCapacity * 2 : 2 * INITIAL_LITERAL_CAPACITY;
+    int *slots = calloc(capacity, sizeof(int));
+    if (!slots) {
+        printf("Fatal error: Memory allocation failed for %u string literal slots\n", capacity);
+        exit(1);
+    }
+    for (int i = 0; i < stringLiteralCount; i++) {
+        unsigned int slot = internedHash(stringLiterals[i]) & (capacity - 1);
+        while (slots[slot]) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        slots[slot] = i + 1;
+    }
+    free(literalSlots);
+    literalSlots = slots;
+    literalSlotCapacity = capacity;
 }
 
-#define MAX_STRING_LITERALS 100
-static char stringLiterals[MAX_STRING_LITERALS][256];
-static int stringLiteralCount = 0;
+/**
+ * @brief Returns the index of a string literal's str_ label, adding it to the
+ *        pool the first time the text is seen.
+ */
+int addStringLiteral(InternId text) {
+    // Keep the load factor at or below one half
+    if ((unsigned int)(stringLiteralCount + 1) * 2 > literalSlotCapacity) {
+        growLiteralSlots();
+    }
 
-static void resetStringLiterals() {
-    stringLiteralCount = 0;
-}
+    unsigned int slot = internedHash(text) & (literalSlotCapacity - 1);
+    while (literalSlots[slot]) {
+        if (stringLiterals[literalSlots[slot] - 1] == text) {
+            return literalSlots[slot] - 1;
+        }
+        slot = (slot + 1) & (literalSlotCapacity - 1);
+    }
 
-static int addStringLiteral(const char* str) {
-    if (stringLiteralCount < MAX_STRING_LITERALS) {
-        strcpy(stringLiterals[stringLiteralCount], str);
-        return stringLiteralCount++;
+    if (stringLiteralCount == stringLiteralCapacity) {
+        int capacity = stringLiteralCapacity ? stringLiteralCapacity * 2 : INITIAL_LITERAL_CAPACITY;
+        InternId *grown = realloc(stringLiterals, capacity * sizeof(InternId));
+        if (!grown) {
+            printf("Fatal error: Memory allocation failed for %d string literals\n", capacity);
+            exit(1);
+        }
+        stringLiterals = grown;
+        stringLiteralCapacity = capacity;
     }
-    return -1;
+    stringLiterals[stringLiteralCount] = text;
+    literalSlots[slot] = stringLiteralCount + 1;
+    return stringLiteralCount++;
 }
 
-void generateCode(ASTNode *node, FILE *asmFile)
+/**
+ * @brief Writes a string constant: its byte length as a qword, then its label
+ *        and bytes. Printable runs are quoted and every other byte, the quote
+ *        included, is written as a number, so any text assembles unchanged.
+ */
+static void emitStringConstant(EmitBuffer *out, const char *label, const char *text, unsigned int length)
 {
-    if (!node) {
-        printf("Warning: Null node in generateCode\n");
-        return;
+    emitFormat(out, "    dq %u\n", length);
+    emitFormat(out, "    %s: db ", label);
+    int quoted = 0;
+    for (unsigned int i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c >= ' ' && c <= '~' && c != '\'') {
+            if (!quoted) {
+                if (i > 0) {
+                    emitLiteral(out, ", ");
+                }
+                emitLiteral(out, "'");
+                quoted = 1;
+            }
+            emitBytes(out, (const char *)&c, 1);
+        } else {
+            if (quoted) {
+                emitLiteral(out, "'");
+                quoted = 0;
+            }
+            if (i > 0) {
+                emitLiteral(out, ", ");
+            }
+            emitFormat(out, "%u", c);
+        }
     }
+    if (quoted) {
+        emitLiteral(out, "'");
+    }
+    emitText(out, length ? ", 0\n" : "0\n");
+}
 
-    if (codegenHasVisited(node)) {
-        printf("Warning: Circular reference detected in AST during code generation. Skipping node %p\n", (void*)node);
-        return;
+/**
+ * @brief Gives an if or while a fresh label number for its labels.
+ */
+static unsigned int openLabel()
+{
+    openLabels = reserveArray(openLabels, openLabelCount, &openLabelCapacity, INITIAL_LABEL_CAPACITY,
+                              sizeof(unsigned int), "labels");
+    openLabels[openLabelCount++] = ++labelCount;
+    return labelCount;
+}
+
+/**
+ * @brief Returns the label number of the innermost open if or while.
+ */
+static unsigned int currentLabel()
+{
+    return openLabels[openLabelCount - 1];
+}
+
+/**
+ * @brief Emits whatever precedes a node's children: loop labels, and the
+ *        circular reference check.
+ */
+static WalkAction enterCode(NodeId node, void *context)
+{
+    EmitBuffer *out = context;
+
+    if (nodeVisited(node, codegenEpoch)) {
+        printf("Warning: Circular reference detected in AST during code generation. Skipping node %u\n", node);
+        return WALK_PRUNE;
     }
     
-    codegenMarkVisited(node);
+    markNodeVisited(node, codegenEpoch);
 
-    printf("Generating code for node type: %d\n", node->type);
+    LOG_TRACE(LOG_CODEGEN, "Generating code for node type: %d\n", nodeType(node));
 
-    switch (node->type)
+    switch (nodeType(node))
     {
+    case NODE_WHILE:
+        LOG_DEBUG(LOG_CODEGEN, "Generating code for while loop\n");
+        emitFormat(out, ".loop_start_%u:\n", openLabel());
+        return WALK_CHILDREN;
+
+    case NODE_IF:
+        openLabel();
+        return WALK_CHILDREN;
+
     case NODE_NUMBER:
-        printf("Generating code for number: %d\n", node->number);
-        if (asmFile) {
-            fprintf(asmFile, "    mov rax, %d\n", node->number);
+    case NODE_VAR_REF:
+    case NODE_STRING_LITERAL:
+    case NODE_BOOLEAN_LITERAL:
+    case NODE_BINARY_OP:
+    case NODE_LOGICAL_OP:
+    case NODE_RELATIONAL_OP:
+    case NODE_VAR_DECL:
+    case NODE_ASSIGN:
+    case NODE_PRINT:
+        return WALK_CHILDREN;
+
+    default:
+        // No code for this node or anything under it, but its next
+        // statement still runs
+        LOG_DEBUG(LOG_CODEGEN, "Unhandled node type %d in code generation\n", nodeType(node));
+        return WALK_SKIP_CHILDREN;
+    }
+}
+
+/**
+ * @brief Emits the code between two children: saving a left operand, or the
+ *        branches of an if or while.
+ */
+static void afterChildCode(NodeId node, int index, void *context)
+{
+    EmitBuffer *out = context;
+
+    switch (nodeType(node))
+    {
+    case NODE_BINARY_OP:
+    case NODE_LOGICAL_OP:
+    case NODE_RELATIONAL_OP:
+        // Operands run left to right; the left one waits on the stack
+        if (index == 0) {
+            emitLiteral(out, "    push rax\n");
         }
         break;
 
-    case NODE_VAR_REF:
-        printf("Generating code for variable reference: %s\n", node->varRef.name);
-        if (asmFile) {
-            fprintf(asmFile, "    mov rax, [%s]\n", node->varRef.name);
+    case NODE_IF:
+        if (index == 0) {
+            emitLiteral(out, "    cmp rax, 0\n");
+            emitFormat(out, "    je .else_%u\n", currentLabel());
+        } else if (index == 1) {
+            emitFormat(out, "    jmp .endif_%u\n", currentLabel());
+            emitFormat(out, ".else_%u:\n", currentLabel());
         }
         break;
 
-    case NODE_BINARY_OP:
-        printf("Generating code for binary op: %c\n", node->binaryOp.op);
-        generateCode(node->binaryOp.right, asmFile);
-        if (asmFile) {
-            fprintf(asmFile, "    push rax\n");
+    case NODE_WHILE:
+        if (index == 0) {
+            emitLiteral(out, "    cmp rax, 0\n");
+            emitFormat(out, "    je .loop_end_%u\n", currentLabel());
         }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Emits a node's own code once its children are done; every
+ *        expression leaves its value in rax.
+ */
+static void leaveCode(NodeId node, void *context)
+{
+    EmitBuffer *out = context;
+
+    switch (nodeType(node))
+    {
+    case NODE_NUMBER:
+        LOG_DEBUG(LOG_CODEGEN, "Generating code for number: %d\n", nodeData(node)->number);
+        emitFormat(out, "    mov rax, %d\n", nodeData(node)->number);
+        break;
+
+    case NODE_VAR_REF:
+        LOG_DEBUG(LOG_CODEGEN, "Generating code for variable reference: %s\n", internedText(nodeData(node)->varRef.name));
+        emitFormat(out, "    mov rax, %s\n", variableOperand(nodeData(node)->varRef.symbol));
+        break;
+
+    case NODE_BINARY_OP:
+        LOG_DEBUG(LOG_CODEGEN, "Generating code for binary op: %s\n", opCodeText(nodeData(node)->binaryOp.op));
+        emitLiteral(out, "    mov rbx, rax\n");
+        emitLiteral(out, "    pop rax\n");
         
-        generateCode(node->binaryOp.left, asmFile);
-        
-        if (asmFile) {
-            fprintf(asmFile, "    pop rbx\n");
-            
-            switch (node->binaryOp.op)
-            {
-            case '+':
-                fprintf(asmFile, "    add rax, rbx\n");
-                break;
-            case '-':
-                fprintf(asmFile, "    sub rax, rbx\n");
-                break;
-            case '*':
-                fprintf(asmFile, "    imul rax, rbx\n");
-                break;
-            case '/':
-                fprintf(asmFile, "    mov rcx, rbx\n");  
-                fprintf(asmFile, "    mov rax, rdx\n");  
-                fprintf(asmFile, "    xor rdx, rdx\n");  
-                fprintf(asmFile, "    idiv rcx\n");   
-                break;
-            default:
-                printf("Error: Unknown binary operator %c\n", node->binaryOp.op);
-                break;
-            }
+        switch (nodeData(node)->binaryOp.op)
+        {
+        case OP_ADD:
+            emitLiteral(out, "    add rax, rbx\n");
+            break;
+        case OP_SUB:
+            emitLiteral(out, "    sub rax, rbx\n");
+            break;
+        case OP_MUL:
+            emitLiteral(out, "    imul rax, rbx\n");
+            break;
+        case OP_DIV:
+            emitLiteral(out, "    cqo\n");  
+            emitLiteral(out, "    idiv rbx\n");   
+            break;
+        default:
+            printf("Error: Unknown binary operator %s\n", opCodeText(nodeData(node)->binaryOp.op));
+            break;
         }
         break;
 
     case NODE_VAR_DECL:
-        printf("Generating code for variable declaration: %s\n", node->varDecl.name);
-        
-        if (node->varDecl.value->type == NODE_STRING_LITERAL) {
-            printf("Variable %s is a string literal\n", node->varDecl.name);
-            generateCode(node->varDecl.value, asmFile);
-            if (asmFile) {
-                fprintf(asmFile, "    mov [%s], rax\n", node->varDecl.name);
-            }
-        } else {
-            generateCode(node->varDecl.value, asmFile);
-            if (asmFile) {
-                fprintf(asmFile, "    mov [%s], rax\n", node->varDecl.name);
-            }
-        }
+        LOG_DEBUG(LOG_CODEGEN, "Generating code for variable declaration: %s\n", internedText(nodeData(node)->varDecl.name));
+        emitFormat(out, "    mov %s, rax\n", variableOperand(nodeData(node)->varDecl.symbol));
         break;
 
     case NODE_ASSIGN:
-        printf("Generating code for assignment: %s\n", node->assign.name);
-        generateCode(node->assign.expr, asmFile);
-        if (asmFile) {
-            fprintf(asmFile, "    mov [%s], rax\n", node->assign.name);
-        }
+        LOG_DEBUG(LOG_CODEGEN, "Generating code for assignment: %s\n", internedText(nodeData(node)->assign.name));
+        emitFormat(out, "    mov %s, rax\n", variableOperand(nodeData(node)->assign.symbol));
         break;
 
     case NODE_PRINT:
-        printf("Generating code for print\n");
-        if (node->print.expr) {
-            generateCode(node->print.expr, asmFile);
-            
-            if (asmFile) {
-                if (node->print.expr->type == NODE_STRING_LITERAL || 
-                    (node->print.expr->type == NODE_VAR_REF && 
-                     getSymbolType(node->print.expr->varRef.name) == TYPE_STRING)) {
-                    fprintf(asmFile, "    mov rdi, rax\n");
-                    fprintf(asmFile, "    call print_str\n");
-                } else if (node->print.expr->type == NODE_BOOLEAN_LITERAL || 
-                          (node->print.expr->type == NODE_VAR_REF && 
-                           getSymbolType(node->print.expr->varRef.name) == TYPE_BOOLEAN)) {
-                    fprintf(asmFile, "    mov rdi, rax\n");
-                    fprintf(asmFile, "    call print_log\n");
-                } else {
-                    fprintf(asmFile, "    mov rdi, rax\n");
-                    fprintf(asmFile, "    call print_num\n");
-                }
-                fprintf(asmFile, "    mov rdi, 1\n");          
-                fprintf(asmFile, "    mov rsi, 10\n");          
-                fprintf(asmFile, "    push rsi\n");             
-                fprintf(asmFile, "    mov rsi, rsp\n");         
-                fprintf(asmFile, "    mov rdx, 1\n");           
-                fprintf(asmFile, "    mov rax, 1\n");          
-                fprintf(asmFile, "    syscall\n");              
-                fprintf(asmFile, "    add rsp, 8\n");          
+        LOG_DEBUG(LOG_CODEGEN, "Generating code for print\n");
+        if (nodeData(node)->print.expr) {
+            VariableType type = nodeValueType(nodeData(node)->print.expr);
+            if (type == TYPE_STRING) {
+                emitLiteral(out, "    mov rdi, rax\n");
+                emitLiteral(out, "    call print_str\n");
+            } else if (type == TYPE_BOOLEAN) {
+                emitLiteral(out, "    mov rdi, rax\n");
+                emitLiteral(out, "    call print_log\n");
+            } else {
+                emitLiteral(out, "    mov rdi, rax\n");
+                emitLiteral(out, "    call print_num\n");
             }
+            emitLiteral(out, "    call print_newline\n");
         }
         break;
 
     case NODE_IF:
-        printf("Generating code for if statement\n");
-        generateCode(node->ifNode.condition, asmFile);
-        fprintf(asmFile, "    cmp rax, 0\n");
-        fprintf(asmFile, "    je .else_%p\n", (void *)node);
-        generateCode(node->ifNode.thenStmt, asmFile);
-        fprintf(asmFile, "    jmp .endif_%p\n", (void *)node);
-        fprintf(asmFile, ".else_%p:\n", (void *)node);
-        generateCode(node->ifNode.elseStmt, asmFile);
-        fprintf(asmFile, ".endif_%p:\n", (void *)node);
+        LOG_DEBUG(LOG_CODEGEN, "Generating code for if statement\n");
+        emitFormat(out, ".endif_%u:\n", currentLabel());
+        openLabelCount--;
         break;
 
     case NODE_WHILE:
-        printf("Generating code for while loop\n");
-        fprintf(asmFile, ".loop_start_%p:\n", (void *)node);
-        generateCode(node->whileNode.condition, asmFile);
-        fprintf(asmFile, "    cmp rax, 0\n");
-        fprintf(asmFile, "    je .loop_end_%p\n", (void *)node);
-        generateCode(node->whileNode.body, asmFile);
-        fprintf(asmFile, "    jmp .loop_start_%p\n", (void *)node);
-        fprintf(asmFile, ".loop_end_%p:\n", (void *)node);
+        emitFormat(out, "    jmp .loop_start_%u\n", currentLabel());
+        emitFormat(out, ".loop_end_%u:\n", currentLabel());
+        openLabelCount--;
         break;
 
     case NODE_LOGICAL_OP:
-        printf("Generating code for logical op: %s\n", node->logicalOp.op);
-        generateCode(node->logicalOp.right, asmFile);
-        fprintf(asmFile, "    push rax\n");
+        LOG_DEBUG(LOG_CODEGEN, "Generating code for logical op: %s\n", opCodeText(nodeData(node)->logicalOp.op));
+        emitLiteral(out, "    mov rbx, rax\n");
+        emitLiteral(out, "    pop rax\n");
         
-        generateCode(node->logicalOp.left, asmFile);
-        
-        fprintf(asmFile, "    pop rbx\n");
-        
-        if (strcmp(node->logicalOp.op, "&&") == 0) {
-            fprintf(asmFile, "    and rax, rbx\n");
-        } else if (strcmp(node->logicalOp.op, "||") == 0) {
-            fprintf(asmFile, "    or rax, rbx\n");
-        } else {
-            printf("Error: Unknown logical operator %s\n", node->logicalOp.op);
+        switch (nodeData(node)->logicalOp.op) {
+        case OP_AND:
+            emitLiteral(out, "    and rax, rbx\n");
+            break;
+        case OP_OR:
+            emitLiteral(out, "    or rax, rbx\n");
+            break;
+        default:
+            printf("Error: Unknown logical operator %s\n", opCodeText(nodeData(node)->logicalOp.op));
+            break;
         }
         break;
 
     case NODE_RELATIONAL_OP:
-        printf("Generating code for relational op: %s\n", node->relOp.op);
-        generateCode(node->relOp.right, asmFile);
-        fprintf(asmFile, "    push rax\n"); 
-        generateCode(node->relOp.left, asmFile);
-        fprintf(asmFile, "    pop rbx\n");
-        fprintf(asmFile, "    cmp rax, rbx\n");    
-        if (strcmp(node->relOp.op, "==") == 0) {
-            fprintf(asmFile, "    sete al\n");
-        } else if (strcmp(node->relOp.op, "!=") == 0) {
-            fprintf(asmFile, "    setne al\n");
-        } else if (strcmp(node->relOp.op, "<") == 0) {
-            fprintf(asmFile, "    setl al\n");
-        } else if (strcmp(node->relOp.op, ">") == 0) {
-            fprintf(asmFile, "    setg al\n");
-        } else if (strcmp(node->relOp.op, "<=") == 0) {
-            fprintf(asmFile, "    setle al\n");
-        } else if (strcmp(node->relOp.op, ">=") == 0) {
-            fprintf(asmFile, "    setge al\n");
+        LOG_DEBUG(LOG_CODEGEN, "Generating code for relational op: %s\n", opCodeText(nodeData(node)->relOp.op));
+        emitLiteral(out, "    mov rbx, rax\n");
+        emitLiteral(out, "    pop rax\n");
+        emitLiteral(out, "    cmp rax, rbx\n");
+        if (setccFor[nodeData(node)->relOp.op]) {
+            emitFormat(out, "    %s al\n", setccFor[nodeData(node)->relOp.op]);
         } else {
-            printf("Error: Unknown relational operator %s\n", node->relOp.op);
+            printf("Error: Unknown relational operator %s\n", opCodeText(nodeData(node)->relOp.op));
         }
         
-        fprintf(asmFile, "    movzx rax, al\n");
+        emitLiteral(out, "    movzx rax, al\n");
         break;
 
     case NODE_STRING_LITERAL:
-        printf("Generating code for string literal: %s\n", node->stringLiteral.value);
-        int strIndex = -1;
-        for (int i = 0; i < stringLiteralCount; i++) {
-            if (strcmp(stringLiterals[i], node->stringLiteral.value) == 0) {
-                strIndex = i;
-                printf("Found existing string literal at index %d\n", strIndex);
-                break;
-            }
-        }
-        if (strIndex == -1) {
-            strIndex = stringLiteralCount;
-            strcpy(stringLiterals[stringLiteralCount], node->stringLiteral.value);
-            stringLiteralCount++;
-            printf("Added string literal: '%s' at index %d\n", node->stringLiteral.value, strIndex);
-        }
-        
-        if (asmFile) {
-            fprintf(asmFile, "    lea rax, [rel str_%d]\n", strIndex);
-        }
+        LOG_DEBUG(LOG_CODEGEN, "Generating code for string literal: %s\n", internedText(nodeData(node)->stringLiteral.value));
+        int strIndex = addStringLiteral(nodeData(node)->stringLiteral.value);
+        emitFormat(out, "    lea rax, [rel str_%d]\n", strIndex);
         break;
 
     case NODE_BOOLEAN_LITERAL:
-        if (asmFile) {
-            if (strcmp(node->booleanLiteral.value, "true") == 0) {
-                fprintf(asmFile, "    mov rax, 1\n");
-            } else {
-                fprintf(asmFile, "    mov rax, 0\n");
-            }
+        if (nodeData(node)->booleanLiteral.value) {
+            emitLiteral(out, "    mov rax, 1\n");
+        } else {
+            emitLiteral(out, "    mov rax, 0\n");
         }
         break;
 
     default:
-        printf("Warning: Unhandled node type %d in code generation\n", node->type);
         break;
     }
-
-    if (node->next) {
-        printf("Processing next node\n");
-        generateCode(node->next, asmFile);
-    } else {
-        printf("No more nodes to process\n");
-    }
 }
 
-void generateAssembly(const char *filename)
-{
-    resetStringLiterals();
-    printf("Opening file for writing: %s\n", filename);
-    
-    FILE *asmFile = fopen(filename, "w");
-    if (!asmFile)
-    {
-        printf("Error: Cannot open ASM file '%s'\n", filename);
-        perror("fopen");
-        exit(1);
-    }
-    
-    printf("File opened successfully\n");
-
-    printf("Symbol count: %d\n", symCount);
-    printf("AST head address: %p\n", (void*)astHead);
+static const AstVisitor codeVisitor = { enterCode, afterChildCode, leaveCode, WALK_NEXT_TAIL };
 
-    if (astHead != NULL) {
-        printf("Collecting data by generating code once...\n");
-        codegenResetVisited();
-        generateCode(astHead, NULL); 
-        printf("First pass completed, collected %d string literals\n", stringLiteralCount);
+/**
+ * @brief Appends the code for a statement list to a buffer.
+ */
+void generateCode(NodeId node, EmitBuffer *out)
+{
+    if (!node) {
+        printf("Warning: Null node in generateCode\n");
+        return;
     }
+    walkAST(node, &codeVisitor, out);
+}
 
-    // Data Section
-    fprintf(asmFile, "section .data\n");
+/**
+ * @brief Writes the .data section: global variables, string literals and the
+ *        boolean strings print_log uses; then the .bss output buffer.
+ *
+ * @param withGlobals 0 when the code keeps every variable in registers or
+ *        stack slots, as the IR backend does.
+ */
+static void emitDataSection(EmitBuffer *out, int withGlobals)
+{
+    emitLiteral(out, "section .data\n");
     
-    // Add variables from symbol table
-    for (int i = 0; i < symCount; i++) {
-        fprintf(asmFile, "    %s: dq 0\n", symTable[i].name);
+    // Add global variables from symbol table; block locals live on the stack
+    for (int i = 0; withGlobals && i < symCount; i++) {
+        if (symTable[i].depth == 0) {
+            emitFormat(out, "    %s: dq 0\n", internedText(symTable[i].name));
+        }
     }
     
     // Add string literals
     for (int i = 0; i < stringLiteralCount; i++) {
-        fprintf(asmFile, "    str_%d: db '%s', 0\n", i, stringLiterals[i]);
+        char label[32];
+        snprintf(label, sizeof(label), "str_%d", i);
+        emitStringConstant(out, label, internedText(stringLiterals[i]), internedLength(stringLiterals[i]));
     }
     
     // Add true/false strings for boolean printing
-    fprintf(asmFile, "    true_str: db 'true', 0\n");
-    fprintf(asmFile, "    false_str: db 'false', 0\n");
-    
-    fprintf(asmFile, "\n");
-
-    // Text Section
-    fprintf(asmFile, "section .text\n");
-    fprintf(asmFile, "    global _start\n");
-
-    // Add print_str function - simplified version
-    fprintf(asmFile, "print_str:\n");
-    fprintf(asmFile, "    push rbp\n");
-    fprintf(asmFile, "    mov rbp, rsp\n");
-    fprintf(asmFile, "    mov rsi, rdi\n");  
-
-    // Print the string character by character
-    fprintf(asmFile, ".print_loop:\n");
-    fprintf(asmFile, "    movzx eax, byte [rsi]\n"); 
-    fprintf(asmFile, "    test al, al\n");           
-    fprintf(asmFile, "    jz .print_done\n");        
-    
-    // Print the character
-    fprintf(asmFile, "    push rsi\n");               
-    fprintf(asmFile, "    mov rdi, 1\n");            
-    fprintf(asmFile, "    mov rdx, 1\n");             
-    fprintf(asmFile, "    lea rsi, [rsi]\n");        
-    fprintf(asmFile, "    mov rax, 1\n");             
-    fprintf(asmFile, "    syscall\n");                
-    fprintf(asmFile, "    pop rsi\n");               
-    
-    // Move to next character
-    fprintf(asmFile, "    inc rsi\n");                
-    fprintf(asmFile, "    jmp .print_loop\n");     
-    
-    fprintf(asmFile, ".print_done:\n");
-    fprintf(asmFile, "    mov rsp, rbp\n");
-    fprintf(asmFile, "    pop rbp\n");
-    fprintf(asmFile, "    ret\n\n");
-
-    // Add print_num function (this is what we call, not print_int)
-    fprintf(asmFile, "print_num:\n");
-    fprintf(asmFile, "    push rbp\n");
-    fprintf(asmFile, "    mov rbp, rsp\n");
-    fprintf(asmFile, "    sub rsp, 32\n");            
-    
-    // Convert number to string
-    fprintf(asmFile, "    mov rax, rdi\n");      
-    fprintf(asmFile, "    lea rsi, [rsp]\n");         
-    fprintf(asmFile, "    add rsi, 31\n");            
-    fprintf(asmFile, "    mov byte [rsi], 0\n");      
-    fprintf(asmFile, "    mov rcx, 10\n");           
-    
-    fprintf(asmFile, ".convert_loop:\n");
-    fprintf(asmFile, "    xor rdx, rdx\n");           
-    fprintf(asmFile, "    div rcx\n");                
-    fprintf(asmFile, "    add dl, '0'\n");            
-    fprintf(asmFile, "    dec rsi\n");                
-    fprintf(asmFile, "    mov [rsi], dl\n");          
-    fprintf(asmFile, "    test rax, rax\n");          
-    fprintf(asmFile, "    jnz .convert_loop\n");      
-    
-    // Print the string
-    fprintf(asmFile, "    mov rdi, rsi\n");          
-    fprintf(asmFile, "    call print_str\n");         
+    emitStringConstant(out, "true_str", "true", 4);
+    emitStringConstant(out, "false_str", "false", 5);
+
+    // Tables for print_num: "00" to "99", and 10^1 to 10^19
+    emitLiteral(out, "    digit_pairs: db '");
+    for (int i = 0; i < 100; i++) {
+        char pair[2] = { (char)('0' + i / 10), (char)('0' + i % 10) };
+        emitBytes(out, pair, 2);
+    }
+    emitLiteral(out, "'\n");
+    emitLiteral(out, "    pow10: dq 10");
+    unsigned long long power = 10;
+    for (int i = 2; i <= 19; i++) {
+        power *= 10;
+        emitFormat(out, ", %llu", power);
+    }
+    emitLiteral(out, "\n");
     
-    fprintf(asmFile, "    mov rsp, rbp\n");
-    fprintf(asmFile, "    pop rbp\n");
-    fprintf(asmFile, "    ret\n\n");
+    emitLiteral(out, "\n");
+
+    // Output buffer shared by the print routines, flushed by out_flush
+    emitLiteral(out, "section .bss\n");
+    emitFormat(out, "    out_buf: resb %d\n", OUTPUT_BUFFER_BYTES);
+    emitLiteral(out, "    out_len: resq 1\n");
+    emitLiteral(out, "\n");
+}
+
+/**
+ * @brief Writes the start of the .text section and the print routines the
+ *        generated code calls.
+ */
+static void emitRuntime(EmitBuffer *out)
+{
+    emitLiteral(out, "section .text\n");
+    emitLiteral(out, "    global _start\n");
+
+    // out_flush writes the buffered output with one syscall
+    emitLiteral(out, "out_flush:\n");
+    emitLiteral(out, "    mov rdx, [rel out_len]\n");
+    emitLiteral(out, "    test rdx, rdx\n");
+    emitLiteral(out, "    jz .flush_done\n");
+    emitLiteral(out, "    lea rsi, [rel out_buf]\n");
+    emitLiteral(out, "    mov rdi, 1\n");
+    emitLiteral(out, "    mov rax, 1\n");
+    emitLiteral(out, "    syscall\n");
+    emitLiteral(out, "    mov qword [rel out_len], 0\n");
+    emitLiteral(out, ".flush_done:\n");
+    emitLiteral(out, "    ret\n\n");
+
+    // out_write appends rdx bytes from rsi to the buffer, flushing it first
+    // if they do not fit; text larger than the whole buffer is written
+    // straight through
+    emitLiteral(out, "out_write:\n");
+    emitLiteral(out, "    mov rax, [rel out_len]\n");
+    emitLiteral(out, "    lea rcx, [rax + rdx]\n");
+    emitFormat(out, "    cmp rcx, %d\n", OUTPUT_BUFFER_BYTES);
+    emitLiteral(out, "    jbe .out_copy\n");
+    emitLiteral(out, "    push rsi\n");
+    emitLiteral(out, "    push rdx\n");
+    emitLiteral(out, "    call out_flush\n");
+    emitLiteral(out, "    pop rdx\n");
+    emitLiteral(out, "    pop rsi\n");
+    emitLiteral(out, "    xor eax, eax\n");
+    emitFormat(out, "    cmp rdx, %d\n", OUTPUT_BUFFER_BYTES);
+    emitLiteral(out, "    jbe .out_copy\n");
+    emitLiteral(out, "    mov rdi, 1\n");
+    emitLiteral(out, "    mov rax, 1\n");
+    emitLiteral(out, "    syscall\n");
+    emitLiteral(out, "    ret\n");
+    emitLiteral(out, ".out_copy:\n");
+    emitLiteral(out, "    lea rdi, [rel out_buf]\n");
+    emitLiteral(out, "    add rdi, rax\n");
+    emitLiteral(out, "    mov rcx, rdx\n");
+    emitLiteral(out, "    rep movsb\n");
+    emitLiteral(out, "    add rax, rdx\n");
+    emitLiteral(out, "    mov [rel out_len], rax\n");
+    emitLiteral(out, "    ret\n\n");
+
+    // print_newline appends a single newline byte
+    emitLiteral(out, "print_newline:\n");
+    emitLiteral(out, "    mov rax, [rel out_len]\n");
+    emitFormat(out, "    cmp rax, %d\n", OUTPUT_BUFFER_BYTES);
+    emitLiteral(out, "    jb .newline_store\n");
+    emitLiteral(out, "    call out_flush\n");
+    emitLiteral(out, "    xor eax, eax\n");
+    emitLiteral(out, ".newline_store:\n");
+    emitLiteral(out, "    lea rcx, [rel out_buf]\n");
+    emitLiteral(out, "    mov byte [rcx + rax], 10\n");
+    emitLiteral(out, "    inc rax\n");
+    emitLiteral(out, "    mov [rel out_len], rax\n");
+    emitLiteral(out, "    ret\n\n");
+
+    // print_str buffers a string constant; its length is stored in the
+    // qword just before its first byte
+    emitLiteral(out, "print_str:\n");
+    emitLiteral(out, "    mov rdx, [rdi - 8]\n");
+    emitLiteral(out, "    mov rsi, rdi\n");
+    emitLiteral(out, "    jmp out_write\n\n");
+
+    // print_num writes a signed 64-bit value straight into the output
+    // buffer. It counts the digits against pow10 so it knows where the last
+    // one goes, then fills backwards two digits at a time from digit_pairs,
+    // dividing by 100 with a multiply by its reciprocal.
+    emitLiteral(out, "print_num:\n");
+    emitLiteral(out, "    mov rax, [rel out_len]\n");
+    emitFormat(out, "    cmp rax, %d\n", OUTPUT_BUFFER_BYTES - 21);
+    emitLiteral(out, "    jbe .num_room\n");
+    emitLiteral(out, "    push rdi\n");
+    emitLiteral(out, "    call out_flush\n");
+    emitLiteral(out, "    pop rdi\n");
+    emitLiteral(out, "    xor eax, eax\n");
+    emitLiteral(out, ".num_room:\n");
+    emitLiteral(out, "    lea r8, [rel out_buf]\n");
+    emitLiteral(out, "    add r8, rax\n");
+    emitLiteral(out, "    mov r10, rdi\n");
+    emitLiteral(out, "    test r10, r10\n");
+    emitLiteral(out, "    jns .num_count\n");
+    emitLiteral(out, "    mov byte [r8], '-'\n");
+    emitLiteral(out, "    inc r8\n");
+    // The magnitude is unsigned, so this is right for INT64_MIN too
+    emitLiteral(out, "    neg r10\n");
+
+    emitLiteral(out, ".num_count:\n");
+    emitLiteral(out, "    mov ecx, 1\n");
+    emitLiteral(out, "    lea r11, [rel pow10]\n");
+    emitLiteral(out, ".count_loop:\n");
+    emitLiteral(out, "    cmp ecx, 20\n");
+    emitLiteral(out, "    je .num_counted\n");
+    emitLiteral(out, "    cmp r10, [r11 + rcx*8 - 8]\n");
+    emitLiteral(out, "    jb .num_counted\n");
+    emitLiteral(out, "    inc ecx\n");
+    emitLiteral(out, "    jmp .count_loop\n");
+    emitLiteral(out, ".num_counted:\n");
+    emitLiteral(out, "    lea rdi, [r8 + rcx]\n");
+    emitLiteral(out, "    lea rax, [rel out_buf]\n");
+    emitLiteral(out, "    mov rdx, rdi\n");
+    emitLiteral(out, "    sub rdx, rax\n");
+    emitLiteral(out, "    mov [rel out_len], rdx\n");
+
+    emitLiteral(out, "    mov r9, 0x28F5C28F5C28F5C3\n");
+    emitLiteral(out, "    lea r11, [rel digit_pairs]\n");
+    emitLiteral(out, ".pair_loop:\n");
+    emitLiteral(out, "    cmp r10, 100\n");
+    emitLiteral(out, "    jb .last_digits\n");
+    // value / 100 == ((value >> 2) * r9) >> 66
+    emitLiteral(out, "    mov rax, r10\n");
+    emitLiteral(out, "    shr rax, 2\n");
+    emitLiteral(out, "    mul r9\n");
+    emitLiteral(out, "    shr rdx, 2\n");
+    emitLiteral(out, "    imul rcx, rdx, 100\n");
+    emitLiteral(out, "    sub r10, rcx\n");
+    emitLiteral(out, "    movzx eax, word [r11 + r10*2]\n");
+    emitLiteral(out, "    sub rdi, 2\n");
+    emitLiteral(out, "    mov [rdi], ax\n");
+    emitLiteral(out, "    mov r10, rdx\n");
+    emitLiteral(out, "    jmp .pair_loop\n");
+    emitLiteral(out, ".last_digits:\n");
+    emitLiteral(out, "    cmp r10, 10\n");
+    emitLiteral(out, "    jb .one_digit\n");
+    emitLiteral(out, "    movzx eax, word [r11 + r10*2]\n");
+    emitLiteral(out, "    mov [rdi - 2], ax\n");
+    emitLiteral(out, "    ret\n");
+    emitLiteral(out, ".one_digit:\n");
+    emitLiteral(out, "    add r10b, '0'\n");
+    emitLiteral(out, "    mov [rdi - 1], r10b\n");
+    emitLiteral(out, "    ret\n\n");
 
     // Add print_log function for boolean values
-    fprintf(asmFile, "print_log:\n");
-    fprintf(asmFile, "    push rbp\n");
-    fprintf(asmFile, "    mov rbp, rsp\n");
+    emitLiteral(out, "print_log:\n");
+    emitLiteral(out, "    push rbp\n");
+    emitLiteral(out, "    mov rbp, rsp\n");
     
     // Check if the value is 0 (false) or non-zero (true)
-    fprintf(asmFile, "    test rdi, rdi\n");
-    fprintf(asmFile, "    jz .print_false\n");
+    emitLiteral(out, "    test rdi, rdi\n");
+    emitLiteral(out, "    jz .print_false\n");
     
     // Print "true"
-    fprintf(asmFile, "    lea rdi, [rel true_str]\n");
-    fprintf(asmFile, "    call print_str\n");
-    fprintf(asmFile, "    jmp .print_log_done\n");
+    emitLiteral(out, "    lea rdi, [rel true_str]\n");
+    emitLiteral(out, "    call print_str\n");
+    emitLiteral(out, "    jmp .print_log_done\n");
     
     // Print "false"
-    fprintf(asmFile, ".print_false:\n");
-    fprintf(asmFile, "    lea rdi, [rel false_str]\n");
-    fprintf(asmFile, "    call print_str\n");
+    emitLiteral(out, ".print_false:\n");
+    emitLiteral(out, "    lea rdi, [rel false_str]\n");
+    emitLiteral(out, "    call print_str\n");
     
-    fprintf(asmFile, ".print_log_done:\n");
-    fprintf(asmFile, "    mov rsp, rbp\n");
-    fprintf(asmFile, "    pop rbp\n");
-    fprintf(asmFile, "    ret\n\n");
+    emitLiteral(out, ".print_log_done:\n");
+    emitLiteral(out, "    mov rsp, rbp\n");
+    emitLiteral(out, "    pop rbp\n");
+    emitLiteral(out, "    ret\n\n");
+}
 
-    // Start of program
-    fprintf(asmFile, "_start:\n");
+/**
+ * @brief Emits the end of the program: flush the output buffer, then exit
+ *        with status 0.
+ */
+void emitExit(EmitBuffer *out)
+{
+    emitLiteral(out, "    call out_flush\n");
+    emitLiteral(out, "    mov rax, 60\n");   
+    emitLiteral(out, "    xor rdi, rdi\n");  
+    emitLiteral(out, "    syscall\n");
+}
 
-    if (astHead != NULL) {
-        printf("Generating code from AST (second pass)...\n");
-        codegenResetVisited(); 
-        generateCode(astHead, asmFile);
-        printf("Code generation from AST completed\n");
-    } else {
-        printf("Warning: AST head is NULL, no code generated\n");
+static FILE *openAssembly(const char *filename)
+{
+    LOG_DEBUG(LOG_CODEGEN, "Opening file for writing: %s\n", filename);
+    
+    FILE *asmFile = fopen(filename, "w");
+    if (!asmFile)
+    {
+        printf("Error: Cannot open ASM file '%s'\n", filename);
+        perror("fopen");
+        exit(1);
     }
-
-    // Exit system call
-    fprintf(asmFile, "    mov rax, 60\n");   
-    fprintf(asmFile, "    xor rdi, rdi\n");  
-    fprintf(asmFile, "    syscall\n");
-
-    // Flush the file buffer to ensure all data is written
-    fflush(asmFile);
+    // Text arrives in whole buffers, so stdio buffering would only add a copy
+    setvbuf(asmFile, NULL, _IONBF, 0);
     
-    printf("Closing file...\n");
+    LOG_DEBUG(LOG_CODEGEN, "File opened successfully\n");
+    return asmFile;
+}
+
+static void closeAssembly(FILE *asmFile, const char *filename)
+{
+    LOG_DEBUG(LOG_CODEGEN, "Closing file...\n");
     if (fclose(asmFile) != 0) {
         printf("Error: Failed to close file\n");
         perror("fclose");
         exit(1);
     }
+    freeEmitBuffer(&textBuffer);
+    freeEmitBuffer(&dataBuffer);
     
-    printf("File closed successfully\n");
-    printf("Assembly file generated at: %s\n", filename);
+    LOG_DEBUG(LOG_CODEGEN, "File closed successfully\n");
+    LOG_INFO(LOG_CODEGEN, "Assembly file generated at: %s\n", filename);
+    LOG_DEBUG(LOG_CODEGEN, "Assembly file size: %zu bytes\n", bytesWritten);
+    if (bytesWritten < 10) {
+        printf("Warning: Assembly file is very small or empty!\n");
+    }
 
-    // Debug output
-    printf("String literal count: %d\n", stringLiteralCount);
-    for (int i = 0; i < stringLiteralCount; i++) {
-        printf("String literal %d: '%s'\n", i, stringLiterals[i]);
+    LOG_DEBUG(LOG_CODEGEN, "String literal count: %d\n", stringLiteralCount);
+    if (LOG_ENABLED(LOG_CODEGEN, LOG_LEVEL_DEBUG)) {
+        for (int i = 0; i < stringLiteralCount; i++) {
+            LOG_DEBUG(LOG_CODEGEN, "String literal %d: '%s'\n", i, internedText(stringLiterals[i]));
+        }
     }
+}
 
-    if (stringLiteralCount > 0) {
-        printf("String literals were added to the data section.\n");
-    } else {
-        printf("Warning: No string literals were added to the data section.\n");
+/**
+ * @brief Generates the assembly for the whole program through the IR.
+ *
+ * The AST is lowered to SSA form, verified, and handed to the IR backend,
+ * which appends the code to the text buffer. The .data section is built
+ * afterwards, when every string literal is known, and both are written to
+ * the file with one call each.
+ */
+void generateAssembly(const char *filename)
+{
+    resetStringLiterals();
+    bytesWritten = 0;
+
+    LOG_DEBUG(LOG_CODEGEN, "Symbol count: %d\n", symCount);
+    LOG_DEBUG(LOG_CODEGEN, "AST head node: %u\n", astHead);
+
+    emitRuntime(&textBuffer);
+
+    // Start of program
+    emitLiteral(&textBuffer, "_start:\n");
+
+    if (astHead == NULL_NODE) {
+        printf("Warning: AST head is NULL, no code generated\n");
     }
-    FILE *checkFile = fopen(filename, "r");
-    if (checkFile) {
-        fseek(checkFile, 0, SEEK_END);
-        long size = ftell(checkFile);
-        fclose(checkFile);
-        printf("Assembly file size: %ld bytes\n", size);
-        
-        if (size < 10) {
-            printf("Warning: Assembly file is very small or empty!\n");
-        }
-    } else {
-        printf("Warning: Could not open assembly file for checking!\n");
+    LOG_DEBUG(LOG_CODEGEN, "Lowering AST to IR...\n");
+    lowerProgram(astHead);
+    verifyIR();
+    emitIRProgram(&textBuffer);
+    LOG_DEBUG(LOG_CODEGEN, "Code generation from IR completed\n");
+
+    emitDataSection(&dataBuffer, 0);
+
+    FILE *asmFile = openAssembly(filename);
+    bytesWritten += flushEmitBuffer(&dataBuffer, asmFile);
+    bytesWritten += flushEmitBuffer(&textBuffer, asmFile);
+    closeAssembly(asmFile, filename);
+    freeIR();
+}
+
+/**
+ * @brief Opens an assembly file for --stream mode and buffers everything
+ *        that precedes the first statement.
+ *
+ * Statements are then emitted one at a time with generateStatement(), and
+ * endStreamingAssembly() appends the .data section once every global and
+ * string literal is known.
+ *
+ * @return The open file, to pass to generateStatement().
+ */
+FILE *beginStreamingAssembly(const char *filename)
+{
+    resetStringLiterals();
+    bytesWritten = 0;
+    FILE *asmFile = openAssembly(filename);
+
+    emitRuntime(&textBuffer);
+    emitLiteral(&textBuffer, "_start:\n");
+    emitLiteral(&textBuffer, "    mov rbp, rsp\n");
+    streamedFrameBytes = 0;
+    return asmFile;
+}
+
+/**
+ * @brief Emits the code for one top-level statement in --stream mode.
+ *
+ * Top-level statements run in order, so the frame for block locals only
+ * has to grow when a statement needs more slots than any before it. The
+ * text buffer is written out whenever it passes STREAM_FLUSH_BYTES, so
+ * memory stays bounded however long the program is.
+ */
+void generateStatement(NodeId node, FILE *asmFile)
+{
+    int frameBytes = (8 * maxLocalSlots + 15) & ~15;
+    if (frameBytes > streamedFrameBytes) {
+        emitFormat(&textBuffer, "    sub rsp, %d\n", frameBytes - streamedFrameBytes);
+        streamedFrameBytes = frameBytes;
+    }
+    codegenResetVisited();
+    generateCode(node, &textBuffer);
+
+    if (textBuffer.length >= STREAM_FLUSH_BYTES) {
+        bytesWritten += flushEmitBuffer(&textBuffer, asmFile);
     }
 }
+
+/**
+ * @brief Finishes a --stream assembly file with the exit call and the .data
+ *        section.
+ */
+void endStreamingAssembly(FILE *asmFile, const char *filename)
+{
+    emitExit(&textBuffer);
+    emitLiteral(&textBuffer, "\n");
+    emitDataSection(&textBuffer, 1);
+    bytesWritten += flushEmitBuffer(&textBuffer, asmFile);
+    closeAssembly(asmFile, filename);
+}
@@ -2,10 +2,23 @@
 #define CODEGEN_H
 
 #include "../ast.h"
+#include "emitter.h"
 
 void generateAssembly(const char *filename);
 
-void generateCode(ASTNode *node, FILE *asmFile);
+FILE *beginStreamingAssembly(const char *filename);
+
+void generateStatement(NodeId node, FILE *asmFile);
+
+void endStreamingAssembly(FILE *asmFile, const char *filename);
+
+void generateCode(NodeId node, EmitBuffer *out);
+
+void emitIRProgram(EmitBuffer *out);
+
+int addStringLiteral(InternId text);
+
+void emitExit(EmitBuffer *out);
 
 void codegenResetVisited();
 
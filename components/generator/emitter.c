@@ -0,0 +1,84 @@
+#include "emitter.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_EMIT_CAPACITY 65536
+
+/**
+ * @brief Makes room for at least extra more bytes plus a terminating NUL.
+ */
+static void reserve(EmitBuffer *buffer, size_t extra) {
+    if (buffer->length + extra < buffer->capacity) {
+        return;
+    }
+    size_t capacity = buffer->capacity ? buffer->capacity : INITIAL_EMIT_CAPACITY;
+    while (buffer->length + extra >= capacity) {
+        capacity *= 2;
+    }
+    char *grown = realloc(buffer->data, capacity);
+    if (!grown) {
+        printf("Fatal error: Memory allocation failed for %zu bytes of assembly\n", capacity);
+        exit(1);
+    }
+    buffer->data = grown;
+    buffer->capacity = capacity;
+}
+
+void emitBytes(EmitBuffer *buffer, const char *text, size_t length) {
+    reserve(buffer, length);
+    memcpy(buffer->data + buffer->length, text, length);
+    buffer->length += length;
+}
+
+void emitText(EmitBuffer *buffer, const char *text) {
+    emitBytes(buffer, text, strlen(text));
+}
+
+/**
+ * @brief Appends printf-style formatted text, formatting straight into the
+ *        buffer.
+ */
+void emitFormat(EmitBuffer *buffer, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer->data ? buffer->data + buffer->length : NULL,
+                           buffer->capacity - buffer->length, format, args);
+    va_end(args);
+    if (length < 0) {
+        printf("Error: Failed to format assembly text\n");
+        exit(1);
+    }
+    if (buffer->length + (size_t)length >= buffer->capacity) {
+        // Did not fit; grow and format again
+        reserve(buffer, (size_t)length);
+        va_start(args, format);
+        vsnprintf(buffer->data + buffer->length, buffer->capacity - buffer->length, format, args);
+        va_end(args);
+    }
+    buffer->length += (size_t)length;
+}
+
+/**
+ * @brief Writes the buffered text to a file in a single call and empties the
+ *        buffer, keeping its capacity.
+ *
+ * @return The number of bytes written.
+ */
+size_t flushEmitBuffer(EmitBuffer *buffer, FILE *file) {
+    size_t length = buffer->length;
+    if (length && fwrite(buffer->data, 1, length, file) != length) {
+        printf("Error: Failed to write %zu bytes of assembly\n", length);
+        perror("fwrite");
+        exit(1);
+    }
+    buffer->length = 0;
+    return length;
+}
+
+void freeEmitBuffer(EmitBuffer *buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
@@ -0,0 +1,23 @@
+#ifndef EMITTER_H
+#define EMITTER_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Growable buffer of assembly text, written to the output file in one call
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} EmitBuffer;
+
+void emitBytes(EmitBuffer *buffer, const char *text, size_t length);
+void emitText(EmitBuffer *buffer, const char *text);
+void emitFormat(EmitBuffer *buffer, const char *format, ...);
+size_t flushEmitBuffer(EmitBuffer *buffer, FILE *file);
+void freeEmitBuffer(EmitBuffer *buffer);
+
+// Appends a string literal without measuring it at run time
+#define emitLiteral(buffer, text) emitBytes((buffer), (text), sizeof(text) - 1)
+
+#endif // EMITTER_H
@@ -0,0 +1,317 @@
+#include "regalloc.h"
+#include "../log.h"
+#include "../memory.h"
+
+// Marks a register the scan decided to spill, until it gets a slot
+#define HOME_SPILLED -2
+
+AllocatorStats allocatorStats = { 0 };
+
+const char *const machineRegisterNames[MACHINE_REGISTERS] = {
+    "rax", "rbx", "rcx", "rdx", "rsi", "rdi", "r8",
+    "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+};
+
+const char *const machineByteNames[MACHINE_REGISTERS] = {
+    "al", "bl", "cl", "dl", "sil", "dil", "r8b",
+    "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"
+};
+
+const unsigned int callClobbered =
+    1u << REG_RAX | 1u << REG_RCX | 1u << REG_RDX | 1u << REG_RSI | 1u << REG_RDI |
+    1u << REG_R8 | 1u << REG_R9 | 1u << REG_R10 | 1u << REG_R11;
+
+// Order registers are tried in. A value live across a print takes the
+// registers the print routines leave alone first; any other value starts
+// with registers no instruction needs, leaving rdx, rax (idiv) and rdi (the
+// print argument) and the call-safe registers for last.
+static const MachineRegister callSafeOrder[MACHINE_REGISTERS] = {
+    REG_RBX, REG_R12, REG_R13, REG_R14, REG_R15, REG_R8, REG_R9,
+    REG_R10, REG_R11, REG_RSI, REG_RCX, REG_RDX, REG_RAX, REG_RDI
+};
+static const MachineRegister defaultOrder[MACHINE_REGISTERS] = {
+    REG_R8, REG_R9, REG_R10, REG_R11, REG_RSI, REG_RCX, REG_RDX,
+    REG_RAX, REG_RDI, REG_RBX, REG_R12, REG_R13, REG_R14, REG_R15
+};
+
+static int *homes = NULL;
+static int homeCapacity = 0;
+
+// Registers with a home, sorted by the start of their interval
+static int *order = NULL;
+static int orderCount = 0;
+
+// Per position scratch: interval starts for the counting sort, then how
+// many print calls come before each position
+static int *positionCounts = NULL;
+static int positionCapacity = 0;
+
+// Min-heap by interval end of the spilled registers holding a slot, and the
+// slots free to reuse
+static int *activeSlots = NULL;
+static int activeSlotCount = 0;
+static int *freeSlots = NULL;
+static int freeSlotCount = 0;
+
+// The registers given each machine register, in start order:
+// occupants[occupantStarts[r]] to [occupantStarts[r + 1] - 1], and how far
+// registerOccupant() has got through them
+static int *occupants = NULL;
+static int occupantStarts[MACHINE_REGISTERS + 1];
+static int occupantCursors[MACHINE_REGISTERS];
+
+static const LiveInterval *currentIntervals = NULL;
+
+static void reserveAllocator(int positions) {
+    if (irProgram.registerCount > homeCapacity) {
+        homeCapacity = irProgram.registerCount;
+        homes = growArray(homes, homeCapacity, sizeof(int), "register homes");
+        order = growArray(order, homeCapacity, sizeof(int), "register homes");
+        activeSlots = growArray(activeSlots, homeCapacity, sizeof(int), "register homes");
+        freeSlots = growArray(freeSlots, homeCapacity, sizeof(int), "register homes");
+        occupants = growArray(occupants, homeCapacity, sizeof(int), "register homes");
+    }
+    if (positions + 1 > positionCapacity) {
+        positionCapacity = positions + 1;
+        positionCounts = growArray(positionCounts, positionCapacity, sizeof(int), "instruction positions");
+    }
+}
+
+/**
+ * @brief Makes every constant an immediate and lists the other defined
+ *        registers in order of interval start, with a counting sort over
+ *        positions.
+ */
+static void sortIntervals(const LiveInterval *intervals, int positions) {
+    int registers = irProgram.registerCount;
+    memset(positionCounts, 0, (positions + 1) * sizeof(int));
+    for (int reg = 0; reg < registers; reg++) {
+        homes[reg] = HOME_IMMEDIATE;
+        if (intervals[reg].start < 0) {
+            continue;
+        }
+        const IrInstruction *definition = irInstruction(irProgram.definitions[reg]);
+        if (definition->op == IR_CONST && fitsImmediate(definition->immediate)) {
+            allocatorStats.immediates++;
+            continue;
+        }
+        homes[reg] = HOME_SPILLED;
+        positionCounts[intervals[reg].start + 1]++;
+    }
+    for (int p = 0; p < positions; p++) {
+        positionCounts[p + 1] += positionCounts[p];
+    }
+    orderCount = positionCounts[positions];
+    for (int reg = 0; reg < registers; reg++) {
+        if (homes[reg] == HOME_SPILLED) {
+            order[positionCounts[intervals[reg].start]++] = reg;
+        }
+    }
+}
+
+/**
+ * @brief Counts the print calls before each position into positionCounts,
+ *        so positionCounts[e] - positionCounts[s + 1] is how many run
+ *        strictly inside [s, e].
+ */
+static void countCalls(int positions) {
+    memset(positionCounts, 0, (positions + 1) * sizeof(int));
+    for (int b = 0; b < irProgram.blockCount; b++) {
+        for (int i = irBlock(b)->first; i != IR_NONE; i = irInstruction(i)->next) {
+            if (irInstruction(i)->op == IR_PRINT) {
+                positionCounts[irInstruction(i)->position + 1]++;
+            }
+        }
+    }
+    for (int p = 0; p < positions; p++) {
+        positionCounts[p + 1] += positionCounts[p];
+    }
+}
+
+static int crossesCall(const LiveInterval *interval) {
+    return interval->end > interval->start + 1 &&
+           positionCounts[interval->end] - positionCounts[interval->start + 1] > 0;
+}
+
+/**
+ * @brief The linear scan of Poletto and Sarkar: visits the intervals by
+ *        start, frees the machine registers of intervals that have ended,
+ *        and gives each interval a free register. With none free, whichever
+ *        of it and the active intervals ends last is spilled.
+ *
+ * An interval may start where another ends: every instruction reads its
+ * operands before it writes its result, and phi copies are parallel.
+ */
+static void scanRegisters(const LiveInterval *intervals) {
+    int active[MACHINE_REGISTERS];
+    for (int r = 0; r < MACHINE_REGISTERS; r++) {
+        active[r] = IR_NONE;
+    }
+
+    for (int i = 0; i < orderCount; i++) {
+        int reg = order[i];
+        const LiveInterval *interval = &intervals[reg];
+        for (int r = 0; r < MACHINE_REGISTERS; r++) {
+            if (active[r] != IR_NONE && intervals[active[r]].end <= interval->start) {
+                active[r] = IR_NONE;
+            }
+        }
+
+        const MachineRegister *preference = crossesCall(interval) ? callSafeOrder : defaultOrder;
+        int chosen = -1;
+        for (int k = 0; k < MACHINE_REGISTERS && chosen == -1; k++) {
+            if (active[preference[k]] == IR_NONE) {
+                chosen = preference[k];
+            }
+        }
+
+        if (chosen == -1) {
+            int victim = 0;
+            for (int r = 1; r < MACHINE_REGISTERS; r++) {
+                if (intervals[active[r]].end > intervals[active[victim]].end) {
+                    victim = r;
+                }
+            }
+            if (intervals[active[victim]].end <= interval->end) {
+                // Ends last itself, so stays in memory
+                allocatorStats.spills++;
+                continue;
+            }
+            homes[active[victim]] = HOME_SPILLED;
+            allocatorStats.spills++;
+            chosen = victim;
+        }
+        homes[reg] = chosen;
+        active[chosen] = reg;
+    }
+}
+
+static void pushActiveSlot(int reg, const LiveInterval *intervals) {
+    int i = activeSlotCount++;
+    while (i > 0 && intervals[activeSlots[(i - 1) / 2]].end > intervals[reg].end) {
+        activeSlots[i] = activeSlots[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    activeSlots[i] = reg;
+}
+
+static void popActiveSlot(const LiveInterval *intervals) {
+    int last = activeSlots[--activeSlotCount];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= activeSlotCount) {
+            break;
+        }
+        if (child + 1 < activeSlotCount &&
+            intervals[activeSlots[child + 1]].end < intervals[activeSlots[child]].end) {
+            child++;
+        }
+        if (intervals[activeSlots[child]].end >= intervals[last].end) {
+            break;
+        }
+        activeSlots[i] = activeSlots[child];
+        i = child;
+    }
+    activeSlots[i] = last;
+}
+
+/**
+ * @brief Gives every spilled register a stack slot, sharing a slot between
+ *        registers whose intervals do not overlap.
+ */
+static void assignSlots(const LiveInterval *intervals) {
+    activeSlotCount = 0;
+    freeSlotCount = 0;
+    for (int i = 0; i < orderCount; i++) {
+        int reg = order[i];
+        if (homes[reg] != HOME_SPILLED) {
+            continue;
+        }
+        while (activeSlotCount > 0 && intervals[activeSlots[0]].end <= intervals[reg].start) {
+            freeSlots[freeSlotCount++] = homes[activeSlots[0]] - MACHINE_REGISTERS;
+            popActiveSlot(intervals);
+        }
+        int slot = freeSlotCount ? freeSlots[--freeSlotCount] : allocatorStats.stackSlots++;
+        homes[reg] = HOME_SLOT(slot);
+        pushActiveSlot(reg, intervals);
+    }
+}
+
+/**
+ * @brief Lists the registers in each machine register by start, for
+ *        registerOccupant().
+ */
+static void listOccupants() {
+    memset(occupantStarts, 0, sizeof(occupantStarts));
+    for (int i = 0; i < orderCount; i++) {
+        if (IS_REGISTER_HOME(homes[order[i]])) {
+            occupantStarts[homes[order[i]] + 1]++;
+        }
+    }
+    for (int r = 0; r < MACHINE_REGISTERS; r++) {
+        occupantStarts[r + 1] += occupantStarts[r];
+        occupantCursors[r] = occupantStarts[r];
+    }
+    for (int i = 0; i < orderCount; i++) {
+        if (IS_REGISTER_HOME(homes[order[i]])) {
+            occupants[occupantCursors[homes[order[i]]]++] = order[i];
+        }
+    }
+    for (int r = 0; r < MACHINE_REGISTERS; r++) {
+        occupantCursors[r] = occupantStarts[r];
+    }
+}
+
+/**
+ * @brief Gives every virtual register a home: a machine register, a stack
+ *        slot when there are not enough registers, or none for a constant,
+ *        which instructions use as an immediate.
+ *
+ * @param intervals The live intervals from computeLiveIntervals().
+ * @return Homes indexed by virtual register, valid until the next call.
+ */
+const int *allocateRegisters(const LiveInterval *intervals) {
+    int positions = numberInstructions();
+    reserveAllocator(positions);
+    memset(&allocatorStats, 0, sizeof(allocatorStats));
+    currentIntervals = intervals;
+
+    sortIntervals(intervals, positions);
+    countCalls(positions);
+    scanRegisters(intervals);
+    assignSlots(intervals);
+    listOccupants();
+
+    allocatorStats.registers = orderCount;
+    LOG_INFO(LOG_CODEGEN, "Register allocation: %d virtual registers, %d spilled to %d stack slots, %d immediates\n",
+             allocatorStats.registers, allocatorStats.spills, allocatorStats.stackSlots, allocatorStats.immediates);
+    return homes;
+}
+
+/**
+ * @brief Returns the virtual register whose interval holds a machine
+ *        register at position, or IR_NONE if it is free there. Calls must
+ *        come in order of position.
+ */
+int registerOccupant(int machineRegister, int position) {
+    int *cursor = &occupantCursors[machineRegister];
+    int end = occupantStarts[machineRegister + 1];
+    while (*cursor < end && currentIntervals[occupants[*cursor]].end < position) {
+        (*cursor)++;
+    }
+    if (*cursor < end && currentIntervals[occupants[*cursor]].start <= position) {
+        return occupants[*cursor];
+    }
+    return IR_NONE;
+}
+
+/**
+ * @brief Returns 1 if a machine register holds a value that was set before
+ *        position and is still needed after it, so an instruction there
+ *        that clobbers the register has to save it.
+ */
+int registerLiveThrough(int machineRegister, int position) {
+    int reg = registerOccupant(machineRegister, position);
+    return reg != IR_NONE && currentIntervals[reg].start < position && currentIntervals[reg].end > position;
+}
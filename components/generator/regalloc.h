@@ -0,0 +1,63 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include <stdint.h>
+#include "../ir/ir.h"
+
+// General-purpose registers the allocator hands out: all but rsp and rbp,
+// which hold the stack and the frame of spill slots
+#define MACHINE_REGISTERS 14
+
+typedef enum {
+    REG_RAX,
+    REG_RBX,
+    REG_RCX,
+    REG_RDX,
+    REG_RSI,
+    REG_RDI,
+    REG_R8,
+    REG_R9,
+    REG_R10,
+    REG_R11,
+    REG_R12,
+    REG_R13,
+    REG_R14,
+    REG_R15
+} MachineRegister;
+
+// Home of a constant, which is used as an immediate and never loaded
+#define HOME_IMMEDIATE -1
+
+// Homes from MACHINE_REGISTERS up are stack slots, [rbp - 8 * (slot + 1)]
+#define HOME_SLOT(slot) (MACHINE_REGISTERS + (slot))
+#define IS_REGISTER_HOME(home) ((home) >= 0 && (home) < MACHINE_REGISTERS)
+#define IS_SLOT_HOME(home) ((home) >= MACHINE_REGISTERS)
+
+// x86-64 instructions take at most a sign-extended 32-bit immediate, so
+// larger constants are loaded into a home like any other value
+static inline int fitsImmediate(long long value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+// What the register allocator did in the current compile
+typedef struct {
+    int registers;      // Virtual registers given a home
+    int immediates;     // Constants used in place, with no home
+    int spills;         // Virtual registers that live in a stack slot
+    int stackSlots;     // Slots those share
+} AllocatorStats;
+
+extern AllocatorStats allocatorStats;
+
+// 64-bit and low byte names of each machine register
+extern const char *const machineRegisterNames[MACHINE_REGISTERS];
+extern const char *const machineByteNames[MACHINE_REGISTERS];
+
+// Bit mask of the registers the print routines may change
+extern const unsigned int callClobbered;
+
+const int *allocateRegisters(const LiveInterval *intervals);
+int registerOccupant(int machineRegister, int position);
+int registerLiveThrough(int machineRegister, int position);
+
+#endif // REGALLOC_H
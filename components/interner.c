@@ -0,0 +1,190 @@
+#include "interner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERN_BLOCK_SIZE 65536
+#define INITIAL_INTERN_SLOTS 1024
+#define INITIAL_INTERN_ENTRIES 256
+
+typedef struct {
+    const char *text;     // NUL-terminated copy owned by the interner
+    unsigned int length;
+    unsigned int hash;
+} InternEntry;
+
+// Bytes of interned strings are bump-allocated from chained blocks
+typedef struct InternBlock {
+    struct InternBlock *next;
+    size_t used;
+    size_t size;
+    char data[];
+} InternBlock;
+
+static InternBlock *blocks = NULL;
+
+// entries[id] describes string id; entries[0] is the reserved INTERN_NONE
+static InternEntry *entries = NULL;
+static unsigned int entryCount = 0;
+static unsigned int entryCapacity = 0;
+
+// Open-addressing table of ids (0 = empty slot), linear probing
+static InternId *slots = NULL;
+static unsigned int slotCapacity = 0;
+
+/**
+ * @brief FNV-1a hash of a byte string.
+ */
+static unsigned int hashBytes(const char *text, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void *internAlloc(size_t size) {
+    void *memory = malloc(size);
+    if (!memory) {
+        printf("Fatal error: Memory allocation failed for %zu bytes in interner\n", size);
+        exit(1);
+    }
+    return memory;
+}
+
+/**
+ * @brief Copies a string into block storage and NUL-terminates it.
+ */
+static const char *storeBytes(const char *text, size_t length) {
+    if (!blocks || blocks->size - blocks->used < length + 1) {
+        size_t size = length + 1 > INTERN_BLOCK_SIZE ? length + 1 : INTERN_BLOCK_SIZE;
+        InternBlock *block = internAlloc(sizeof(InternBlock) + size);
+        block->used = 0;
+        block->size = size;
+        block->next = blocks;
+        blocks = block;
+    }
+    char *copy = blocks->data + blocks->used;
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    blocks->used += length + 1;
+    return copy;
+}
+
+/**
+ * @brief Doubles the slot table and reinserts every id using its stored hash.
+ */
+static void growSlots() {
+    unsigned int newCapacity = slotCapacity ? slotCapacity * 2 : INITIAL_INTERN_SLOTS;
+    InternId *newSlots = internAlloc(newCapacity * sizeof(InternId));
+    memset(newSlots, 0, newCapacity * sizeof(InternId));
+
+    for (unsigned int id = 1; id < entryCount; id++) {
+        unsigned int slot = entries[id].hash & (newCapacity - 1);
+        while (newSlots[slot]) {
+            slot = (slot + 1) & (newCapacity - 1);
+        }
+        newSlots[slot] = id;
+    }
+
+    free(slots);
+    slots = newSlots;
+    slotCapacity = newCapacity;
+}
+
+/**
+ * @brief Returns the id of a string, adding it if it has not been seen.
+ *
+ * @param text The string bytes; they need not be NUL-terminated.
+ * @param length The number of bytes.
+ * @return The string's id, never INTERN_NONE.
+ */
+InternId internString(const char *text, size_t length) {
+    if (!entries) {
+        entryCapacity = INITIAL_INTERN_ENTRIES;
+        entries = internAlloc(entryCapacity * sizeof(InternEntry));
+        entries[0].text = "";
+        entries[0].length = 0;
+        entries[0].hash = 0;
+        entryCount = 1;
+    }
+    // Keep the load factor at or below one half
+    if ((entryCount + 1) * 2 > slotCapacity) {
+        growSlots();
+    }
+
+    unsigned int hash = hashBytes(text, length);
+    unsigned int slot = hash & (slotCapacity - 1);
+    while (slots[slot]) {
+        InternEntry *entry = &entries[slots[slot]];
+        if (entry->hash == hash && entry->length == length && memcmp(entry->text, text, length) == 0) {
+            return slots[slot];
+        }
+        slot = (slot + 1) & (slotCapacity - 1);
+    }
+
+    if (entryCount == entryCapacity) {
+        entryCapacity *= 2;
+        InternEntry *grown = realloc(entries, entryCapacity * sizeof(InternEntry));
+        if (!grown) {
+            printf("Fatal error: Memory allocation failed for %u interned strings\n", entryCapacity);
+            exit(1);
+        }
+        entries = grown;
+    }
+
+    InternId id = entryCount++;
+    entries[id].text = storeBytes(text, length);
+    entries[id].length = (unsigned int)length;
+    entries[id].hash = hash;
+    slots[slot] = id;
+    return id;
+}
+
+/**
+ * @brief Interns a NUL-terminated string.
+ */
+InternId internCString(const char *text) {
+    return internString(text, strlen(text));
+}
+
+/**
+ * @brief Returns the NUL-terminated text of an interned string.
+ */
+const char *internedText(InternId id) {
+    return id < entryCount ? entries[id].text : "";
+}
+
+unsigned int internedLength(InternId id) {
+    return id < entryCount ? entries[id].length : 0;
+}
+
+unsigned int internedHash(InternId id) {
+    return id < entryCount ? entries[id].hash : 0;
+}
+
+/**
+ * @brief Returns the number of distinct strings interned so far.
+ */
+unsigned int internCount() {
+    return entryCount ? entryCount - 1 : 0;
+}
+
+/**
+ * @brief Releases all interned strings. Every id becomes invalid.
+ */
+void freeInterner() {
+    while (blocks) {
+        InternBlock *next = blocks->next;
+        free(blocks);
+        blocks = next;
+    }
+    free(entries);
+    free(slots);
+    entries = NULL;
+    slots = NULL;
+    entryCount = 0;
+    entryCapacity = 0;
+    slotCapacity = 0;
+}
@@ -0,0 +1,21 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <stddef.h>
+
+// Stable 32-bit handle for an interned string. Equal strings always get the
+// same id, so names can be compared and hashed as integers.
+typedef unsigned int InternId;
+
+// Never returned by internString; marks "no name"
+#define INTERN_NONE 0
+
+InternId internString(const char *text, size_t length);
+InternId internCString(const char *text);
+const char *internedText(InternId id);
+unsigned int internedLength(InternId id);
+unsigned int internedHash(InternId id);
+unsigned int internCount();
+void freeInterner();
+
+#endif // INTERNER_H
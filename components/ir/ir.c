@@ -0,0 +1,341 @@
+#include "ir.h"
+#include "../log.h"
+#include "../memory.h"
+
+#define INITIAL_IR_CAPACITY 256
+
+IrProgram irProgram = { 0 };
+
+static const char *const opcodeNames[IR_OPCODE_COUNT] = {
+    [IR_CONST] = "const",
+    [IR_STRING] = "string",
+    [IR_ADD] = "add",
+    [IR_SUB] = "sub",
+    [IR_MUL] = "mul",
+    [IR_DIV] = "div",
+    [IR_EQ] = "eq",
+    [IR_NE] = "ne",
+    [IR_LT] = "lt",
+    [IR_GT] = "gt",
+    [IR_LE] = "le",
+    [IR_GE] = "ge",
+    [IR_AND] = "and",
+    [IR_OR] = "or",
+    [IR_PHI] = "phi",
+    [IR_PRINT] = "print",
+    [IR_JUMP] = "jump",
+    [IR_BRANCH] = "branch",
+    [IR_EXIT] = "exit",
+};
+
+const char *irOpcodeName(IrOpcode op) {
+    return op < IR_OPCODE_COUNT ? opcodeNames[op] : "?";
+}
+
+const char *irTypeName(IrType type) {
+    static const char *const names[] = { "void", "num", "log", "str" };
+    return type >= IR_VOID && type <= IR_STR ? names[type] : "?";
+}
+
+/**
+ * @brief Empties the program, keeping its arrays for the next one.
+ */
+void resetIR() {
+    irProgram.instructionCount = 0;
+    irProgram.blockCount = 0;
+    irProgram.registerCount = 0;
+}
+
+void freeIR() {
+    free(irProgram.instructions);
+    free(irProgram.blocks);
+    free(irProgram.definitions);
+    free(irProgram.aliases);
+    memset(&irProgram, 0, sizeof(irProgram));
+}
+
+/**
+ * @brief Appends an empty block with no predecessors.
+ *
+ * @return The new block's index.
+ */
+int irNewBlock() {
+    irProgram.blocks = reserveArray(irProgram.blocks, irProgram.blockCount, &irProgram.blockCapacity,
+                                    INITIAL_IR_CAPACITY, sizeof(IrBlock), "IR blocks");
+    IrBlock *block = &irProgram.blocks[irProgram.blockCount];
+    block->first = block->last = IR_NONE;
+    block->predCount = 0;
+    return irProgram.blockCount++;
+}
+
+/**
+ * @brief Records an edge from pred to block.
+ *
+ * @return The edge's index in the block's predecessors, which is also the
+ *         operand its phis take along that edge.
+ */
+int irAddPredecessor(int block, int pred) {
+    IrBlock *entry = &irProgram.blocks[block];
+    if (entry->predCount == IR_MAX_PREDECESSORS) {
+        printf("Error: IR block %d has more than %d predecessors\n", block, IR_MAX_PREDECESSORS);
+        exit(1);
+    }
+    entry->preds[entry->predCount] = pred;
+    return entry->predCount++;
+}
+
+/**
+ * @brief Returns the index of pred among a block's predecessors, or IR_NONE.
+ */
+int irPredecessorIndex(int block, int pred) {
+    for (int i = 0; i < irProgram.blocks[block].predCount; i++) {
+        if (irProgram.blocks[block].preds[i] == pred) {
+            return i;
+        }
+    }
+    return IR_NONE;
+}
+
+/**
+ * @brief Appends an instruction to the end of a block, with a new virtual
+ *        register for its result unless type is IR_VOID.
+ *
+ * @return The register defined, or IR_NONE.
+ */
+int irEmit(int block, IrOpcode op, IrType type, int left, int right) {
+    irProgram.instructions = reserveArray(irProgram.instructions, irProgram.instructionCount,
+                                          &irProgram.instructionCapacity, INITIAL_IR_CAPACITY,
+                                          sizeof(IrInstruction), "IR instructions");
+    int index = irProgram.instructionCount++;
+    IrInstruction *instruction = &irProgram.instructions[index];
+    instruction->op = op;
+    instruction->type = type;
+    instruction->dest = IR_NONE;
+    instruction->operands[0] = left;
+    instruction->operands[1] = right;
+    instruction->immediate = 0;
+    instruction->targets[0] = instruction->targets[1] = IR_NONE;
+    instruction->block = block;
+    instruction->next = IR_NONE;
+    instruction->position = -1;
+
+    if (type != IR_VOID) {
+        int capacity = irProgram.registerCapacity;
+        irProgram.definitions = reserveArray(irProgram.definitions, irProgram.registerCount, &capacity,
+                                             INITIAL_IR_CAPACITY, sizeof(int), "IR registers");
+        irProgram.aliases = reserveArray(irProgram.aliases, irProgram.registerCount,
+                                         &irProgram.registerCapacity, INITIAL_IR_CAPACITY, sizeof(int),
+                                         "IR registers");
+        instruction->dest = irProgram.registerCount++;
+        irProgram.definitions[instruction->dest] = index;
+        irProgram.aliases[instruction->dest] = instruction->dest;
+    }
+
+    IrBlock *entry = &irProgram.blocks[block];
+    if (entry->last == IR_NONE) {
+        entry->first = index;
+    } else {
+        irProgram.instructions[entry->last].next = index;
+    }
+    entry->last = index;
+    return instruction->dest;
+}
+
+int irEmitConstant(int block, IrType type, long long value) {
+    int reg = irEmit(block, IR_CONST, type, IR_NONE, IR_NONE);
+    irProgram.instructions[irProgram.definitions[reg]].immediate = value;
+    return reg;
+}
+
+/**
+ * @brief Ends a block with a conditional branch. onFalse may be IR_NONE and
+ *        patched once that block exists.
+ *
+ * @return The branch instruction.
+ */
+int irEmitBranch(int block, int condition, int onTrue, int onFalse) {
+    irEmit(block, IR_BRANCH, IR_VOID, condition, IR_NONE);
+    IrInstruction *branch = &irProgram.instructions[irProgram.instructionCount - 1];
+    branch->targets[0] = onTrue;
+    branch->targets[1] = onFalse;
+    return irProgram.instructionCount - 1;
+}
+
+void irEmitJump(int block, int target) {
+    irEmit(block, IR_JUMP, IR_VOID, IR_NONE, IR_NONE);
+    irProgram.instructions[irProgram.instructionCount - 1].targets[0] = target;
+}
+
+/**
+ * @brief Returns the register that now stands for reg, following
+ *        replacements made by irReplaceRegister().
+ */
+int irResolve(int reg) {
+    int root = reg;
+    while (irProgram.aliases[root] != root) {
+        root = irProgram.aliases[root];
+    }
+    // Point the whole chain at the root so later lookups take one step
+    while (irProgram.aliases[reg] != root) {
+        int next = irProgram.aliases[reg];
+        irProgram.aliases[reg] = root;
+        reg = next;
+    }
+    return root;
+}
+
+/**
+ * @brief Makes every use of reg read replacement instead. Uses already
+ *        emitted are rewritten by irRemoveReplaced().
+ */
+void irReplaceRegister(int reg, int replacement) {
+    irProgram.aliases[reg] = irResolve(replacement);
+}
+
+/**
+ * @brief Drops the instructions whose register was replaced and points
+ *        every operand at the register that replaced it.
+ */
+void irRemoveReplaced() {
+    for (int b = 0; b < irProgram.blockCount; b++) {
+        IrBlock *block = &irProgram.blocks[b];
+        int previous = IR_NONE;
+        for (int i = block->first; i != IR_NONE; i = irProgram.instructions[i].next) {
+            IrInstruction *instruction = &irProgram.instructions[i];
+            if (instruction->dest != IR_NONE && irResolve(instruction->dest) != instruction->dest) {
+                irProgram.definitions[instruction->dest] = IR_NONE;
+                if (previous == IR_NONE) {
+                    block->first = instruction->next;
+                } else {
+                    irProgram.instructions[previous].next = instruction->next;
+                }
+                if (block->last == i) {
+                    block->last = previous;
+                }
+                continue;
+            }
+            for (int k = 0; k < 2; k++) {
+                if (instruction->operands[k] != IR_NONE) {
+                    instruction->operands[k] = irResolve(instruction->operands[k]);
+                }
+            }
+            previous = i;
+        }
+    }
+}
+
+/**
+ * @brief Numbers the instructions in layout order: block by block, first
+ *        to last.
+ *
+ * @return How many instructions were numbered.
+ */
+int numberInstructions() {
+    int position = 0;
+    for (int b = 0; b < irProgram.blockCount; b++) {
+        for (int i = irProgram.blocks[b].first; i != IR_NONE; i = irProgram.instructions[i].next) {
+            irProgram.instructions[i].position = position++;
+        }
+    }
+    return position;
+}
+
+/**
+ * @brief Writes a string literal in double quotes, escaping quotes,
+ *        backslashes and unprintable bytes.
+ */
+static void dumpString(EmitBuffer *out, InternId text) {
+    const char *bytes = internedText(text);
+    unsigned int length = internedLength(text);
+    emitLiteral(out, "\"");
+    for (unsigned int i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)bytes[i];
+        if (c == '"' || c == '\\') {
+            emitFormat(out, "\\%c", c);
+        } else if (c >= ' ' && c <= '~') {
+            emitBytes(out, (const char *)&c, 1);
+        } else {
+            emitFormat(out, "\\x%02x", c);
+        }
+    }
+    emitLiteral(out, "\"");
+}
+
+static void dumpInstruction(EmitBuffer *out, const IrInstruction *instruction) {
+    emitLiteral(out, "    ");
+    if (instruction->dest != IR_NONE) {
+        emitFormat(out, "%%%d:%s = ", instruction->dest, irTypeName(instruction->type));
+    }
+    emitText(out, irOpcodeName(instruction->op));
+
+    switch (instruction->op) {
+        case IR_CONST:
+            emitFormat(out, " %lld", instruction->immediate);
+            break;
+        case IR_STRING:
+            emitLiteral(out, " ");
+            dumpString(out, (InternId)instruction->immediate);
+            break;
+        case IR_PHI: {
+            const IrBlock *block = &irProgram.blocks[instruction->block];
+            for (int i = 0; i < block->predCount; i++) {
+                emitFormat(out, "%s[%%%d, block%d]", i ? ", " : " ", instruction->operands[i], block->preds[i]);
+            }
+            break;
+        }
+        case IR_JUMP:
+            emitFormat(out, " block%d", instruction->targets[0]);
+            break;
+        case IR_BRANCH:
+            emitFormat(out, " %%%d, block%d, block%d", instruction->operands[0],
+                       instruction->targets[0], instruction->targets[1]);
+            break;
+        default:
+            for (int k = 0; k < 2 && instruction->operands[k] != IR_NONE; k++) {
+                emitFormat(out, "%s%%%d", k ? ", " : " ", instruction->operands[k]);
+            }
+            break;
+    }
+    emitLiteral(out, "\n");
+}
+
+/**
+ * @brief Appends the program as text: one labelled group per block, each
+ *        with its predecessors, then one instruction per line.
+ */
+void dumpIR(EmitBuffer *out) {
+    for (int b = 0; b < irProgram.blockCount; b++) {
+        const IrBlock *block = &irProgram.blocks[b];
+        emitFormat(out, "block%d:", b);
+        for (int i = 0; i < block->predCount; i++) {
+            emitFormat(out, "%sblock%d", i ? ", " : "    ; preds ", block->preds[i]);
+        }
+        emitLiteral(out, "\n");
+        for (int i = block->first; i != IR_NONE; i = irProgram.instructions[i].next) {
+            dumpInstruction(out, &irProgram.instructions[i]);
+        }
+    }
+}
+
+/**
+ * @brief Writes the textual dump of the program to a file, for --emit=ir.
+ */
+void writeIR(const char *filename) {
+    EmitBuffer out = { 0 };
+    dumpIR(&out);
+
+    FILE *file = fopen(filename, "w");
+    if (!file) {
+        printf("Error: Cannot open IR file '%s'\n", filename);
+        perror("fopen");
+        exit(1);
+    }
+    flushEmitBuffer(&out, file);
+    if (fclose(file) != 0) {
+        printf("Error: Failed to close file\n");
+        perror("fclose");
+        exit(1);
+    }
+    freeEmitBuffer(&out);
+    LOG_INFO(LOG_IR, "IR written to: %s\n", filename);
+}
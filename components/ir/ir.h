@@ -0,0 +1,135 @@
+#ifndef IR_H
+#define IR_H
+
+#include "../ast.h"
+#include "../generator/emitter.h"
+
+// Marks an absent register, block or instruction
+#define IR_NONE -1
+
+// Control flow is structured, so no block has more than two predecessors
+// and a phi never has more than two operands
+#define IR_MAX_PREDECESSORS 2
+
+// Type of a virtual register. Every value is 64 bits at run time: a signed
+// number, 0 or 1 for a log, or the address of a string constant.
+typedef enum {
+    IR_VOID,
+    IR_NUM,
+    IR_LOG,
+    IR_STR
+} IrType;
+
+typedef enum {
+    IR_CONST,   // dest = immediate
+    IR_STRING,  // dest = address of the string literal whose InternId is immediate
+    IR_ADD,
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,
+    IR_EQ,
+    IR_NE,
+    IR_LT,
+    IR_GT,
+    IR_LE,
+    IR_GE,
+    IR_AND,
+    IR_OR,
+    IR_PHI,     // dest = operands[i] when entered from preds[i]
+    IR_PRINT,   // Prints operands[0] the way its type prints
+    // Terminators, exactly one at the end of every block
+    IR_JUMP,    // Continue at targets[0]
+    IR_BRANCH,  // Continue at targets[0] if operands[0] is not 0, else targets[1]
+    IR_EXIT,    // End of the program
+    IR_OPCODE_COUNT
+} IrOpcode;
+
+typedef struct {
+    IrOpcode op;
+    IrType type;         // Type of dest, IR_VOID if the instruction defines none
+    int dest;            // Virtual register defined, or IR_NONE
+    int operands[2];     // Virtual registers read, or IR_NONE
+    long long immediate;
+    int targets[2];      // Successor blocks of a terminator, or IR_NONE
+    int block;
+    int next;            // Next instruction in the block, or IR_NONE
+    int position;        // Index in layout order, set by numberInstructions()
+} IrInstruction;
+
+typedef struct {
+    int first;           // First instruction, or IR_NONE while empty
+    int last;
+    int preds[IR_MAX_PREDECESSORS];
+    int predCount;
+} IrBlock;
+
+// One program in SSA form. Blocks are laid out in index order and block 0
+// is the entry. Each virtual register has exactly one defining instruction.
+typedef struct {
+    IrInstruction *instructions;
+    int instructionCount;
+    int instructionCapacity;
+    IrBlock *blocks;
+    int blockCount;
+    int blockCapacity;
+    int *definitions;    // Defining instruction of each register, IR_NONE once removed
+    int *aliases;        // Register that replaces each one; itself if none does
+    int registerCount;
+    int registerCapacity;
+} IrProgram;
+
+extern IrProgram irProgram;
+
+// Lifetime of a virtual register in instruction positions: from its first
+// write to the last point its value is still needed, loops included
+typedef struct {
+    int start;           // -1 for a register with no definition
+    int end;
+} LiveInterval;
+
+/**
+ * @brief Returns the instruction with the given index.
+ */
+static inline IrInstruction *irInstruction(int instruction) {
+    return &irProgram.instructions[instruction];
+}
+
+static inline IrBlock *irBlock(int block) {
+    return &irProgram.blocks[block];
+}
+
+/**
+ * @brief Returns the type of a virtual register.
+ */
+static inline IrType irRegisterType(int reg) {
+    return irProgram.instructions[irProgram.definitions[reg]].type;
+}
+
+static inline int irIsTerminator(IrOpcode op) {
+    return op == IR_JUMP || op == IR_BRANCH || op == IR_EXIT;
+}
+
+void resetIR();
+void freeIR();
+int irNewBlock();
+int irAddPredecessor(int block, int pred);
+int irEmit(int block, IrOpcode op, IrType type, int left, int right);
+int irEmitConstant(int block, IrType type, long long value);
+int irEmitBranch(int block, int condition, int onTrue, int onFalse);
+void irEmitJump(int block, int target);
+int irResolve(int reg);
+void irReplaceRegister(int reg, int replacement);
+void irRemoveReplaced();
+int irPredecessorIndex(int block, int pred);
+int numberInstructions();
+const char *irOpcodeName(IrOpcode op);
+const char *irTypeName(IrType type);
+
+void lowerProgram(NodeId root);
+void verifyIR();
+LiveInterval *computeLiveIntervals();
+
+void dumpIR(EmitBuffer *out);
+void writeIR(const char *filename);
+
+#endif // IR_H
@@ -0,0 +1,138 @@
+#include "ir.h"
+#include "../log.h"
+#include "../memory.h"
+
+static LiveInterval *intervals = NULL;
+static int intervalCapacity = 0;
+
+// Per block loop structure: the last block of the loop a header starts
+// (IR_NONE for other blocks), the innermost loop holding each block, and the
+// loop around each loop
+static int *loopEnds = NULL;
+static int *innermostLoops = NULL;
+static int *parentLoops = NULL;
+static int *openLoops = NULL;
+static int loopCapacity = 0;
+
+static void reserveLiveness() {
+    if (irProgram.registerCount > intervalCapacity) {
+        intervalCapacity = irProgram.registerCount;
+        intervals = growArray(intervals, intervalCapacity, sizeof(LiveInterval), "live intervals");
+    }
+    if (irProgram.blockCount > loopCapacity) {
+        loopCapacity = irProgram.blockCount;
+        loopEnds = growArray(loopEnds, loopCapacity, sizeof(int), "liveness blocks");
+        innermostLoops = growArray(innermostLoops, loopCapacity, sizeof(int), "liveness blocks");
+        parentLoops = growArray(parentLoops, loopCapacity, sizeof(int), "liveness blocks");
+        openLoops = growArray(openLoops, loopCapacity, sizeof(int), "liveness blocks");
+    }
+}
+
+static int firstPosition(int block) {
+    return irInstruction(irBlock(block)->first)->position;
+}
+
+static int lastPosition(int block) {
+    return irInstruction(irBlock(block)->last)->position;
+}
+
+/**
+ * @brief Finds the loops: a jump back to an earlier block closes the loop
+ *        that block heads. Loops are properly nested, so one sweep in layout
+ *        order with a stack of open loops gives every block its innermost
+ *        loop.
+ */
+static void findLoops() {
+    int count = irProgram.blockCount;
+    for (int b = 0; b < count; b++) {
+        loopEnds[b] = IR_NONE;
+    }
+    for (int b = 0; b < count; b++) {
+        const IrInstruction *last = irInstruction(irBlock(b)->last);
+        if (last->op == IR_JUMP && last->targets[0] <= b) {
+            loopEnds[last->targets[0]] = b;
+        }
+    }
+    int depth = 0;
+    for (int b = 0; b < count; b++) {
+        while (depth > 0 && loopEnds[openLoops[depth - 1]] < b) {
+            depth--;
+        }
+        if (loopEnds[b] != IR_NONE) {
+            parentLoops[b] = depth ? openLoops[depth - 1] : IR_NONE;
+            openLoops[depth++] = b;
+        }
+        innermostLoops[b] = depth ? openLoops[depth - 1] : IR_NONE;
+    }
+}
+
+static void cover(int reg, int position) {
+    LiveInterval *interval = &intervals[reg];
+    if (interval->start == -1 || position < interval->start) {
+        interval->start = position;
+    }
+    if (position > interval->end) {
+        interval->end = position;
+    }
+}
+
+/**
+ * @brief Records a read of reg at position in block. A register defined
+ *        outside a loop and read inside it must survive every iteration, so
+ *        it lives to the end of each loop around the read that does not
+ *        also hold the definition.
+ */
+static void use(int reg, int position, int block) {
+    cover(reg, position);
+    int definition = irInstruction(irProgram.definitions[reg])->position;
+    for (int loop = innermostLoops[block]; loop != IR_NONE && firstPosition(loop) > definition;
+         loop = parentLoops[loop]) {
+        cover(reg, lastPosition(loopEnds[loop]));
+    }
+}
+
+/**
+ * @brief Computes the live interval of every virtual register over the
+ *        instruction positions set by numberInstructions().
+ *
+ * An interval runs from the register's definition to its last read, and
+ * through the end of any loop it is read in but defined before. A phi's
+ * register is written by the copies at the end of each predecessor, so its
+ * interval also covers those, and each operand is read there.
+ *
+ * @return Intervals indexed by register, valid until the next call. A
+ *         register removed from the program has start -1.
+ */
+LiveInterval *computeLiveIntervals() {
+    reserveLiveness();
+    numberInstructions();
+    findLoops();
+    for (int reg = 0; reg < irProgram.registerCount; reg++) {
+        intervals[reg].start = -1;
+        intervals[reg].end = -1;
+    }
+
+    for (int b = 0; b < irProgram.blockCount; b++) {
+        const IrBlock *block = irBlock(b);
+        for (int i = block->first; i != IR_NONE; i = irInstruction(i)->next) {
+            const IrInstruction *instruction = irInstruction(i);
+            if (instruction->dest != IR_NONE) {
+                cover(instruction->dest, instruction->position);
+            }
+            if (instruction->op == IR_PHI) {
+                for (int p = 0; p < block->predCount; p++) {
+                    int copyPosition = lastPosition(block->preds[p]);
+                    cover(instruction->dest, copyPosition);
+                    use(instruction->operands[p], copyPosition, block->preds[p]);
+                }
+                continue;
+            }
+            for (int k = 0; k < 2; k++) {
+                if (instruction->operands[k] != IR_NONE) {
+                    use(instruction->operands[k], instruction->position, b);
+                }
+            }
+        }
+    }
+    return intervals;
+}
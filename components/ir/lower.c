@@ -0,0 +1,447 @@
+#include "ir.h"
+#include "../ast_walk.h"
+#include "../symbol_table.h"
+#include "../symbol_trail.h"
+#include "../log.h"
+#include "../memory.h"
+
+#define INITIAL_LOWERING_CAPACITY 64
+
+// The phi a loop header gave a symbol
+typedef struct {
+    int symbol;
+    int reg;
+} SymbolValue;
+
+// An if or while the lowering is inside of
+typedef struct {
+    NodeId node;
+    int mark;         // Trail length at the start of the branches, or after the header phis
+    int block;        // Block ending in the if's branch, or the loop header
+    int branch;       // That branch instruction, patched once its false target exists
+    int thenEnd;      // Last block of the then branch
+    int savedBase;    // Registers the then branch left, in registers.saved
+    int savedEnd;
+    int phiBase;      // The loop header's phis, in loopPhis
+    int phiEnd;
+} LoweringFrame;
+
+// Register holding each symbol's value at the current point, in values,
+// IR_NONE before its declaration
+static SymbolTrail registers = { 0 };
+
+static SymbolValue *loopPhis = NULL;
+static int loopPhiCount = 0;
+static int loopPhiCapacity = 0;
+
+static LoopAssignments loops = { 0 };
+
+static LoweringFrame *frames = NULL;
+static int frameCount = 0;
+static int frameCapacity = 0;
+
+// Registers of the expressions lowered but not yet consumed
+static int *values = NULL;
+static int valueCount = 0;
+static int valueCapacity = 0;
+
+// Block that instructions are appended to
+static int currentBlock = 0;
+
+static const IrOpcode opcodeFor[OP_COUNT] = {
+    [OP_ADD] = IR_ADD,
+    [OP_SUB] = IR_SUB,
+    [OP_MUL] = IR_MUL,
+    [OP_DIV] = IR_DIV,
+    [OP_EQ] = IR_EQ,
+    [OP_NE] = IR_NE,
+    [OP_LT] = IR_LT,
+    [OP_GT] = IR_GT,
+    [OP_LE] = IR_LE,
+    [OP_GE] = IR_GE,
+    [OP_AND] = IR_AND,
+    [OP_OR] = IR_OR,
+};
+
+static IrType irTypeOf(VariableType type) {
+    switch (type) {
+        case TYPE_BOOLEAN: return IR_LOG;
+        case TYPE_STRING: return IR_STR;
+        default: return IR_NUM;
+    }
+}
+
+static void pushValue(int reg) {
+    values = reserveArray(values, valueCount, &valueCapacity, INITIAL_LOWERING_CAPACITY, sizeof(int),
+                          "IR lowering values");
+    values[valueCount++] = reg;
+}
+
+static int popValue() {
+    if (valueCount == 0) {
+        printf("Error: IR lowering is missing an expression value\n");
+        exit(1);
+    }
+    return values[--valueCount];
+}
+
+/**
+ * @brief Makes reg the symbol's value from here on, saving the old one on
+ *        the trail.
+ */
+static void setValue(int symbol, int reg) {
+    setSymbolState(&registers, symbol, 1, reg);
+}
+
+/**
+ * @brief Reads a variable: the register holding its value here, or 0 if it
+ *        has none.
+ */
+static int readVariable(int symbol) {
+    if (symbol >= 0 && symbol < symCount && registers.values[symbol] != IR_NONE) {
+        return registers.values[symbol];
+    }
+    LOG_DEBUG(LOG_IR, "Read of symbol %d before any assignment, using 0\n", symbol);
+    return irEmitConstant(currentBlock, symbol >= 0 && symbol < symCount ? irTypeOf(symTable[symbol].type) : IR_NUM, 0);
+}
+
+static LoweringFrame *pushFrame(NodeId node) {
+    frames = reserveArray(frames, frameCount, &frameCapacity, INITIAL_LOWERING_CAPACITY,
+                          sizeof(LoweringFrame), "IR lowering frames");
+    LoweringFrame *frame = &frames[frameCount++];
+    memset(frame, 0, sizeof(*frame));
+    frame->node = node;
+    frame->mark = registers.trailCount;
+    return frame;
+}
+
+/**
+ * @brief Starts a while loop: a header block entered from the current one,
+ *        with a phi for every variable the loop assigns. The phis get their
+ *        second operand when the back edge is added.
+ */
+static void enterLoop(NodeId node) {
+    int range = enterLoopAssignments(&loops);
+    int header = irNewBlock();
+    irAddPredecessor(header, currentBlock);
+    irEmitJump(currentBlock, header);
+    currentBlock = header;
+
+    LoweringFrame *frame = pushFrame(node);
+    frame->block = header;
+    frame->phiBase = loopPhiCount;
+    int epoch = ++registers.epoch;
+    for (int i = loops.ranges[range].first; i < loops.ranges[range].end; i++) {
+        int symbol = loops.symbols[i];
+        if (symbol < 0 || symbol >= symCount || registers.marks[symbol] == epoch) {
+            continue;
+        }
+        registers.marks[symbol] = epoch;
+        // Declared inside the loop, so it never carries a value around it
+        if (registers.values[symbol] == IR_NONE) {
+            continue;
+        }
+        int phi = irEmit(header, IR_PHI, irTypeOf(symTable[symbol].type), registers.values[symbol], IR_NONE);
+        loopPhis = reserveArray(loopPhis, loopPhiCount, &loopPhiCapacity, INITIAL_LOWERING_CAPACITY,
+                                sizeof(SymbolValue), "IR loop phis");
+        loopPhis[loopPhiCount].symbol = symbol;
+        loopPhis[loopPhiCount].reg = phi;
+        loopPhiCount++;
+        setValue(symbol, phi);
+    }
+    frame->phiEnd = loopPhiCount;
+    frame->mark = registers.trailCount;
+}
+
+/**
+ * @brief Closes a loop body with the back edge to the header and fills in
+ *        the header phis. A phi whose variable comes back unchanged is
+ *        replaced by its value on entry.
+ */
+static void closeLoopBody(LoweringFrame *frame) {
+    irEmitJump(currentBlock, frame->block);
+    irAddPredecessor(frame->block, currentBlock);
+    for (int i = frame->phiBase; i < frame->phiEnd; i++) {
+        int phi = loopPhis[i].reg;
+        IrInstruction *instruction = irInstruction(irProgram.definitions[phi]);
+        instruction->operands[1] = registers.values[loopPhis[i].symbol];
+        int back = irResolve(instruction->operands[1]);
+        if (back == phi || back == irResolve(instruction->operands[0])) {
+            irReplaceRegister(phi, instruction->operands[0]);
+        }
+    }
+}
+
+/**
+ * @brief Gives a symbol its value after an if: the same register if both
+ *        branches agree, a phi in the join block if not. Symbols declared
+ *        inside a branch go out of scope and are left alone.
+ */
+static void joinValue(int join, int symbol, int thenValue, int elseValue) {
+    if (thenValue == IR_NONE || elseValue == IR_NONE) {
+        return;
+    }
+    if (irResolve(thenValue) == irResolve(elseValue)) {
+        setValue(symbol, thenValue);
+        return;
+    }
+    // The then branch is the join's first predecessor, the else branch its second
+    setValue(symbol, irEmit(join, IR_PHI, irTypeOf(symTable[symbol].type), thenValue, elseValue));
+}
+
+/**
+ * @brief Ends an if: both branches jump to a new join block, which gets a
+ *        phi for every variable the branches left with different values.
+ */
+static void leaveIf(LoweringFrame *frame) {
+    int elseEnd = currentBlock;
+    int join = irNewBlock();
+    irAddPredecessor(join, frame->thenEnd);
+    irAddPredecessor(join, elseEnd);
+    irEmitJump(frame->thenEnd, join);
+    irEmitJump(elseEnd, join);
+    currentBlock = join;
+
+    int elseBase = registers.savedCount;
+    saveChangedSymbols(&registers, frame->mark);
+    int elseEndValue = registers.savedCount;
+    undoTrail(&registers, frame->mark);
+
+    SymbolState *saved = registers.saved;
+    int epoch = ++registers.epoch;
+    for (int i = frame->savedBase; i < frame->savedEnd; i++) {
+        registers.marks[saved[i].symbol] = epoch;
+        registers.slots[saved[i].symbol] = i;
+    }
+    for (int i = elseBase; i < elseEndValue; i++) {
+        int symbol = saved[i].symbol;
+        int thenValue = registers.values[symbol];
+        if (registers.marks[symbol] == epoch) {
+            thenValue = saved[registers.slots[symbol]].value;
+            saved[registers.slots[symbol]].symbol = -1;
+        }
+        joinValue(join, symbol, thenValue, saved[i].value);
+    }
+    for (int i = frame->savedBase; i < frame->savedEnd; i++) {
+        if (saved[i].symbol >= 0) {
+            joinValue(join, saved[i].symbol, saved[i].value, registers.values[saved[i].symbol]);
+        }
+    }
+    registers.savedCount = frame->savedBase;
+}
+
+static WalkAction enterLowering(NodeId node, void *context) {
+    (void)context;
+    switch (nodeType(node)) {
+        case NODE_WHILE:
+            enterLoop(node);
+            return WALK_CHILDREN;
+
+        case NODE_IF:
+            pushFrame(node);
+            return WALK_CHILDREN;
+
+        case NODE_NUMBER:
+        case NODE_VAR_REF:
+        case NODE_STRING_LITERAL:
+        case NODE_BOOLEAN_LITERAL:
+        case NODE_BINARY_OP:
+        case NODE_LOGICAL_OP:
+        case NODE_RELATIONAL_OP:
+        case NODE_VAR_DECL:
+        case NODE_ASSIGN:
+        case NODE_PRINT:
+            return WALK_CHILDREN;
+
+        default:
+            // Like the stack machine, nothing under it is lowered, but its
+            // next statement still runs
+            LOG_DEBUG(LOG_IR, "Unhandled node type %d in IR lowering\n", nodeType(node));
+            if (isLoopNode(node)) {
+                skipLoopAssignments(&loops);
+            }
+            return WALK_SKIP_CHILDREN;
+    }
+}
+
+static void afterChildLowering(NodeId node, int index, void *context) {
+    (void)context;
+    LoweringFrame *frame = frameCount ? &frames[frameCount - 1] : NULL;
+
+    switch (nodeType(node)) {
+        case NODE_IF:
+            if (index == 0) {
+                int condition = popValue();
+                int thenBlock = irNewBlock();
+                irAddPredecessor(thenBlock, currentBlock);
+                frame->block = currentBlock;
+                frame->branch = irEmitBranch(currentBlock, condition, thenBlock, IR_NONE);
+                frame->mark = registers.trailCount;
+                currentBlock = thenBlock;
+            } else if (index == 1) {
+                frame->thenEnd = currentBlock;
+                frame->savedBase = registers.savedCount;
+                saveChangedSymbols(&registers, frame->mark);
+                frame->savedEnd = registers.savedCount;
+                undoTrail(&registers, frame->mark);
+
+                // An if without else still gets an empty else block, so no
+                // edge runs from a branch straight to a block with phis
+                int elseBlock = irNewBlock();
+                irAddPredecessor(elseBlock, frame->block);
+                irInstruction(frame->branch)->targets[1] = elseBlock;
+                currentBlock = elseBlock;
+            }
+            break;
+
+        case NODE_WHILE:
+            if (index == 0) {
+                int condition = popValue();
+                int body = irNewBlock();
+                irAddPredecessor(body, currentBlock);
+                frame->branch = irEmitBranch(currentBlock, condition, body, IR_NONE);
+                currentBlock = body;
+            } else if (index == 1) {
+                closeLoopBody(frame);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void leaveLowering(NodeId node, void *context) {
+    (void)context;
+    int left, right;
+
+    switch (nodeType(node)) {
+        case NODE_NUMBER:
+            pushValue(irEmitConstant(currentBlock, IR_NUM, nodeData(node)->number));
+            break;
+
+        case NODE_BOOLEAN_LITERAL:
+            pushValue(irEmitConstant(currentBlock, IR_LOG, nodeData(node)->booleanLiteral.value != 0));
+            break;
+
+        case NODE_STRING_LITERAL: {
+            int reg = irEmit(currentBlock, IR_STRING, IR_STR, IR_NONE, IR_NONE);
+            irInstruction(irProgram.definitions[reg])->immediate = nodeData(node)->stringLiteral.value;
+            pushValue(reg);
+            break;
+        }
+
+        case NODE_VAR_REF:
+            pushValue(readVariable(nodeData(node)->varRef.symbol));
+            break;
+
+        case NODE_BINARY_OP:
+            right = popValue();
+            left = popValue();
+            pushValue(irEmit(currentBlock, opcodeFor[nodeData(node)->binaryOp.op], IR_NUM, left, right));
+            break;
+
+        case NODE_RELATIONAL_OP:
+            right = popValue();
+            left = popValue();
+            pushValue(irEmit(currentBlock, opcodeFor[nodeData(node)->relOp.op], IR_LOG, left, right));
+            break;
+
+        case NODE_LOGICAL_OP:
+            right = popValue();
+            left = popValue();
+            pushValue(irEmit(currentBlock, opcodeFor[nodeData(node)->logicalOp.op], IR_LOG, left, right));
+            break;
+
+        case NODE_VAR_DECL: {
+            int symbol = nodeData(node)->varDecl.symbol;
+            int reg = nodeData(node)->varDecl.value
+                          ? popValue()
+                          : irEmitConstant(currentBlock, irTypeOf(nodeData(node)->varDecl.type), 0);
+            if (symbol >= 0 && symbol < symCount) {
+                setValue(symbol, reg);
+            }
+            break;
+        }
+
+        case NODE_ASSIGN:
+            if (nodeData(node)->assign.expr) {
+                int reg = popValue();
+                if (nodeData(node)->assign.symbol >= 0 && nodeData(node)->assign.symbol < symCount) {
+                    setValue(nodeData(node)->assign.symbol, reg);
+                }
+            }
+            break;
+
+        case NODE_PRINT:
+            if (nodeData(node)->print.expr) {
+                irEmit(currentBlock, IR_PRINT, IR_VOID, popValue(), IR_NONE);
+            }
+            break;
+
+        case NODE_IF:
+            leaveIf(&frames[--frameCount]);
+            break;
+
+        case NODE_WHILE: {
+            LoweringFrame *frame = &frames[--frameCount];
+            // After the loop every variable has its header value
+            undoTrail(&registers, frame->mark);
+            int exitBlock = irNewBlock();
+            irAddPredecessor(exitBlock, frame->block);
+            irInstruction(frame->branch)->targets[1] = exitBlock;
+            loopPhiCount = frame->phiBase;
+            currentBlock = exitBlock;
+            break;
+        }
+
+        case NODE_FUNC_CALL:
+        case NODE_COMPARISON_OP:
+            // Not lowered; stands in as 0 so the expression around it still
+            // gets an operand
+            pushValue(irEmitConstant(currentBlock, nodeValueType(node) == TYPE_BOOLEAN ? IR_LOG : IR_NUM, 0));
+            break;
+
+        default:
+            break;
+    }
+}
+
+static const AstVisitor loweringVisitor = { enterLowering, afterChildLowering, leaveLowering, WALK_NEXT_TAIL };
+
+/**
+ * @brief Lowers a checked statement list into irProgram, in SSA form.
+ *
+ * The walk keeps the register holding each variable's value instead of a
+ * memory location, so an assignment only changes which register a symbol
+ * maps to. Control flow is structured, which makes the phis easy to place:
+ * an if joins the values its branches left, and a while loop gives its
+ * header a phi for every variable it assigns, filled in at the back edge.
+ * The branches of an if are undone with the same symbol trail constant
+ * propagation uses.
+ *
+ * Statements the stack machine skips (do-while, for, functions) are skipped
+ * here too; a call in an expression evaluates to 0.
+ *
+ * @param root The statement list; NULL_NODE gives a program that only exits.
+ */
+void lowerProgram(NodeId root) {
+    resetIR();
+    reserveTrailSymbols(&registers);
+    forgetSymbols(&registers, IR_NONE);
+    loopPhiCount = 0;
+    frameCount = 0;
+    valueCount = 0;
+
+    findLoopAssignments(&loops, root);
+
+    currentBlock = irNewBlock();
+    if (root) {
+        walkAST(root, &loweringVisitor, NULL);
+    }
+    irEmit(currentBlock, IR_EXIT, IR_VOID, IR_NONE, IR_NONE);
+    irRemoveReplaced();
+
+    LOG_INFO(LOG_IR, "IR: %d blocks, %d instructions, %d virtual registers\n",
+             irProgram.blockCount, irProgram.instructionCount, irProgram.registerCount);
+}
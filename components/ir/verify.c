@@ -0,0 +1,362 @@
+#include "ir.h"
+#include "../log.h"
+#include "../memory.h"
+#include <stdarg.h>
+
+// Per block scratch for the dominator tree
+static int *rpoIndex = NULL;      // Position in reverse postorder, -1 if unreachable
+static int *rpoOrder = NULL;
+static int *idom = NULL;
+static int *preorder = NULL;      // Entry and exit numbers in the dominator tree
+static int *postorder = NULL;
+static int *firstChild = NULL;
+static int *nextSibling = NULL;
+static int *stackBlocks = NULL;
+static int *stackEdges = NULL;
+static int blockCapacity = 0;
+
+/**
+ * @brief Reports a broken invariant and stops: the IR is built by the
+ *        compiler itself, so this is always a compiler bug.
+ */
+static void verifyFailed(int block, const char *format, ...) {
+    va_list args;
+    printf("Error: IR verification failed in block%d: ", block);
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+    exit(1);
+}
+
+static void reserveBlocks() {
+    if (irProgram.blockCount <= blockCapacity) {
+        return;
+    }
+    int capacity = blockCapacity ? blockCapacity : 64;
+    while (capacity < irProgram.blockCount) {
+        capacity *= 2;
+    }
+    int **arrays[] = { &rpoIndex, &rpoOrder, &idom, &preorder, &postorder,
+                       &firstChild, &nextSibling, &stackBlocks, &stackEdges };
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+        *arrays[i] = growArray(*arrays[i], capacity, sizeof(int), "IR verifier blocks");
+    }
+    blockCapacity = capacity;
+}
+
+static int successorCount(int block) {
+    const IrInstruction *last = irInstruction(irBlock(block)->last);
+    switch (last->op) {
+        case IR_JUMP: return 1;
+        case IR_BRANCH: return 2;
+        default: return 0;
+    }
+}
+
+static int successor(int block, int index) {
+    return irInstruction(irBlock(block)->last)->targets[index];
+}
+
+/**
+ * @brief Checks that every block ends in exactly one terminator, that phis
+ *        come first, and that the edges of the terminators match the
+ *        predecessor lists both ways.
+ */
+static void verifyBlocks() {
+    for (int b = 0; b < irProgram.blockCount; b++) {
+        const IrBlock *block = irBlock(b);
+        if (block->last == IR_NONE) {
+            verifyFailed(b, "empty block");
+        }
+        int seenOther = 0;
+        for (int i = block->first; i != IR_NONE; i = irInstruction(i)->next) {
+            const IrInstruction *instruction = irInstruction(i);
+            if (instruction->block != b) {
+                verifyFailed(b, "instruction %d belongs to block%d", i, instruction->block);
+            }
+            if (irIsTerminator(instruction->op) != (i == block->last)) {
+                verifyFailed(b, "%s is not the last instruction", irOpcodeName(instruction->op));
+            }
+            if (instruction->op == IR_PHI && seenOther) {
+                verifyFailed(b, "phi %%%d follows other instructions", instruction->dest);
+            }
+            seenOther |= instruction->op != IR_PHI;
+        }
+
+        int successors = successorCount(b);
+        for (int s = 0; s < successors; s++) {
+            int target = successor(b, s);
+            if (target < 0 || target >= irProgram.blockCount) {
+                verifyFailed(b, "jumps to missing block %d", target);
+            }
+            if (irPredecessorIndex(target, b) == IR_NONE) {
+                verifyFailed(b, "is not a predecessor of its successor block%d", target);
+            }
+            // Phi copies go at the end of the predecessor, so they must not
+            // run on the path that skips the phis
+            if (successors == 2 && irBlock(target)->predCount != 1) {
+                verifyFailed(b, "critical edge to block%d", target);
+            }
+        }
+        for (int p = 0; p < block->predCount; p++) {
+            int pred = block->preds[p];
+            if (pred < 0 || pred >= irProgram.blockCount || irBlock(pred)->last == IR_NONE ||
+                (successor(pred, 0) != b && (successorCount(pred) < 2 || successor(pred, 1) != b))) {
+                verifyFailed(b, "predecessor block%d does not branch here", pred);
+            }
+        }
+    }
+    if (irBlock(0)->predCount != 0) {
+        verifyFailed(0, "the entry block has predecessors");
+    }
+}
+
+/**
+ * @brief Orders the blocks in reverse postorder from the entry and fails on
+ *        any block the entry cannot reach.
+ */
+static void orderBlocks() {
+    int count = irProgram.blockCount;
+    for (int b = 0; b < count; b++) {
+        rpoIndex[b] = -1;
+    }
+    int depth = 0;
+    int next = count;
+    stackBlocks[depth] = 0;
+    stackEdges[depth++] = 0;
+    rpoIndex[0] = 0;
+    while (depth > 0) {
+        int block = stackBlocks[depth - 1];
+        if (stackEdges[depth - 1] < successorCount(block)) {
+            int target = successor(block, stackEdges[depth - 1]++);
+            if (rpoIndex[target] == -1) {
+                rpoIndex[target] = 0;
+                stackBlocks[depth] = target;
+                stackEdges[depth++] = 0;
+            }
+        } else {
+            rpoOrder[--next] = block;
+            depth--;
+        }
+    }
+    if (next != 0) {
+        for (int b = 0; b < count; b++) {
+            if (rpoIndex[b] == -1) {
+                verifyFailed(b, "unreachable from the entry");
+            }
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        rpoIndex[rpoOrder[i]] = i;
+    }
+}
+
+static int intersect(int a, int b) {
+    while (a != b) {
+        while (rpoIndex[a] > rpoIndex[b]) {
+            a = idom[a];
+        }
+        while (rpoIndex[b] > rpoIndex[a]) {
+            b = idom[b];
+        }
+    }
+    return a;
+}
+
+/**
+ * @brief Builds the dominator tree with the iterative algorithm of Cooper,
+ *        Harvey and Kennedy, then numbers it so dominance is two compares.
+ */
+static void computeDominators() {
+    int count = irProgram.blockCount;
+    for (int b = 0; b < count; b++) {
+        idom[b] = -1;
+        firstChild[b] = -1;
+    }
+    idom[0] = 0;
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 1; i < count; i++) {
+            int block = rpoOrder[i];
+            int newIdom = -1;
+            for (int p = 0; p < irBlock(block)->predCount; p++) {
+                int pred = irBlock(block)->preds[p];
+                if (idom[pred] == -1) {
+                    continue;
+                }
+                newIdom = newIdom == -1 ? pred : intersect(pred, newIdom);
+            }
+            if (idom[block] != newIdom) {
+                idom[block] = newIdom;
+                changed = 1;
+            }
+        }
+    }
+
+    for (int i = count - 1; i > 0; i--) {
+        int block = rpoOrder[i];
+        nextSibling[block] = firstChild[idom[block]];
+        firstChild[idom[block]] = block;
+    }
+    int depth = 0;
+    int number = 0;
+    stackBlocks[depth++] = 0;
+    preorder[0] = number++;
+    while (depth > 0) {
+        int block = stackBlocks[depth - 1];
+        int child = firstChild[block];
+        if (child != -1) {
+            // Unlink the child so the block moves on to the next one
+            firstChild[block] = nextSibling[child];
+            preorder[child] = number++;
+            stackBlocks[depth++] = child;
+        } else {
+            postorder[block] = number++;
+            depth--;
+        }
+    }
+}
+
+static int dominates(int a, int b) {
+    return preorder[a] <= preorder[b] && postorder[b] <= postorder[a];
+}
+
+/**
+ * @brief Checks one operand: it names a defined register of an allowed type
+ *        whose definition dominates the use. A phi operand is used at the
+ *        end of the matching predecessor.
+ */
+static void verifyOperand(const IrInstruction *user, int operand, int reg, IrType expected) {
+    int block = user->block;
+    if (reg < 0 || reg >= irProgram.registerCount || irProgram.definitions[reg] == IR_NONE) {
+        verifyFailed(block, "%s reads undefined register %d", irOpcodeName(user->op), reg);
+    }
+    if (expected != IR_VOID && irRegisterType(reg) != expected) {
+        verifyFailed(block, "%s reads %%%d as %s but it is %s", irOpcodeName(user->op), reg,
+                     irTypeName(expected), irTypeName(irRegisterType(reg)));
+    }
+    const IrInstruction *definition = irInstruction(irProgram.definitions[reg]);
+    int useBlock = user->op == IR_PHI ? irBlock(block)->preds[operand] : block;
+    if (definition->block == useBlock) {
+        if (user->op != IR_PHI && definition->position >= user->position) {
+            verifyFailed(block, "%%%d is used before it is defined", reg);
+        }
+    } else if (!dominates(definition->block, useBlock)) {
+        verifyFailed(block, "definition of %%%d in block%d does not dominate its use",
+                     reg, definition->block);
+    }
+}
+
+/**
+ * @brief Checks every instruction's result and operand types, and that
+ *        each register is defined once, by a live instruction, before every
+ *        use.
+ */
+static void verifyInstructions() {
+    for (int b = 0; b < irProgram.blockCount; b++) {
+        for (int i = irBlock(b)->first; i != IR_NONE; i = irInstruction(i)->next) {
+            const IrInstruction *instruction = irInstruction(i);
+            IrOpcode op = instruction->op;
+            IrType type = instruction->type;
+
+            if ((type == IR_VOID) != (instruction->dest == IR_NONE) ||
+                (instruction->dest != IR_NONE && irProgram.definitions[instruction->dest] != i)) {
+                verifyFailed(b, "%s has a bad destination", irOpcodeName(op));
+            }
+
+            switch (op) {
+                case IR_CONST:
+                    if (type == IR_VOID) {
+                        verifyFailed(b, "const has no type");
+                    }
+                    break;
+                case IR_STRING:
+                    if (type != IR_STR) {
+                        verifyFailed(b, "string is not str");
+                    }
+                    break;
+                case IR_ADD:
+                case IR_SUB:
+                case IR_MUL:
+                case IR_DIV:
+                    if (type != IR_NUM) {
+                        verifyFailed(b, "%s is not num", irOpcodeName(op));
+                    }
+                    verifyOperand(instruction, 0, instruction->operands[0], IR_NUM);
+                    verifyOperand(instruction, 1, instruction->operands[1], IR_NUM);
+                    break;
+                case IR_LT:
+                case IR_GT:
+                case IR_LE:
+                case IR_GE:
+                    if (type != IR_LOG) {
+                        verifyFailed(b, "%s is not log", irOpcodeName(op));
+                    }
+                    verifyOperand(instruction, 0, instruction->operands[0], IR_NUM);
+                    verifyOperand(instruction, 1, instruction->operands[1], IR_NUM);
+                    break;
+                case IR_EQ:
+                case IR_NE:
+                    if (type != IR_LOG) {
+                        verifyFailed(b, "%s is not log", irOpcodeName(op));
+                    }
+                    verifyOperand(instruction, 0, instruction->operands[0], IR_VOID);
+                    verifyOperand(instruction, 1, instruction->operands[1], irRegisterType(instruction->operands[0]));
+                    break;
+                case IR_AND:
+                case IR_OR:
+                    if (type != IR_LOG) {
+                        verifyFailed(b, "%s is not log", irOpcodeName(op));
+                    }
+                    verifyOperand(instruction, 0, instruction->operands[0], IR_LOG);
+                    verifyOperand(instruction, 1, instruction->operands[1], IR_LOG);
+                    break;
+                case IR_PHI:
+                    if (irBlock(b)->predCount < 1) {
+                        verifyFailed(b, "phi %%%d in a block without predecessors", instruction->dest);
+                    }
+                    for (int p = 0; p < irBlock(b)->predCount; p++) {
+                        verifyOperand(instruction, p, instruction->operands[p], type);
+                    }
+                    break;
+                case IR_PRINT:
+                    verifyOperand(instruction, 0, instruction->operands[0], IR_VOID);
+                    break;
+                case IR_BRANCH:
+                    verifyOperand(instruction, 0, instruction->operands[0], IR_VOID);
+                    if (irRegisterType(instruction->operands[0]) == IR_STR) {
+                        verifyFailed(b, "branch on a str");
+                    }
+                    break;
+                case IR_JUMP:
+                case IR_EXIT:
+                    break;
+                default:
+                    verifyFailed(b, "unknown opcode %d", op);
+                    break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Checks that irProgram is well-formed SSA: blocks end in one
+ *        terminator, edges and predecessor lists agree, there are no
+ *        critical edges, every operand has the type its instruction needs,
+ *        and every definition dominates its uses. Exits on the first
+ *        problem.
+ */
+void verifyIR() {
+    if (irProgram.blockCount == 0) {
+        verifyFailed(0, "the program has no blocks");
+    }
+    reserveBlocks();
+    numberInstructions();
+    verifyBlocks();
+    orderBlocks();
+    computeDominators();
+    verifyInstructions();
+    LOG_DEBUG(LOG_IR, "IR verified: %d blocks, %d instructions\n", irProgram.blockCount, irProgram.instructionCount);
+}
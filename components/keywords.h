@@ -0,0 +1,101 @@
+/* Generated by utils/keyword_gen.c -- do not edit. */
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include <stddef.h>
+#include <string.h>
+#include "tokens.h"
+
+#define KEYWORD_TABLE_SIZE 16
+#define KEYWORD_MIN_LENGTH 2
+#define KEYWORD_MAX_LENGTH 5
+
+typedef struct {
+    const char *name;
+    unsigned char length;
+    TokenType type;
+} Keyword;
+
+static const unsigned char keywordAsso[256] = {
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0, 11, 12,  9,  4, 15,  0,  2,  0,  0,  8,  0, 13, 11,
+     4,  0,  4, 13,  8,  0,  0, 14,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+};
+
+static const Keyword keywordTable[KEYWORD_TABLE_SIZE] = {
+    { "num", 3, VAR },
+    { "print", 5, PRINT },
+    { "false", 5, BOOLEAN_LITERAL },
+    { "func", 4, FUNC },
+    { "str", 3, VAR },
+    { "true", 4, BOOLEAN_LITERAL },
+    { "else", 4, ELSE },
+    { "call", 4, CALL },
+    { "if", 2, IF },
+    { "do", 2, DO },
+    { "log", 3, VAR },
+    { "for", 3, FOR },
+    { "while", 5, WHILE },
+    { NULL, 0, UNKNOWN },
+    { NULL, 0, UNKNOWN },
+    { NULL, 0, UNKNOWN },
+};
+
+#ifdef KEYWORD_STRCMP_CHAIN
+/**
+ * @brief The strcmp chain the lexer used before the perfect hash, kept as
+ *        the lexer_bench baseline. text must be NUL-terminated, as yytext is.
+ *
+ * @return The keyword entry, or NULL if the lexeme is not a keyword.
+ */
+static inline const Keyword *lookupKeyword(const char *text, int length) {
+    (void)length;
+    if (strcmp(text, "num") == 0) return &keywordTable[0];
+    if (strcmp(text, "log") == 0) return &keywordTable[10];
+    if (strcmp(text, "str") == 0) return &keywordTable[4];
+    if (strcmp(text, "if") == 0) return &keywordTable[8];
+    if (strcmp(text, "else") == 0) return &keywordTable[6];
+    if (strcmp(text, "while") == 0) return &keywordTable[12];
+    if (strcmp(text, "for") == 0) return &keywordTable[11];
+    if (strcmp(text, "do") == 0) return &keywordTable[9];
+    if (strcmp(text, "func") == 0) return &keywordTable[3];
+    if (strcmp(text, "call") == 0) return &keywordTable[7];
+    if (strcmp(text, "print") == 0) return &keywordTable[1];
+    if (strcmp(text, "true") == 0) return &keywordTable[5];
+    if (strcmp(text, "false") == 0) return &keywordTable[2];
+    return NULL;
+}
+#else
+/**
+ * @brief Maps a lexeme to its keyword entry with one table probe and one memcmp.
+ *
+ * @return The keyword entry, or NULL if the lexeme is not a keyword.
+ */
+static inline const Keyword *lookupKeyword(const char *text, int length) {
+    if (length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH) {
+        return NULL;
+    }
+    unsigned int slot = ((unsigned int)length + keywordAsso[(unsigned char)text[0]] +
+                         keywordAsso[(unsigned char)text[length - 1]]) & (KEYWORD_TABLE_SIZE - 1);
+    const Keyword *keyword = &keywordTable[slot];
+    if (keyword->length == length && memcmp(keyword->name, text, length) == 0) {
+        return keyword;
+    }
+    return NULL;
+}
+#endif
+
+#endif // KEYWORDS_H
@@ -0,0 +1,77 @@
+#include "log.h"
+#include <string.h>
+
+unsigned char logLevels[LOG_CATEGORY_COUNT];
+
+static const char *categoryNames[LOG_CATEGORY_COUNT] = {
+    "driver", "lexer", "parser", "symbols", "semantic", "optimizer", "ir", "codegen"
+};
+
+static const char *levelNames[] = { "off", "info", "debug", "trace" };
+
+static int matchName(const char *text, size_t length, const char *name) {
+    return strlen(name) == length && strncmp(text, name, length) == 0;
+}
+
+static int parseLevel(const char *text, size_t length) {
+    for (int level = LOG_LEVEL_OFF; level <= LOG_LEVEL_TRACE; level++) {
+        if (matchName(text, length, levelNames[level])) {
+            return level;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Sets every category to the same level.
+ */
+void setLogLevel(int level) {
+    if (level > LOG_LEVEL_TRACE) {
+        level = LOG_LEVEL_TRACE;
+    }
+    for (int i = 0; i < LOG_CATEGORY_COUNT; i++) {
+        logLevels[i] = (unsigned char)level;
+    }
+}
+
+/**
+ * @brief Applies a --log= specification.
+ *
+ * The spec is a comma-separated list of items. A bare level ("debug") sets
+ * every category; "category:level" ("parser:trace") sets one.
+ *
+ * @param spec The text after "--log=".
+ * @return 1 if the whole spec was valid, 0 otherwise.
+ */
+int parseLogSpec(const char *spec) {
+    while (*spec) {
+        size_t length = strcspn(spec, ",");
+        const char *colon = memchr(spec, ':', length);
+
+        if (!colon) {
+            int level = parseLevel(spec, length);
+            if (level < 0) {
+                return 0;
+            }
+            setLogLevel(level);
+        } else {
+            int level = parseLevel(colon + 1, length - (size_t)(colon + 1 - spec));
+            int category = -1;
+            for (int i = 0; i < LOG_CATEGORY_COUNT; i++) {
+                if (matchName(spec, (size_t)(colon - spec), categoryNames[i])) {
+                    category = i;
+                }
+            }
+            if (level < 0 || category < 0) {
+                return 0;
+            }
+            logLevels[category] = (unsigned char)level;
+        }
+
+        spec += length;
+        if (*spec == ',') {
+            spec++;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,48 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdio.h>
+
+// Log levels, from least to most verbose
+#define LOG_LEVEL_OFF   0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_DEBUG 2
+#define LOG_LEVEL_TRACE 3
+
+// Highest level compiled into the binary. Build with -DLOG_MAX_LEVEL=0
+// (make LOG_MAX_LEVEL=0) to remove every log statement, arguments included.
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL LOG_LEVEL_TRACE
+#endif
+
+typedef enum {
+    LOG_DRIVER,
+    LOG_LEXER,
+    LOG_PARSER,
+    LOG_SYMBOLS,
+    LOG_SEMANTIC,
+    LOG_OPTIMIZER,
+    LOG_IR,
+    LOG_CODEGEN,
+    LOG_CATEGORY_COUNT
+} LogCategory;
+
+// Runtime level per category, all LOG_LEVEL_OFF until configured
+extern unsigned char logLevels[LOG_CATEGORY_COUNT];
+
+// The first test is a constant, so disabled levels cost nothing at all; the
+// second is a single byte load, so quiet runs never reach printf.
+#define LOG_ENABLED(category, level) \
+    ((level) <= LOG_MAX_LEVEL && logLevels[category] >= (level))
+
+#define LOG_AT(category, level, ...) \
+    do { if (LOG_ENABLED(category, level)) printf(__VA_ARGS__); } while (0)
+
+#define LOG_INFO(category, ...)  LOG_AT(category, LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(category, ...) LOG_AT(category, LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_TRACE(category, ...) LOG_AT(category, LOG_LEVEL_TRACE, __VA_ARGS__)
+
+void setLogLevel(int level);
+int parseLogSpec(const char *spec);
+
+#endif // LOG_H
@@ -1,71 +1,162 @@
 #include <stdlib.h>
+#include <limits.h>
 #include <string.h>
 #include "memory.h"
 
-typedef struct MemoryBlock {
-    void* block;
-    struct MemoryBlock* next;
-} MemoryBlock;
+#define INITIAL_NODE_CAPACITY 256
 
-ASTNode* astHead = NULL;
-ASTNode* astTail = NULL;
-MemoryBlock* memoryBlockHead = NULL;
-Arena* arenaHead = NULL;
+NodeId astHead = NULL_NODE;
+NodePool nodePool = { NULL, NULL, NULL, NULL, NULL, 0, 0, 0 };
 
-void* arenaAlloc(size_t size) {
-    if (size == 0) {
-        printf("Warning: Attempted to allocate 0 bytes\n");
-        size = 1;
-    }
-    
-    void* block = malloc(size);
-    if (!block) {
-        printf("Fatal error: Memory allocation failed for %zu bytes\n", size);
+/**
+ * @brief Doubles the node arrays together.
+ */
+static void growNodePool() {
+    unsigned int capacity = nodePool.capacity ? nodePool.capacity * 2 : INITIAL_NODE_CAPACITY;
+    unsigned char *types = realloc(nodePool.types, capacity * sizeof(unsigned char));
+    NodePayload *payloads = realloc(nodePool.payloads, capacity * sizeof(NodePayload));
+    NodeId *next = realloc(nodePool.next, capacity * sizeof(NodeId));
+    unsigned int *visits = realloc(nodePool.visits, capacity * sizeof(unsigned int));
+    signed char *valueTypes = realloc(nodePool.valueTypes, capacity * sizeof(signed char));
+    if (!types || !payloads || !next || !visits || !valueTypes) {
+        printf("Fatal error: Memory allocation failed for %u AST nodes\n", capacity);
         exit(1);
     }
-    
-    memset(block, 0, size);
-    
-    MemoryBlock* newBlock = malloc(sizeof(MemoryBlock));
-    if (!newBlock) {
-        printf("Fatal error: Memory allocation failed for memory block tracking\n");
-        free(block); 
-        exit(1);
+    nodePool.types = types;
+    nodePool.payloads = payloads;
+    nodePool.next = next;
+    nodePool.visits = visits;
+    nodePool.valueTypes = valueTypes;
+    nodePool.capacity = capacity;
+
+    if (nodePool.count == 0) {
+        // Reserve NULL_NODE
+        nodePool.types[NULL_NODE] = NODE_UNKNOWN;
+        memset(&nodePool.payloads[NULL_NODE], 0, sizeof(NodePayload));
+        nodePool.next[NULL_NODE] = NULL_NODE;
+        nodePool.visits[NULL_NODE] = 0;
+        nodePool.valueTypes[NULL_NODE] = TYPE_UNKNOWN;
+        nodePool.count = 1;
     }
-    
-    newBlock->block = block;
-    newBlock->next = memoryBlockHead;
-    memoryBlockHead = newBlock;
-    
-    return block;
 }
 
-ASTNode* allocateNode(NodeType type) {
-    ASTNode* node = arenaAlloc(sizeof(ASTNode));
-    if (!node) {
-        printf("Error: Failed to allocate memory for AST node\n");
-        exit(1);
+/**
+ * @brief Appends a zeroed node of the given type to the node pool.
+ *
+ * @return The new node's id, never NULL_NODE.
+ */
+NodeId allocateNode(NodeType type) {
+    if (nodePool.count == nodePool.capacity) {
+        growNodePool();
     }
-    
-    memset(node, 0, sizeof(ASTNode)); 
-    node->type = type;
-    node->next = NULL;
-    
+    NodeId node = nodePool.count++;
+    nodePool.types[node] = (unsigned char)type;
+    memset(&nodePool.payloads[node], 0, sizeof(NodePayload));
+    nodePool.next[node] = NULL_NODE;
+    nodePool.visits[node] = 0;
+    nodePool.valueTypes[node] = TYPE_UNKNOWN;
     return node;
 }
 
+/**
+ * @brief Starts a new walk over the AST.
+ *
+ * Every node counts as unvisited for the returned epoch, without touching the
+ * nodes, so starting a walk is O(1). Only one walk may be marking at a time.
+ *
+ * @return The epoch to pass to nodeVisited() and markNodeVisited().
+ */
+unsigned int beginVisit() {
+    if (nodePool.visitEpoch == UINT_MAX) {
+        // Epochs wrapped; clear old marks so none can collide
+        if (nodePool.visits) {
+            memset(nodePool.visits, 0, nodePool.capacity * sizeof(unsigned int));
+        }
+        nodePool.visitEpoch = 0;
+    }
+    return ++nodePool.visitEpoch;
+}
+
+/**
+ * @brief Returns the number of AST nodes allocated, excluding NULL_NODE.
+ */
+unsigned int nodeCount() {
+    return nodePool.count ? nodePool.count - 1 : 0;
+}
+
+/**
+ * @brief Returns the bytes the allocated nodes occupy in the pool.
+ */
+size_t nodePoolBytes() {
+    return (size_t)nodePool.count *
+           (sizeof(unsigned char) + sizeof(NodePayload) + sizeof(NodeId) + sizeof(unsigned int) +
+            sizeof(signed char));
+}
+
+/**
+ * @brief Records the current node pool size.
+ */
+ArenaMark arenaMark() {
+    ArenaMark mark;
+    mark.nodes = nodePool.count;
+    return mark;
+}
+
+/**
+ * @brief Drops every AST node allocated since the mark was taken. Their ids
+ *        will be handed out again, but the pool keeps its capacity.
+ *
+ * @param mark A mark returned by arenaMark() since the last freeArena().
+ */
+void arenaReset(ArenaMark mark) {
+    // A mark taken before the first node still keeps the reserved NULL_NODE
+    unsigned int nodes = mark.nodes ? mark.nodes : 1;
+    if (nodePool.count > nodes) {
+        nodePool.count = nodes;
+    }
+}
+
+/**
+ * @brief Frees the node pool.
+ */
 void freeArena() {
-    MemoryBlock* current = memoryBlockHead;
-    while (current) {
-        MemoryBlock* next = current->next;
-        free(current->block);
-        free(current);
-        current = next;
+    free(nodePool.types);
+    free(nodePool.payloads);
+    free(nodePool.next);
+    free(nodePool.visits);
+    free(nodePool.valueTypes);
+    memset(&nodePool, 0, sizeof(nodePool));
+    astHead = NULL_NODE;
+}
+
+/**
+ * @brief Resizes a growable array to hold capacity elements, exiting if
+ *        there is not enough memory.
+ *
+ * @param what What the elements are, for the error message.
+ * @return The array, possibly moved.
+ */
+void *growArray(void *array, int capacity, size_t size, const char *what) {
+    void *memory = realloc(array, capacity * size);
+    if (!memory) {
+        printf("Fatal error: Memory allocation failed for %d %s\n", capacity, what);
+        exit(1);
     }
-    
-    memoryBlockHead = NULL;
-    arenaHead = NULL;
-    astHead = NULL;
-    astTail = NULL;
+    return memory;
 }
 
+/**
+ * @brief Makes room for one more element in a growable array, doubling its
+ *        capacity, or starting it at initialCapacity, when it is full.
+ *
+ * @return The array, moved if it had to grow.
+ */
+void *reserveArray(void *array, int count, int *capacity, int initialCapacity, size_t size, const char *what) {
+    if (count < *capacity) {
+        return array;
+    }
+    int grown = *capacity ? *capacity * 2 : initialCapacity;
+    array = growArray(array, grown, size, what);
+    *capacity = grown;
+    return array;
+}
@@ -3,12 +3,14 @@
 
 #include "ast.h"
 
-void* arenaAlloc(size_t size);
-ASTNode* allocateNode(NodeType type);
+NodeId allocateNode(NodeType type);
+ArenaMark arenaMark();
+void arenaReset(ArenaMark mark);
 void freeArena();
 
-extern ASTNode* astHead;
-extern ASTNode* astTail;
-extern Arena* arenaHead;
+void *growArray(void *array, int capacity, size_t size, const char *what);
+void *reserveArray(void *array, int count, int *capacity, int initialCapacity, size_t size, const char *what);
+
+extern NodeId astHead;
 
 #endif // MEMORY_H
@@ -0,0 +1,396 @@
+#include "optimizer.h"
+#include "../ast_walk.h"
+#include "../symbol_table.h"
+#include "../symbol_trail.h"
+#include "../log.h"
+#include "../memory.h"
+#include <limits.h>
+
+#define INITIAL_PROPAGATION_CAPACITY 64
+
+// Operands an entry condition can have waiting at once before evaluating it
+// is given up on
+#define MAX_EVALUATION_DEPTH 64
+
+// Values of the operands evaluated so far while evaluating an expression
+// with what is known now, without rewriting it
+typedef struct {
+    long long values[MAX_EVALUATION_DEPTH];
+    int count;
+    int failed;
+} Evaluation;
+
+// An if or loop the propagation is inside of
+typedef struct {
+    NodeId node;
+    int mark;        // Trail length at the start of the branches or loop
+    int condition;   // Constant value of the condition, or -1
+    int branchBase;  // States the then branch left, in state.saved
+    int branchEnd;
+    int range;       // Index of the loop's AssignRange
+} PropagationFrame;
+
+// What is known about every variable, and the trail to undo it by
+static SymbolTrail state = { 0 };
+
+static LoopAssignments loops = { 0 };
+
+static PropagationFrame *frames = NULL;
+static int frameCount = 0;
+static int frameCapacity = 0;
+
+/**
+ * @brief Returns 1 if a variable's values fit an int: numbers and
+ *        booleans. Strings are never propagated.
+ */
+static int tracksValue(int symbol) {
+    return symbol >= 0 && symbol < symCount &&
+           (symTable[symbol].type == TYPE_NUMBER || symTable[symbol].type == TYPE_BOOLEAN);
+}
+
+/**
+ * @brief Records that a variable now holds expr: its value if expr is a
+ *        literal, unknown otherwise.
+ */
+static void assignValue(int symbol, NodeId expr) {
+    if (symbol < 0 || symbol >= symCount) {
+        return;
+    }
+    if (tracksValue(symbol) && nodeType(expr) == NODE_NUMBER) {
+        setSymbolState(&state, symbol, 1, nodeData(expr)->number);
+    } else if (tracksValue(symbol) && nodeType(expr) == NODE_BOOLEAN_LITERAL) {
+        setSymbolState(&state, symbol, 1, nodeData(expr)->booleanLiteral.value);
+    } else {
+        setSymbolState(&state, symbol, 0, 0);
+    }
+}
+
+/**
+ * @brief Forgets every variable a loop assigns, since any iteration may have
+ *        changed it.
+ */
+static void forgetAssigned(int range) {
+    for (int i = loops.ranges[range].first; i < loops.ranges[range].end; i++) {
+        if (loops.symbols[i] >= 0 && loops.symbols[i] < symCount) {
+            setSymbolState(&state, loops.symbols[i], 0, 0);
+        }
+    }
+}
+
+/**
+ * @brief Returns the constant value of a folded condition, or -1.
+ */
+static int conditionValue(NodeId condition) {
+    if (nodeType(condition) == NODE_BOOLEAN_LITERAL) {
+        return nodeData(condition)->booleanLiteral.value != 0;
+    }
+    if (nodeType(condition) == NODE_NUMBER) {
+        return nodeData(condition)->number != 0;
+    }
+    return -1;
+}
+
+/**
+ * @brief Sets a variable to the join of two states: known only if both
+ *        branches left it known with the same value.
+ */
+static void joinValue(int symbol, const SymbolState *a, const SymbolState *b) {
+    if (a->known && b->known && a->value == b->value) {
+        setSymbolState(&state, symbol, 1, a->value);
+    } else {
+        setSymbolState(&state, symbol, 0, 0);
+    }
+}
+
+/**
+ * @brief Merges the states an if's branches left. A constant condition
+ *        keeps only the branch that runs.
+ */
+static void joinBranches(PropagationFrame *frame) {
+    SymbolState *saved;
+    if (frame->condition == 1) {
+        undoTrail(&state, frame->mark);
+        for (int i = frame->branchBase; i < frame->branchEnd; i++) {
+            saved = &state.saved[i];
+            setSymbolState(&state, saved->symbol, saved->known, saved->value);
+        }
+    } else if (frame->condition == -1) {
+        int elseBase = state.savedCount;
+        saveChangedSymbols(&state, frame->mark);
+        int elseEnd = state.savedCount;
+        undoTrail(&state, frame->mark);
+
+        int thenEpoch = ++state.epoch;
+        for (int i = frame->branchBase; i < frame->branchEnd; i++) {
+            state.marks[state.saved[i].symbol] = thenEpoch;
+            state.slots[state.saved[i].symbol] = i;
+        }
+        int joinedEpoch = ++state.epoch;
+        for (int i = elseBase; i < elseEnd; i++) {
+            int symbol = state.saved[i].symbol;
+            if (state.marks[symbol] == thenEpoch) {
+                joinValue(symbol, &state.saved[state.slots[symbol]], &state.saved[i]);
+                state.marks[symbol] = joinedEpoch;
+            } else {
+                // Unchanged by the then branch, so it holds its value from before the if
+                SymbolState before = { symbol, state.values[symbol], state.known[symbol] };
+                joinValue(symbol, &before, &state.saved[i]);
+            }
+        }
+        for (int i = frame->branchBase; i < frame->branchEnd; i++) {
+            int symbol = state.saved[i].symbol;
+            if (state.marks[symbol] == thenEpoch) {
+                SymbolState before = { symbol, state.values[symbol], state.known[symbol] };
+                joinValue(symbol, &state.saved[i], &before);
+            }
+        }
+    }
+    // A false condition keeps the else branch's state as it is
+    state.savedCount = frame->branchBase;
+}
+
+static WalkAction enterEvaluate(NodeId node, void *context) {
+    Evaluation *evaluation = context;
+    switch (nodeType(node)) {
+        case NODE_NUMBER:
+        case NODE_BOOLEAN_LITERAL:
+        case NODE_VAR_REF:
+        case NODE_BINARY_OP:
+        case NODE_LOGICAL_OP:
+        case NODE_RELATIONAL_OP:
+            return evaluation->failed ? WALK_PRUNE : WALK_CHILDREN;
+        default:
+            evaluation->failed = 1;
+            return WALK_PRUNE;
+    }
+}
+
+/**
+ * @brief Applies an operator to the two operands on top of the evaluation.
+ *
+ * @return 0 if the operation could fault or its result does not fit a
+ *         number literal.
+ */
+static int evaluateOperator(Evaluation *evaluation, OpCode op) {
+    long long b = evaluation->values[--evaluation->count];
+    long long a = evaluation->values[--evaluation->count];
+    long long result;
+    switch (op) {
+        case OP_ADD: result = a + b; break;
+        case OP_SUB: result = a - b; break;
+        case OP_MUL: result = a * b; break;
+        case OP_DIV:
+            if (b == 0) {
+                return 0;
+            }
+            result = a / b;
+            break;
+        case OP_EQ: result = a == b; break;
+        case OP_NE: result = a != b; break;
+        case OP_LT: result = a < b; break;
+        case OP_GT: result = a > b; break;
+        case OP_LE: result = a <= b; break;
+        case OP_GE: result = a >= b; break;
+        case OP_AND: result = a && b; break;
+        case OP_OR: result = a || b; break;
+        default: return 0;
+    }
+    if (result < INT_MIN || result > INT_MAX) {
+        return 0;
+    }
+    evaluation->values[evaluation->count++] = result;
+    return 1;
+}
+
+static void leaveEvaluate(NodeId node, void *context) {
+    Evaluation *evaluation = context;
+    if (evaluation->failed) {
+        return;
+    }
+    switch (nodeType(node)) {
+        case NODE_BINARY_OP:
+        case NODE_LOGICAL_OP:
+        case NODE_RELATIONAL_OP:
+            // The operator payloads share one layout
+            evaluation->failed = !evaluateOperator(evaluation, nodeData(node)->binaryOp.op);
+            return;
+        default:
+            break;
+    }
+
+    long long value;
+    if (nodeType(node) == NODE_NUMBER) {
+        value = nodeData(node)->number;
+    } else if (nodeType(node) == NODE_BOOLEAN_LITERAL) {
+        value = nodeData(node)->booleanLiteral.value;
+    } else if (tracksValue(nodeData(node)->varRef.symbol) && state.known[nodeData(node)->varRef.symbol]) {
+        value = state.values[nodeData(node)->varRef.symbol];
+    } else {
+        evaluation->failed = 1;
+        return;
+    }
+    if (evaluation->count == MAX_EVALUATION_DEPTH) {
+        evaluation->failed = 1;
+        return;
+    }
+    evaluation->values[evaluation->count++] = value;
+}
+
+static const AstVisitor evaluateVisitor = { enterEvaluate, NULL, leaveEvaluate, WALK_NEXT_TAIL };
+
+/**
+ * @brief Returns 1 if a loop condition is false with what is known before
+ *        the loop, so the body never runs.
+ */
+static int falseOnEntry(NodeId condition) {
+    Evaluation evaluation;
+    evaluation.count = 0;
+    evaluation.failed = 0;
+    walkAST(condition, &evaluateVisitor, &evaluation);
+    return !evaluation.failed && evaluation.count == 1 && evaluation.values[0] == 0;
+}
+
+static void pushFrame(NodeId node) {
+    frames = reserveArray(frames, frameCount, &frameCapacity, INITIAL_PROPAGATION_CAPACITY,
+                          sizeof(PropagationFrame), "propagation frames");
+    PropagationFrame *frame = &frames[frameCount++];
+    frame->node = node;
+    frame->mark = state.trailCount;
+    frame->condition = -1;
+    frame->branchBase = frame->branchEnd = state.savedCount;
+    frame->range = -1;
+}
+
+/**
+ * @brief Opens a frame for an if or loop. A loop forgets what it assigns
+ *        before its condition, which is evaluated on every iteration.
+ */
+static WalkAction enterPropagate(NodeId node, void *context) {
+    (void)context;
+    if (nodeType(node) == NODE_IF) {
+        pushFrame(node);
+    } else if (isLoopNode(node)) {
+        pushFrame(node);
+        frames[frameCount - 1].range = enterLoopAssignments(&loops);
+        NodeId condition = nodeType(node) == NODE_WHILE ? nodeData(node)->whileNode.condition : NULL_NODE;
+        if (condition && falseOnEntry(condition)) {
+            // Never entered, so the loop is while (false) and assigns nothing
+            memset(nodeData(condition), 0, sizeof(NodePayload));
+            setNodeType(condition, NODE_BOOLEAN_LITERAL);
+            optimizerStats.foldedNodes++;
+        } else {
+            forgetAssigned(frames[frameCount - 1].range);
+        }
+    }
+    return WALK_CHILDREN;
+}
+
+/**
+ * @brief Notes a constant condition, and sets an if's else branch off from
+ *        the state before the then branch.
+ */
+static void afterChildPropagate(NodeId node, int index, void *context) {
+    (void)context;
+    PropagationFrame *frame = &frames[frameCount - 1];
+    if (nodeType(node) == NODE_IF) {
+        if (index == 0) {
+            frame->condition = conditionValue(nodeData(node)->ifNode.condition);
+            frame->mark = state.trailCount;
+        } else if (index == 1) {
+            frame->branchBase = state.savedCount;
+            saveChangedSymbols(&state, frame->mark);
+            frame->branchEnd = state.savedCount;
+            undoTrail(&state, frame->mark);
+        }
+    } else if (nodeType(node) == NODE_WHILE && index == 0) {
+        frame->condition = conditionValue(nodeData(node)->whileNode.condition);
+    }
+}
+
+/**
+ * @brief Replaces a read of a known variable with its value, folds what that
+ *        makes constant, and updates the state after assignments, ifs and
+ *        loops.
+ */
+static void leavePropagate(NodeId node, void *context) {
+    (void)context;
+    switch (nodeType(node)) {
+        case NODE_VAR_REF: {
+            int symbol = nodeData(node)->varRef.symbol;
+            if (!tracksValue(symbol) || !state.known[symbol]) {
+                break;
+            }
+            int value = state.values[symbol];
+            memset(nodeData(node), 0, sizeof(NodePayload));
+            if (symTable[symbol].type == TYPE_BOOLEAN) {
+                setNodeType(node, NODE_BOOLEAN_LITERAL);
+                nodeData(node)->booleanLiteral.value = value;
+            } else {
+                setNodeType(node, NODE_NUMBER);
+                nodeData(node)->number = value;
+            }
+            optimizerStats.propagatedLoads++;
+            break;
+        }
+        case NODE_BINARY_OP:
+        case NODE_LOGICAL_OP:
+        case NODE_RELATIONAL_OP:
+            foldNode(node);
+            break;
+        case NODE_VAR_DECL:
+            assignValue(nodeData(node)->varDecl.symbol, nodeData(node)->varDecl.value);
+            break;
+        case NODE_ASSIGN:
+            assignValue(nodeData(node)->assign.symbol, nodeData(node)->assign.expr);
+            break;
+        case NODE_IF:
+            joinBranches(&frames[frameCount - 1]);
+            frameCount--;
+            break;
+        case NODE_WHILE:
+        case NODE_DO_WHILE:
+        case NODE_FOR:
+        case NODE_FUNC_DEF: {
+            PropagationFrame *frame = &frames[frameCount - 1];
+            if (nodeType(node) == NODE_WHILE && frame->condition == 0) {
+                // The body never runs, so nothing it assigns has changed
+                undoTrail(&state, frame->mark);
+            } else {
+                // Leaves by the condition, as at the start of an iteration
+                forgetAssigned(frame->range);
+            }
+            frameCount--;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static const AstVisitor propagateVisitor = { enterPropagate, afterChildPropagate, leavePropagate, WALK_NEXT_TAIL };
+
+/**
+ * @brief Replaces reads of variables whose value is known at that point with
+ *        the value, and folds the expressions that become constant.
+ *
+ * What is known about each number and boolean variable follows the program
+ * in order: an assignment of a constant makes it known and any other
+ * assignment unknown.
+ * The branches of an if start from the same state and are joined after it,
+ * keeping only values both agree on, unless a constant condition means only
+ * one of them runs. A loop forgets every variable it assigns on entry and
+ * on exit, unless a while condition is already false on entry; that
+ * condition is replaced by false. Symbol state carries over between calls,
+ * so a --stream compile can pass one statement at a time.
+ */
+void propagateConstants(NodeId root) {
+    int before = optimizerStats.propagatedLoads;
+    reserveTrailSymbols(&state);
+    state.trailCount = 0;
+    state.savedCount = 0;
+    frameCount = 0;
+
+    findLoopAssignments(&loops, root);
+    walkAST(root, &propagateVisitor, NULL);
+    LOG_DEBUG(LOG_OPTIMIZER, "Propagated %d constants\n", optimizerStats.propagatedLoads - before);
+}
@@ -0,0 +1,378 @@
+#include "optimizer.h"
+#include "../ast_walk.h"
+#include "../symbol_table.h"
+#include "../log.h"
+#include "../memory.h"
+
+#define INITIAL_DEAD_CODE_CAPACITY 64
+
+// A removed statement keeps its place, retagged, until its list is compacted
+#define DEAD_STATEMENT NODE_UNKNOWN
+
+// A branch of an if, or a loop, the store analysis is inside of
+typedef struct {
+    int serial;     // When it was entered
+    int logStart;   // storeLogCount then, for loops
+} StoreRegion;
+
+// A store nothing has read yet, and when it was made. Stores and region
+// entries share one serial counter.
+typedef struct {
+    NodeId store;
+    int serial;
+    int previous;   // Older pending store to the same variable, or -1
+} PendingStore;
+
+static PendingStore *pendingStores = NULL;
+static int pendingStoreCount = 0;
+static int pendingStoreCapacity = 0;
+static int serial = 0;
+
+// Per symbol: its newest pending store, or -1. Each chain is newest first,
+// so its serials decrease.
+static int *pendingHeads = NULL;
+static int pendingHeadCapacity = 0;
+
+// The symbol of every store, so the pending ones can be found without a
+// scan over the symbol table
+static int *storeLog = NULL;
+static int storeLogCount = 0;
+static int storeLogCapacity = 0;
+
+static StoreRegion *regions = NULL;
+static int regionCount = 0;
+static int regionCapacity = 0;
+
+/**
+ * @brief Sizes pendingHeads for every symbol. New entries start with no
+ *        pending store; after that the analysis leaves them empty between
+ *        calls.
+ */
+static void reservePendingHeads() {
+    if (symCount <= pendingHeadCapacity) {
+        return;
+    }
+    int capacity = pendingHeadCapacity ? pendingHeadCapacity : INITIAL_DEAD_CODE_CAPACITY;
+    while (capacity < symCount) {
+        capacity *= 2;
+    }
+    int *heads = growArray(pendingHeads, capacity, sizeof(int), "pending store chains");
+    for (int i = pendingHeadCapacity; i < capacity; i++) {
+        heads[i] = -1;
+    }
+    pendingHeads = heads;
+    pendingHeadCapacity = capacity;
+}
+
+/**
+ * @brief Returns the constant value of a folded condition, or -1.
+ */
+static int constantCondition(NodeId condition) {
+    if (nodeType(condition) == NODE_BOOLEAN_LITERAL) {
+        return nodeData(condition)->booleanLiteral.value != 0;
+    }
+    if (nodeType(condition) == NODE_NUMBER) {
+        return nodeData(condition)->number != 0;
+    }
+    return -1;
+}
+
+/**
+ * @brief Returns child slot index of a node if it holds a statement list,
+ *        or NULL if it holds an expression or nothing.
+ */
+static NodeId *statementSlot(NodeId node, int index) {
+    NodePayload *data = nodeData(node);
+    switch (nodeType(node)) {
+        case NODE_IF:
+            return index == 1 ? &data->ifNode.thenStmt : index == 2 ? &data->ifNode.elseStmt : NULL;
+        case NODE_WHILE:
+            return index == 1 ? &data->whileNode.body : NULL;
+        case NODE_DO_WHILE:
+            return index == 0 ? &data->doWhileNode.body : NULL;
+        case NODE_FOR:
+            switch (index) {
+                case 0: return &data->forNode.initialization;
+                case 2: return &data->forNode.body;
+                case 3: return &data->forNode.increment;
+            }
+            return NULL;
+        case NODE_FUNC_DEF:
+            return index == 1 ? &data->funcDef.body : NULL;
+        default:
+            return NULL;
+    }
+}
+
+static WalkAction enterCountStatement(NodeId node, void *context) {
+    if (nodeType(node) < NODE_ASSIGN || nodeType(node) == NODE_FUNC_CALL) {
+        // Expressions hold no statements
+        return WALK_SKIP_CHILDREN;
+    }
+    (*(int *)context)++;
+    return WALK_CHILDREN;
+}
+
+static const AstVisitor countStatementVisitor = { enterCountStatement, NULL, NULL, WALK_NEXT_TAIL };
+
+/**
+ * @brief Returns how many statements a list holds, counting the ones nested
+ *        in its ifs and loops.
+ */
+static int countStatements(NodeId head) {
+    int count = 0;
+    if (head) {
+        walkAST(head, &countStatementVisitor, &count);
+    }
+    return count;
+}
+
+static void appendStatement(NodeId *first, NodeId *last, NodeId node) {
+    if (*last) {
+        setNodeNext(*last, node);
+    } else {
+        *first = node;
+    }
+    *last = node;
+}
+
+/**
+ * @brief Rebuilds a statement list without its dead statements.
+ *
+ * Removed stores are dropped, an if with a constant condition is replaced
+ * by the branch that runs, and an if with no branches left or a while that
+ * never runs is dropped. Every branch in the list has been compacted
+ * already.
+ *
+ * @return The new head of the list, NULL_NODE if nothing is left.
+ */
+static NodeId compactList(NodeId head) {
+    NodeId first = NULL_NODE;
+    NodeId last = NULL_NODE;
+
+    for (NodeId node = head; node; ) {
+        NodeId next = nodeNext(node);
+        NodePayload *data = nodeData(node);
+        int condition;
+
+        if (nodeType(node) == DEAD_STATEMENT) {
+            // Counted when it was removed
+        } else if (nodeType(node) == NODE_IF && (condition = constantCondition(data->ifNode.condition)) != -1) {
+            NodeId branch = condition ? data->ifNode.thenStmt : data->ifNode.elseStmt;
+            optimizerStats.removedStatements += 1 + countStatements(condition ? data->ifNode.elseStmt
+                                                                          : data->ifNode.thenStmt);
+            while (branch) {
+                NodeId after = nodeNext(branch);
+                appendStatement(&first, &last, branch);
+                branch = after;
+            }
+        } else if (nodeType(node) == NODE_IF && !data->ifNode.thenStmt && !data->ifNode.elseStmt &&
+                   isPureExpression(data->ifNode.condition)) {
+            optimizerStats.removedStatements++;
+        } else if (nodeType(node) == NODE_WHILE && constantCondition(data->whileNode.condition) == 0) {
+            optimizerStats.removedStatements += 1 + countStatements(data->whileNode.body);
+        } else {
+            appendStatement(&first, &last, node);
+        }
+        node = next;
+    }
+
+    if (last) {
+        setNodeNext(last, NULL_NODE);
+    }
+    return first;
+}
+
+static void leaveCompact(NodeId node, void *context) {
+    (void)context;
+    int count = nodeChildCount(node);
+    for (int i = 0; i < count; i++) {
+        NodeId *slot = statementSlot(node, i);
+        if (slot) {
+            *slot = compactList(*slot);
+        }
+    }
+}
+
+static const AstVisitor compactVisitor = { NULL, NULL, leaveCompact, WALK_NEXT_TAIL };
+
+/**
+ * @brief Compacts every statement list under root, innermost first.
+ *
+ * @return The new head of the root list.
+ */
+static NodeId compactStatements(NodeId root) {
+    walkAST(root, &compactVisitor, NULL);
+    return compactList(root);
+}
+
+/**
+ * @brief Removes a store nothing reads, unless evaluating its value could
+ *        fault or call something.
+ */
+static void removeStore(NodeId store) {
+    if (nodeType(store) == DEAD_STATEMENT) {
+        return;
+    }
+    NodeId value = nodeType(store) == NODE_ASSIGN ? nodeData(store)->assign.expr : nodeData(store)->varDecl.value;
+    if (!isPureExpression(value)) {
+        return;
+    }
+    optimizerStats.removedStatements++;
+    LOG_DEBUG(LOG_OPTIMIZER, "Removing dead store to '%s'\n",
+              internedText(nodeType(store) == NODE_ASSIGN ? nodeData(store)->assign.name
+                                                          : nodeData(store)->varDecl.name));
+    setNodeType(store, DEAD_STATEMENT);
+}
+
+static void pushRegion() {
+    regions = reserveArray(regions, regionCount, &regionCapacity, INITIAL_DEAD_CODE_CAPACITY,
+                           sizeof(StoreRegion), "store regions");
+    regions[regionCount].serial = ++serial;
+    regions[regionCount].logStart = storeLogCount;
+    regionCount++;
+}
+
+/**
+ * @brief Drops a variable's pending stores made after a serial, removing
+ *        them as dead or keeping them as read.
+ */
+static void dropPendingAfter(int symbol, int after, int dead) {
+    int entry = pendingHeads[symbol];
+    while (entry != -1 && pendingStores[entry].serial > after) {
+        if (dead) {
+            removeStore(pendingStores[entry].store);
+        }
+        entry = pendingStores[entry].previous;
+    }
+    pendingHeads[symbol] = entry;
+}
+
+/**
+ * @brief Records a store. An earlier store to the same variable that nothing
+ *        has read is dead if this one runs whenever it did, that is, if this
+ *        store's branch or loop was entered before the earlier one was made.
+ */
+static void recordStore(NodeId store, int symbol) {
+    if (symbol < 0 || symbol >= symCount) {
+        return;
+    }
+    if (nodeType(store) == NODE_ASSIGN && nodeType(nodeData(store)->assign.expr) == NODE_VAR_REF &&
+        nodeData(nodeData(store)->assign.expr)->varRef.symbol == symbol) {
+        // x = x stores what is already there
+        removeStore(store);
+        return;
+    }
+    dropPendingAfter(symbol, regionCount ? regions[regionCount - 1].serial : 0, 1);
+
+    pendingStores = reserveArray(pendingStores, pendingStoreCount, &pendingStoreCapacity,
+                                 INITIAL_DEAD_CODE_CAPACITY, sizeof(PendingStore), "pending stores");
+    pendingStores[pendingStoreCount].store = store;
+    pendingStores[pendingStoreCount].serial = ++serial;
+    pendingStores[pendingStoreCount].previous = pendingHeads[symbol];
+    pendingHeads[symbol] = pendingStoreCount++;
+    storeLog = reserveArray(storeLog, storeLogCount, &storeLogCapacity, INITIAL_DEAD_CODE_CAPACITY,
+                            sizeof(int), "store log entries");
+    storeLog[storeLogCount++] = symbol;
+}
+
+static WalkAction enterStores(NodeId node, void *context) {
+    (void)context;
+    switch (nodeType(node)) {
+        case NODE_WHILE:
+        case NODE_DO_WHILE:
+        case NODE_FOR:
+        case NODE_FUNC_DEF:
+            pushRegion();
+            break;
+        default:
+            break;
+    }
+    return WALK_CHILDREN;
+}
+
+/**
+ * @brief Opens a region for each branch of an if once its condition is done.
+ */
+static void afterChildStores(NodeId node, int index, void *context) {
+    (void)context;
+    if (nodeType(node) != NODE_IF) {
+        return;
+    }
+    if (index > 0) {
+        regionCount--;
+    }
+    if (index < 2) {
+        pushRegion();
+    }
+}
+
+static void leaveStores(NodeId node, void *context) {
+    (void)context;
+    switch (nodeType(node)) {
+        case NODE_VAR_REF: {
+            int symbol = nodeData(node)->varRef.symbol;
+            if (symbol >= 0 && symbol < symCount) {
+                pendingHeads[symbol] = -1;
+            }
+            break;
+        }
+        case NODE_ASSIGN:
+            recordStore(node, nodeData(node)->assign.symbol);
+            break;
+        case NODE_VAR_DECL:
+            recordStore(node, nodeData(node)->varDecl.symbol);
+            break;
+        case NODE_WHILE:
+        case NODE_DO_WHILE:
+        case NODE_FOR:
+        case NODE_FUNC_DEF: {
+            // A store still pending at the end of the body may be read by the
+            // next iteration, so it counts as read
+            StoreRegion *region = &regions[--regionCount];
+            for (int i = region->logStart; i < storeLogCount; i++) {
+                dropPendingAfter(storeLog[i], region->serial, 0);
+            }
+            storeLogCount = region->logStart;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static const AstVisitor storeVisitor = { enterStores, afterChildStores, leaveStores, WALK_NEXT_TAIL };
+
+/**
+ * @brief Removes code that cannot affect the program's output.
+ *
+ * That is the branch an if with a constant condition never takes (with the
+ * compare and jumps), while loops whose condition is false, ifs left with no
+ * branches, and stores nothing reads before the next store to the same
+ * variable. For a whole program, stores still unread at the end are dead
+ * too; a --stream statement cannot know that, as later statements may read
+ * them. Every statement dropped, nested ones included, is added to
+ * optimizerStats.removedStatements.
+ *
+ * @param root The statement list.
+ * @param wholeProgram 1 if nothing runs after the list.
+ * @return The new head of the list, NULL_NODE if nothing is left.
+ */
+NodeId eliminateDeadCode(NodeId root, int wholeProgram) {
+    int before = optimizerStats.removedStatements;
+    root = compactStatements(root);
+
+    reservePendingHeads();
+    pendingStoreCount = 0;
+    storeLogCount = 0;
+    regionCount = 0;
+    walkAST(root, &storeVisitor, NULL);
+    for (int i = 0; i < storeLogCount; i++) {
+        dropPendingAfter(storeLog[i], 0, wholeProgram);
+    }
+    storeLogCount = 0;
+
+    root = compactStatements(root);
+    LOG_DEBUG(LOG_OPTIMIZER, "Removed %d dead statements\n", optimizerStats.removedStatements - before);
+    return root;
+}
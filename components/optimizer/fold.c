@@ -0,0 +1,270 @@
+#include "optimizer.h"
+#include "../ast_walk.h"
+#include "../log.h"
+#include <limits.h>
+#include <string.h>
+
+/**
+ * @brief Reads a number literal.
+ *
+ * @return 1 and the value if node is a NODE_NUMBER, 0 otherwise.
+ */
+static int numberValue(NodeId node, long long *value) {
+    if (nodeType(node) != NODE_NUMBER) {
+        return 0;
+    }
+    *value = nodeData(node)->number;
+    return 1;
+}
+
+static int booleanValue(NodeId node, int *value) {
+    if (nodeType(node) != NODE_BOOLEAN_LITERAL) {
+        return 0;
+    }
+    *value = nodeData(node)->booleanLiteral.value;
+    return 1;
+}
+
+/**
+ * @brief Notes a node that can fault or has effects: a call, or a division
+ *        by anything but a constant other than 0 and -1.
+ */
+static WalkAction enterEffects(NodeId node, void *context) {
+    int *effects = context;
+    long long divisor;
+    if (nodeType(node) == NODE_FUNC_CALL ||
+        (nodeType(node) == NODE_BINARY_OP && nodeData(node)->binaryOp.op == OP_DIV &&
+         !(numberValue(nodeData(node)->binaryOp.right, &divisor) && divisor != 0 && divisor != -1))) {
+        *effects = 1;
+        return WALK_PRUNE;
+    }
+    return WALK_CHILDREN;
+}
+
+static const AstVisitor effectsVisitor = { enterEffects, NULL, NULL, WALK_NEXT_TAIL };
+
+/**
+ * @brief Returns 1 if evaluating an expression can only produce its value,
+ *        so a pass may drop it.
+ */
+int isPureExpression(NodeId expr) {
+    int effects = 0;
+    walkAST(expr, &effectsVisitor, &effects);
+    return !effects;
+}
+
+/**
+ * @brief Rewrites node as a number literal if value fits one.
+ *
+ * @return 1 if the node was rewritten.
+ */
+static int foldToNumber(NodeId node, long long value) {
+    if (value < INT_MIN || value > INT_MAX) {
+        return 0;
+    }
+    setNodeType(node, NODE_NUMBER);
+    memset(nodeData(node), 0, sizeof(NodePayload));
+    nodeData(node)->number = (int)value;
+    optimizerStats.foldedNodes++;
+    return 1;
+}
+
+static void foldToBoolean(NodeId node, int value) {
+    setNodeType(node, NODE_BOOLEAN_LITERAL);
+    memset(nodeData(node), 0, sizeof(NodePayload));
+    nodeData(node)->booleanLiteral.value = value != 0;
+    optimizerStats.foldedNodes++;
+}
+
+/**
+ * @brief Replaces node with one of its operands, e.g. x + 0 with x.
+ */
+static void foldToOperand(NodeId node, NodeId operand) {
+    setNodeType(node, nodeType(operand));
+    *nodeData(node) = *nodeData(operand);
+    optimizerStats.foldedNodes++;
+}
+
+/**
+ * @brief Returns 1 if two operands are the same variable, as in x - x.
+ */
+static int sameVariable(NodeId left, NodeId right) {
+    return nodeType(left) == NODE_VAR_REF && nodeType(right) == NODE_VAR_REF &&
+           nodeData(left)->varRef.symbol == nodeData(right)->varRef.symbol;
+}
+
+static void foldBinary(NodeId node) {
+    OpCode op = nodeData(node)->binaryOp.op;
+    NodeId left = nodeData(node)->binaryOp.left;
+    NodeId right = nodeData(node)->binaryOp.right;
+    long long a, b;
+    int leftConstant = numberValue(left, &a);
+    int rightConstant = numberValue(right, &b);
+
+    if (leftConstant && rightConstant) {
+        switch (op) {
+            case OP_ADD: foldToNumber(node, a + b); return;
+            case OP_SUB: foldToNumber(node, a - b); return;
+            case OP_MUL: foldToNumber(node, a * b); return;
+            case OP_DIV:
+                if (b == 0) {
+                    // Left in place so the program still faults where it
+                    // did; warnDivisionsByZero() reports it
+                    return;
+                }
+                foldToNumber(node, a / b);
+                return;
+            default:
+                return;
+        }
+    }
+
+    if (rightConstant && b == 0 && (op == OP_ADD || op == OP_SUB)) {
+        foldToOperand(node, left);
+    } else if (leftConstant && a == 0 && op == OP_ADD) {
+        foldToOperand(node, right);
+    } else if (rightConstant && b == 1 && (op == OP_MUL || op == OP_DIV)) {
+        foldToOperand(node, left);
+    } else if (leftConstant && a == 1 && op == OP_MUL) {
+        foldToOperand(node, right);
+    } else if (op == OP_MUL && ((rightConstant && b == 0 && isPureExpression(left)) ||
+                                (leftConstant && a == 0 && isPureExpression(right)))) {
+        foldToNumber(node, 0);
+    } else if (op == OP_SUB && sameVariable(left, right)) {
+        foldToNumber(node, 0);
+    }
+}
+
+static void foldRelational(NodeId node) {
+    OpCode op = nodeData(node)->relOp.op;
+    NodeId left = nodeData(node)->relOp.left;
+    NodeId right = nodeData(node)->relOp.right;
+    long long a, b;
+    int p, q;
+
+    if (numberValue(left, &a) && numberValue(right, &b)) {
+        switch (op) {
+            case OP_EQ: foldToBoolean(node, a == b); break;
+            case OP_NE: foldToBoolean(node, a != b); break;
+            case OP_LT: foldToBoolean(node, a < b); break;
+            case OP_GT: foldToBoolean(node, a > b); break;
+            case OP_LE: foldToBoolean(node, a <= b); break;
+            case OP_GE: foldToBoolean(node, a >= b); break;
+            default: break;
+        }
+    } else if (booleanValue(left, &p) && booleanValue(right, &q)) {
+        if (op == OP_EQ) {
+            foldToBoolean(node, p == q);
+        } else if (op == OP_NE) {
+            foldToBoolean(node, p != q);
+        }
+    }
+}
+
+static void foldLogical(NodeId node) {
+    OpCode op = nodeData(node)->logicalOp.op;
+    NodeId left = nodeData(node)->logicalOp.left;
+    NodeId right = nodeData(node)->logicalOp.right;
+    int p, q;
+    int leftConstant = booleanValue(left, &p);
+    int rightConstant = booleanValue(right, &q);
+
+    if (leftConstant && rightConstant) {
+        foldToBoolean(node, op == OP_AND ? (p && q) : (p || q));
+        return;
+    }
+    if (!leftConstant && !rightConstant) {
+        return;
+    }
+
+    // One side is constant: it either decides the result or drops out
+    int constant = leftConstant ? p : q;
+    NodeId other = leftConstant ? right : left;
+    int identity = op == OP_AND ? 1 : 0;
+    if (constant == identity) {
+        foldToOperand(node, other);
+    } else if (isPureExpression(other)) {
+        foldToBoolean(node, constant);
+    }
+}
+
+/**
+ * @brief Folds a node whose operands have already been folded. Nodes that
+ *        are not operators, or have operands that are not constant, are left
+ *        alone.
+ */
+void foldNode(NodeId node) {
+    switch (nodeType(node)) {
+        case NODE_BINARY_OP:
+            foldBinary(node);
+            break;
+        case NODE_RELATIONAL_OP:
+            foldRelational(node);
+            break;
+        case NODE_LOGICAL_OP:
+            foldLogical(node);
+            break;
+        default:
+            break;
+    }
+}
+
+static void leaveFold(NodeId node, void *context) {
+    (void)context;
+    foldNode(node);
+}
+
+static const AstVisitor foldVisitor = { NULL, NULL, leaveFold, WALK_NEXT_TAIL };
+
+/**
+ * @brief Folds constant arithmetic, relational and logical subtrees, and
+ *        applies the identities x + 0, x - 0, x * 1, x / 1, x * 0, x - x,
+ *        x && true and x || false.
+ *
+ * Operations are evaluated in 64 bits like the generated code, and only
+ * folded when the result fits a number literal. Nothing that could fault,
+ * such as a division by zero, is folded away.
+ */
+void foldConstants(NodeId root) {
+    int before = optimizerStats.foldedNodes;
+    walkAST(root, &foldVisitor, NULL);
+    LOG_DEBUG(LOG_OPTIMIZER, "Folded %d nodes\n", optimizerStats.foldedNodes - before);
+}
+
+// Top-level statements walked by warnDivisionsByZero() so far. A --stream
+// compile passes one statement per call, so the count carries over.
+static int statementNumber = 0;
+
+static WalkAction enterDivisions(NodeId node, void *context) {
+    int *depth = context;
+    if (*depth == 0) {
+        statementNumber++;
+    }
+    (*depth)++;
+    long long divisor;
+    if (nodeType(node) == NODE_BINARY_OP && nodeData(node)->binaryOp.op == OP_DIV &&
+        numberValue(nodeData(node)->binaryOp.right, &divisor) && divisor == 0) {
+        printf("Warning: Division by zero in constant expression in statement %d\n", statementNumber);
+    }
+    return WALK_CHILDREN;
+}
+
+static void leaveDivisions(NodeId node, void *context) {
+    (void)node;
+    (*(int *)context)--;
+}
+
+static const AstVisitor divisionVisitor = { enterDivisions, NULL, leaveDivisions, WALK_NEXT_TAIL };
+
+/**
+ * @brief Warns once for every division by a constant 0 left in a statement
+ *        list, naming the top-level statement it is in, counted from 1.
+ *
+ * Runs once folding and propagation are done, so a divisor that only
+ * becomes 0 through a known variable is reported too, and no site is
+ * reported twice however many passes fold it.
+ */
+void warnDivisionsByZero(NodeId root) {
+    int depth = 0;
+    walkAST(root, &divisionVisitor, &depth);
+}
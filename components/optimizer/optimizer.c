@@ -0,0 +1,27 @@
+#include "optimizer.h"
+#include "../log.h"
+
+OptimizerStats optimizerStats = { 0 };
+
+/**
+ * @brief Runs the AST optimization passes over a checked statement list.
+ *
+ * Call after checkSemantic() and before code generation. Passes rewrite
+ * nodes in place and keep their cached types, but dead code elimination may
+ * drop statements, including the first.
+ *
+ * @param root The statement list.
+ * @param wholeProgram 1 for a whole program, 0 for one --stream statement.
+ * @return The new head of the list, NULL_NODE if nothing is left.
+ */
+NodeId optimizeAST(NodeId root, int wholeProgram) {
+    foldConstants(root);
+    propagateConstants(root);
+    warnDivisionsByZero(root);
+    return eliminateDeadCode(root, wholeProgram);
+}
+
+void logOptimizerStats() {
+    LOG_INFO(LOG_OPTIMIZER, "Optimizer: folded %d nodes, propagated %d constants, removed %d statements\n",
+             optimizerStats.foldedNodes, optimizerStats.propagatedLoads, optimizerStats.removedStatements);
+}
@@ -0,0 +1,26 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "../ast.h"
+
+// What the optimization passes changed in the current compile
+typedef struct {
+    int foldedNodes;       // Expressions replaced by a constant or an operand
+    int propagatedLoads;   // Variable references replaced by a known value
+    int removedStatements; // Statements dropped as dead code, nested ones included
+} OptimizerStats;
+
+extern OptimizerStats optimizerStats;
+
+int isPureExpression(NodeId expr);
+void foldNode(NodeId node);
+void foldConstants(NodeId root);
+void warnDivisionsByZero(NodeId root);
+void propagateConstants(NodeId root);
+NodeId eliminateDeadCode(NodeId root, int wholeProgram);
+
+NodeId optimizeAST(NodeId root, int wholeProgram);
+
+void logOptimizerStats();
+
+#endif // OPTIMIZER_H
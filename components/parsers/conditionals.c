@@ -12,7 +12,7 @@
  * 
  * @return The parsed conditional statement
  */
-ASTNode* conditional() {
+NodeId conditional() {
     nextToken();
     
     if (current->type != LPAREN) {
@@ -21,7 +21,7 @@ ASTNode* conditional() {
     }
     nextToken();
     
-    ASTNode *cond = parseCondition(1);
+    NodeId cond = parseExpression(0);
     if (current->type != RPAREN) {
         printf("Error: Missing ')' after condition\n");
         exit(1);
@@ -34,7 +34,9 @@ ASTNode* conditional() {
     }
     nextToken();
     
-    ASTNode *thenStmt = statement();
+    enterScope();
+    NodeId thenStmt = statement();
+    exitScope();
     if (current->type != RBRACE) {
         printf("Error: Missing '}' after IF body\n");
         exit(1);
@@ -44,44 +46,46 @@ ASTNode* conditional() {
     if (current->type == ELSE) {
         nextToken();
         if (current->type == IF) {
-            ASTNode *elseIfStmt = conditional();  
-            ASTNode *node = allocateNode(NODE_IF);
+            NodeId elseIfStmt = conditional();  
+            NodeId node = allocateNode(NODE_IF);
             if (!node) {
                 printf("Memory Error: Failed to allocate memory for else-if node\n");
                 exit(1);
             }
-            node->ifNode.condition = cond;
-            node->ifNode.thenStmt = thenStmt;
-            node->ifNode.elseStmt = elseIfStmt;
+            nodeData(node)->ifNode.condition = cond;
+            nodeData(node)->ifNode.thenStmt = thenStmt;
+            nodeData(node)->ifNode.elseStmt = elseIfStmt;
             return node;
         }
         if (current->type == LBRACE) {
-            ASTNode *elseStmt = statement();
+            enterScope();
+            NodeId elseStmt = statement();
+            exitScope();
             if (current->type != RBRACE) {
                 printf("Error: Missing '}' after ELSE body\n");
                 exit(1);
             }
             nextToken();
             
-            ASTNode *node = allocateNode(NODE_IF);
+            NodeId node = allocateNode(NODE_IF);
             if (!node) {
                 printf("Memory Error: Failed to allocate memory for else node\n");
                 exit(1);
             }
-            node->ifNode.condition = cond;
-            node->ifNode.thenStmt = thenStmt;
-            node->ifNode.elseStmt = elseStmt;
+            nodeData(node)->ifNode.condition = cond;
+            nodeData(node)->ifNode.thenStmt = thenStmt;
+            nodeData(node)->ifNode.elseStmt = elseStmt;
             return node;
         }
     }
 
-    ASTNode *node = allocateNode(NODE_IF);
+    NodeId node = allocateNode(NODE_IF);
     if (!node) {
         printf("Memory Error: Failed to allocate memory for if node\n");
         exit(1);
     }
-    node->ifNode.condition = cond;
-    node->ifNode.thenStmt = thenStmt;
-    node->ifNode.elseStmt = NULL;  
+    nodeData(node)->ifNode.condition = cond;
+    nodeData(node)->ifNode.thenStmt = thenStmt;
+    nodeData(node)->ifNode.elseStmt = NULL_NODE; 
     return node;
 }
@@ -2,309 +2,225 @@
 #include "header/parser.h"
 #include "header/expressions.h"
 #include "../tokens.h"  
+#include "../log.h"
 
 extern Token* current;
 extern void nextToken();
 
-ASTNode* factor();
-ASTNode* primary();
-ASTNode* multiplicative();
-ASTNode* additive();
-ASTNode* comparison();
-ASTNode* logical();
-ASTNode* parseExpression(int minPrecedence);
-ASTNode* functionCall(const char* name);
+NodeId functionCall(InternId name);
+
+// Every binary operator, lowest precedence first. All are left associative.
+typedef struct {
+    TokenType token;
+    const char *text;
+    int precedence;
+    NodeType type;
+    OpCode op;
+} InfixOperator;
+
+static const InfixOperator infixOperators[] = {
+    { OR,       "||", 1, NODE_LOGICAL_OP, OP_OR },
+    { AND,      "&&", 2, NODE_LOGICAL_OP, OP_AND },
+    { RELOP,    "==", 3, NODE_RELATIONAL_OP, OP_EQ },
+    { RELOP,    "!=", 3, NODE_RELATIONAL_OP, OP_NE },
+    { RELOP,    "<",  4, NODE_RELATIONAL_OP, OP_LT },
+    { RELOP,    ">",  4, NODE_RELATIONAL_OP, OP_GT },
+    { RELOP,    "<=", 4, NODE_RELATIONAL_OP, OP_LE },
+    { RELOP,    ">=", 4, NODE_RELATIONAL_OP, OP_GE },
+    { OPERATOR, "+",  5, NODE_BINARY_OP, OP_ADD },
+    { OPERATOR, "-",  5, NODE_BINARY_OP, OP_SUB },
+    { OPERATOR, "*",  6, NODE_BINARY_OP, OP_MUL },
+    { OPERATOR, "/",  6, NODE_BINARY_OP, OP_DIV },
+};
+
+#define INFIX_OPERATOR_COUNT (int)(sizeof(infixOperators) / sizeof(infixOperators[0]))
+
+// Marks an open parenthesis on the operator stack
+#define OPEN_PAREN NULL
+
+// Operand and operator stacks shared by every parseExpression() call. A call
+// nested through a function call argument works above the caller's entries.
+static NodeId *operandStack = NULL;
+static int operandCount = 0;
+static int operandCapacity = 0;
+static const InfixOperator **operatorStack = NULL;
+static int operatorCount = 0;
+static int operatorCapacity = 0;
 
-ASTNode* primary() {
-    if (current && current->type == LPAREN) {
-        nextToken();
-        ASTNode* node = parseExpression(0);
-        
-        if (current && current->type == RPAREN) {
-            nextToken();
-        } else {
-            printf("Error: Expected closing parenthesis\n");
-            exit(1);
+/**
+ * @brief Returns the table entry for the current token, or NULL if it is not
+ *        a binary operator.
+ */
+static const InfixOperator *infixOperator(const Token *token) {
+    if (token->type != OPERATOR && token->type != RELOP && token->type != AND && token->type != OR) {
+        return NULL;
+    }
+    for (int i = 0; i < INFIX_OPERATOR_COUNT; i++) {
+        if (infixOperators[i].token == token->type && tokenEquals(token, infixOperators[i].text)) {
+            return &infixOperators[i];
         }
-        
-        return node;
     }
-    
-    return factor();
+    return NULL;
+}
+
+static void *growStack(void *stack, int *capacity, size_t itemSize) {
+    int grown = *capacity ? *capacity * 2 : 64;
+    void *memory = realloc(stack, (size_t)grown * itemSize);
+    if (!memory) {
+        printf("Fatal error: Memory allocation failed for expression stack of %d entries\n", grown);
+        exit(1);
+    }
+    *capacity = grown;
+    return memory;
 }
 
-ASTNode* factor() {
+static void pushOperand(NodeId node) {
+    if (operandCount == operandCapacity) {
+        operandStack = growStack(operandStack, &operandCapacity, sizeof(NodeId));
+    }
+    operandStack[operandCount++] = node;
+}
+
+static void pushOperator(const InfixOperator *op) {
+    if (operatorCount == operatorCapacity) {
+        operatorStack = (const InfixOperator **)growStack((void *)operatorStack, &operatorCapacity, sizeof(InfixOperator *));
+    }
+    operatorStack[operatorCount++] = op;
+}
+
+/**
+ * @brief Pops the top operator and its two operands and pushes the node
+ *        combining them.
+ */
+static void reduce() {
+    const InfixOperator *op = operatorStack[--operatorCount];
+    NodeId right = operandStack[--operandCount];
+    NodeId left = operandStack[--operandCount];
+
+    NodeId node = allocateNode(op->type);
+    switch (op->type) {
+        case NODE_BINARY_OP:
+            nodeData(node)->binaryOp.op = op->op;
+            nodeData(node)->binaryOp.left = left;
+            nodeData(node)->binaryOp.right = right;
+            break;
+        case NODE_LOGICAL_OP:
+            nodeData(node)->logicalOp.op = op->op;
+            nodeData(node)->logicalOp.left = left;
+            nodeData(node)->logicalOp.right = right;
+            break;
+        default:
+            nodeData(node)->relOp.op = op->op;
+            nodeData(node)->relOp.left = left;
+            nodeData(node)->relOp.right = right;
+            break;
+    }
+    operandStack[operandCount++] = node;
+}
+
+NodeId factor() {
     if (!current) {
         printf("Error: Unexpected end of input\n");
         exit(1);
     }
     if (current->type == NUMBER) {
-        ASTNode* node = allocateNode(NODE_NUMBER);
-        node->number = atoi(current->value);
+        NodeId node = allocateNode(NODE_NUMBER);
+        nodeData(node)->number = current->number;
         nextToken();
         return node;
     } else if (current->type == STRING_LITERAL) {
-        ASTNode* node = allocateNode(NODE_STRING_LITERAL);
-        strcpy(node->stringLiteral.value, current->value);
+        NodeId node = allocateNode(NODE_STRING_LITERAL);
+        nodeData(node)->stringLiteral.value = current->id;
         nextToken();
         return node;
     } else if (current->type == BOOLEAN_LITERAL) {
-        ASTNode* node = allocateNode(NODE_BOOLEAN_LITERAL);
-        strcpy(node->booleanLiteral.value, current->value);
+        NodeId node = allocateNode(NODE_BOOLEAN_LITERAL);
+        nodeData(node)->booleanLiteral.value = current->boolean;
         nextToken();
         return node;
     } else if (current->type == ID) {
-        char name[MAX_VAR_NAME_LENGTH];
-        strcpy(name, current->value);
+        InternId name = current->id;
         nextToken();
         if (current && current->type == LPAREN) {
             return functionCall(name);
         }
-        ASTNode* node = allocateNode(NODE_VAR_REF);
-        strcpy(node->varRef.name, name);
+        int symbol = lookupSymbol(name);
+        if (symbol == -1) {
+            printf("Error: Variable '%s' not declared\n", internedText(name));
+            exit(1);
+        }
+        NodeId node = allocateNode(NODE_VAR_REF);
+        nodeData(node)->varRef.name = name;
+        nodeData(node)->varRef.symbol = symbol;
         return node;
     } else {
-        printf("Error: Unexpected token '%s'\n", current->value);
+        printf("Error: Unexpected token '" TOKEN_FMT "'\n", TOKEN_ARG(current));
         exit(1);
     }
 }
 
 /**
- * @brief  Parses a term expression.
- * 
- * This function helps with parsing by parsing a term expression. (* and /) 
- *
- * @return The parsed term expression
- */
-ASTNode* term() {
-    ASTNode *left = factor();
-    while (current && current->type == OPERATOR && (current->value[0] == '*' || current->value[0] == '/')) {
-        char op = current->value[0];
-        nextToken();
-        ASTNode *right = factor();
-        ASTNode *node = allocateNode(NODE_BINARY_OP);
-        node->binaryOp.op = op;
-        node->binaryOp.left = left;
-        node->binaryOp.right = right;
-        left = node;
-    }
-    return left;
-}
-
-
-/**
- * @deprecated Use parseExpression instead, which is more general to handle cases like 4 + 2 * 3 --> 4 + (2 * 3)
  * @brief  Parses an expression.
  * 
- * This function helps with parsing by parsing an expression. (+ and -)
- * 
+ * Arithmetic, relational and logical operators are all parsed here, ordered
+ * by the infixOperators table: || binds loosest, then &&, equality,
+ * comparison, + and -, and * and / tightest. Operators of equal precedence
+ * group to the left, so a - b + c is (a - b) + c.
+ *
+ * The parser keeps explicit operand and operator stacks instead of
+ * recursing, so neither long operator chains nor deeply nested parentheses
+ * use any C stack.
+ *
+ * @param minPrecedence Operators outside parentheses that bind looser than
+ *        this end the expression. 0 accepts every operator.
  * @return The parsed expression
  */
-ASTNode* expression() {
-    ASTNode *left = term();
-    while (current && current->type == OPERATOR && (current->value[0] == '+' || current->value[0] == '-')) {
-        char op = current->value[0];
-        nextToken();
-        ASTNode *right = term();
-        ASTNode *node = allocateNode(NODE_BINARY_OP);
-        node->binaryOp.op = op;
-        node->binaryOp.left = left;
-        node->binaryOp.right = right;
-        left = node;
-    }
-    return left;
-}
-
-/**
- * @brief  Parses an expression.
- * 
- * This function helps with parsing by parsing an expression. (+, -, *, /, ^)
- * The precedence of each operator is determined by the getPrecedence function which helps with parsing to determine the order of operations.
- * 
- * @return The parsed expression ASTNode pointer*
- */
-ASTNode* parseExpression(int minPrecedence) {
-    ASTNode *left = factor();
-
-    while (current && current->type == OPERATOR && getPrecedence(current->value[0]) >= minPrecedence) {
-        char op = current->value[0];
-        int precedence = getPrecedence(op);
-        nextToken();
-
-        if (isRightAssociative(op)) {
-            precedence++;
+NodeId parseExpression(int minPrecedence) {
+    int operandBase = operandCount;
+    int operatorBase = operatorCount;
+    int openParens = 0;
+
+    for (;;) {
+        // Operand position: any number of '(' then a factor
+        while (current && current->type == LPAREN) {
+            pushOperator(OPEN_PAREN);
+            openParens++;
+            nextToken();
+        }
+        pushOperand(factor());
+
+        // Operator position: close parentheses, then an operator or the end
+        while (openParens > 0 && current && current->type == RPAREN) {
+            while (operatorStack[operatorCount - 1] != OPEN_PAREN) {
+                reduce();
+            }
+            operatorCount--;
+            openParens--;
+            nextToken();
         }
 
-        ASTNode *right = parseExpression(precedence);
-
-        ASTNode *node = allocateNode(NODE_BINARY_OP);
-        node->binaryOp.op = op;
-        node->binaryOp.left = left;
-        node->binaryOp.right = right;
-        left = node; 
-    }
-
-    return left;
-}
-
-ASTNode* parseCondition(int minPrecedence) {
-    printf("Parsing condition, current token: %s, type: %s\n", 
-           current ? current->value : "NULL", 
-           current ? tokenTypeToString(current->type) : "NULL");
-    
-    ASTNode *left = parseExpression(0); 
-    
-    printf("After parsing left expression, current token: %s, type: %s\n", 
-           current ? current->value : "NULL", 
-           current ? tokenTypeToString(current->type) : "NULL");
-    if (current && current->type == RELOP) {
-        printf("Found relational operator: %s\n", current->value);
-        
-        char op[3];
-        strcpy(op, current->value);
-        nextToken();
-        
-        printf("After consuming relational operator, current token: %s, type: %s\n", 
-               current ? current->value : "NULL", 
-               current ? tokenTypeToString(current->type) : "NULL");
-        
-        ASTNode *right = parseExpression(0);
-        
-        ASTNode *node = allocateNode(NODE_RELATIONAL_OP);
-        strcpy(node->relOp.op, op);
-        node->relOp.left = left;
-        node->relOp.right = right;
-        
-        left = node;  
-    }
-    while (current && (current->type == AND || current->type == OR)) {
-        printf("Found logical operator: %s\n", current->value);
-        
-        TokenType opType = current->type;
-        nextToken();
-        ASTNode *right = parseCondition(0);
-        
-        ASTNode *node = allocateNode(NODE_LOGICAL_OP);
-        node->logicalOp.op[0] = (opType == AND) ? '&' : '|';
-        node->logicalOp.op[1] = (opType == AND) ? '&' : '|';
-        node->logicalOp.op[2] = '\0';
-        node->logicalOp.left = left;
-        node->logicalOp.right = right;
-        
-        left = node;  
-    }
-    
-    return left;
-}
-
-
-
-int getPrecedence(char op) {
-    if (op == '+' || op == '-') return 5;
-    if (op == '*' || op == '/') return 6;
-    if (op == '^') return 7;
-    if (op == '<' || op == '>' || op == '=') return 4;
-    return 0;
-}
-
-
-int isRightAssociative(char op) {
-    return (op == '^');
-}
-
-
-ASTNode* logical() {
-    ASTNode* left = comparison();
-    
-    while (current && current->type == LOGICAL_OP) {
-        char op[3];
-        strcpy(op, current->value);
+        const InfixOperator *op = current ? infixOperator(current) : NULL;
+        if (!op || (openParens == 0 && op->precedence < minPrecedence)) {
+            break;
+        }
+        while (operatorCount > operatorBase && operatorStack[operatorCount - 1] != OPEN_PAREN &&
+               operatorStack[operatorCount - 1]->precedence >= op->precedence) {
+            reduce();
+        }
+        pushOperator(op);
         nextToken();
-        
-        ASTNode* node = allocateNode(NODE_LOGICAL_OP);
-        strcpy(node->logicalOp.op, op);
-        node->logicalOp.left = left;
-        node->logicalOp.right = comparison();
-        
-        left = node;
     }
-    
-    return left;
-}
 
-ASTNode* comparison() {
-    ASTNode* left = additive();
-    
-    if (current && current->type == RELATIONAL_OP) {
-        char op[3];
-        strcpy(op, current->value);
-        nextToken();
-        
-        ASTNode* node = allocateNode(NODE_RELATIONAL_OP);
-        strcpy(node->relOp.op, op);
-        node->relOp.left = left;
-        node->relOp.right = additive();
-        
-        return node;
+    if (openParens > 0) {
+        printf("Error: Expected closing parenthesis\n");
+        exit(1);
     }
-    
-    return left;
-}
-
-
-int isLogicalOp(const char *op) {
-    return strcmp(op, "&&") == 0 || strcmp(op, "||") == 0;
-}
-
-int isRelationalOp(const char *op) {
-    return strcmp(op, "<") == 0 || strcmp(op, ">") == 0 ||
-           strcmp(op, "<=") == 0 || strcmp(op, ">=") == 0 ||
-           strcmp(op, "==") == 0 || strcmp(op, "!=") == 0;
-}
-
-int isComparisonOperator(const char *value) {
-    return strcmp(value, "==") == 0 || 
-           strcmp(value, "!=") == 0 || 
-           strcmp(value, "<") == 0 || 
-           strcmp(value, ">") == 0 || 
-           strcmp(value, "<=") == 0 || 
-           strcmp(value, ">=") == 0;
-}
-
-ASTNode* additive() {
-    ASTNode* left = multiplicative();
-    
-    while (current && current->type == OPERATOR && 
-           (current->value[0] == '+' || current->value[0] == '-')) {
-        char op = current->value[0];
-        nextToken();
-        
-        ASTNode* node = allocateNode(NODE_BINARY_OP);
-        node->binaryOp.op = op;
-        node->binaryOp.left = left;
-        node->binaryOp.right = multiplicative();
-        
-        left = node;
+    while (operatorCount > operatorBase) {
+        reduce();
     }
-    
-    return left;
-}
-
-ASTNode* multiplicative() {
-    ASTNode* left = primary();
-    
-    while (current && current->type == OPERATOR && 
-           (current->value[0] == '*' || current->value[0] == '/')) {
-        char op = current->value[0];
-        nextToken();
-        
-        ASTNode* node = allocateNode(NODE_BINARY_OP);
-        node->binaryOp.op = op;
-        node->binaryOp.left = left;
-        node->binaryOp.right = primary();
-        
-        left = node;
+    if (operandCount != operandBase + 1) {
+        printf("Error: Malformed expression\n");
+        exit(1);
     }
-    
-    return left;
+    return operandStack[--operandCount];
 }
@@ -9,10 +9,9 @@
  *
  * @return The parsed function definition
  */
-ASTNode *functionDef()
+NodeId functionDef()
 {
-    char funcName[50];
-    strcpy(funcName, current->value);
+    InternId funcName = current->id;
     nextToken();
     if (current->type != LPAREN)
     {
@@ -32,11 +31,13 @@ ASTNode *functionDef()
         exit(1);
     }
     nextToken();
-    ASTNode *body = statement();
-    ASTNode *funcNode = allocateNode(NODE_FUNC_DEF);
-    strcpy(funcNode->funcDef.name, funcName);
-    funcNode->funcDef.params = NULL;
-    funcNode->funcDef.body = body;
+    enterScope();
+    NodeId body = statement();
+    exitScope();
+    NodeId funcNode = allocateNode(NODE_FUNC_DEF);
+    nodeData(funcNode)->funcDef.name = funcName;
+    nodeData(funcNode)->funcDef.params = NULL_NODE;
+    nodeData(funcNode)->funcDef.body = body;
     return funcNode;
 }
 
@@ -47,11 +48,11 @@ ASTNode *functionDef()
  *
  * @return The parsed function call
  */
-ASTNode *functionCall()
+NodeId functionCall()
 {
     nextToken();
-    ASTNode *node = allocateNode(NODE_FUNC_CALL);
-    strcpy(node->funcCall.name, current->value);
+    NodeId node = allocateNode(NODE_FUNC_CALL);
+    nodeData(node)->funcCall.name = current->id;
     nextToken();
     if (current->type != LPAREN)
     {
@@ -59,7 +60,8 @@ ASTNode *functionCall()
         exit(1);
     }
     nextToken();
-    node->funcCall.args = parseExpression(1);
+    NodeId args = parseExpression(1);
+    nodeData(node)->funcCall.args = args;
     if (current->type != RPAREN)
     {
         printf("Error: Missing ')' after CALL arguments\n");
@@ -3,8 +3,8 @@
 
 #include "../../ast.h"
 
-ASTNode* loop();
-ASTNode* forLoop();
-ASTNode* doWhileLoop();
+NodeId loop();
+NodeId forLoop();
+NodeId doWhileLoop();
 
 #endif // LOOPS_H
\ No newline at end of file
@@ -5,9 +5,11 @@
 #include "../../symbol_table.h"
 #include "../../tokens.h"
 
+// Growable stack of open brackets; zero-initialize with top = -1
 struct Stack {
-    char items[100];
+    char *items;
     int top;
+    int capacity;
 };
 
 void nextToken();
@@ -15,12 +17,11 @@ void match(TokenType expected);
 void push(struct Stack *stack, char item);
 char pop(struct Stack *stack);
 int isEmpty(struct Stack *stack);
-ASTNode* factor();
-ASTNode* term();
-ASTNode* parseExpression(int minPrecedence);
-ASTNode* conditional();
-ASTNode* functionDef();
-ASTNode* functionCall();
+NodeId factor();
+NodeId parseExpression(int minPrecedence);
+NodeId conditional();
+NodeId functionDef();
+NodeId functionCall();
 void parseTokens();
 
 #endif // PARSER_H
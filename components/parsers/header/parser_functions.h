@@ -4,9 +4,8 @@
 #include "../../tokens.h"
 #include "../../ast.h"
 
-ASTNode* statement();
-ASTNode* parseCondition(int minPrecedence);
-ASTNode* parseExpression(int minPrecedence);
+NodeId statement();
+NodeId parseExpression(int minPrecedence);
 const char* tokenTypeToString(TokenType type);
 
 #endif // PARSER_FUNCTIONS_H
@@ -9,14 +9,14 @@
  * 
  * @return The parsed while loop
  */
-ASTNode* loop() {
+NodeId loop() {
     nextToken();
     if (current->type != LPAREN) {
         printf("Error: Expected '(' after 'while'\n");
         exit(1);
     }
     nextToken(); 
-    ASTNode* condition = parseCondition(1);  
+    NodeId condition = parseExpression(0);  
        
     if (current->type != RPAREN) {
         printf("Error: Expected ')' after condition in while loop\n");
@@ -29,34 +29,36 @@ ASTNode* loop() {
     }
     nextToken();
      
-    ASTNode* body = NULL;
-    ASTNode* current_stmt = NULL;
+    NodeId body = NULL_NODE;
+    NodeId current_stmt = NULL_NODE;
     
+    enterScope();
     while (current && current->type != RBRACE) {
-        ASTNode* stmt = statement();
+        NodeId stmt = statement();
         
         if (!body) {
             body = stmt;
             current_stmt = stmt;
         } else {
-            current_stmt->next = stmt;
+            setNodeNext(current_stmt, stmt);
             current_stmt = stmt;
         }
     } 
+    exitScope();
     if (current->type != RBRACE) {
         printf("Error: Expected '}' after while body\n");
         exit(1);
     }
     nextToken();
      
-    ASTNode* node = allocateNode(NODE_WHILE);
+    NodeId node = allocateNode(NODE_WHILE);
     if (!node) {
         printf("Memory Error: Failed to allocate memory for while node\n");
         exit(1);
     }
     
-    node->whileNode.condition = condition;
-    node->whileNode.body = body;
+    nodeData(node)->whileNode.condition = condition;
+    nodeData(node)->whileNode.body = body;
     
     return node;
 }
@@ -68,7 +70,7 @@ ASTNode* loop() {
  * 
  * @return The parsed for loop
  */
-ASTNode* forLoop() {
+NodeId forLoop() {
     match(FOR);
 
     if (!current || current->type != LPAREN) {
@@ -77,7 +79,9 @@ ASTNode* forLoop() {
     }
     match(LPAREN);
 
-    ASTNode *initialization = statement();
+    // The loop variable is scoped to the whole loop, not the enclosing block
+    enterScope();
+    NodeId initialization = statement();
     if (!initialization) {
         printf("Syntax Error: Invalid initialization in for loop\n");
         exit(1);
@@ -89,7 +93,7 @@ ASTNode* forLoop() {
     }
     match(SEMICOLON);
 
-    ASTNode *condition = parseCondition(1); 
+    NodeId condition = parseExpression(0); 
     if (!condition) {
         printf("Syntax Error: Invalid condition in for loop\n");
         exit(1);
@@ -100,7 +104,7 @@ ASTNode* forLoop() {
         exit(1);
     }
     match(SEMICOLON);
-    ASTNode *increment = parseExpression(1);  
+    NodeId increment = parseExpression(1);  
     if (!increment) {
         printf("Syntax Error: Invalid increment in for loop\n");
         exit(1);
@@ -114,26 +118,29 @@ ASTNode* forLoop() {
         printf("Syntax Error: Expected '{' before loop body\n");
     }
     match(LBRACE);
-    ASTNode *body = statement(); 
+    enterScope();
+    NodeId body = statement(); 
     if (!body) {
         printf("Syntax Error: Invalid statement in for loop body\n");
         exit(1);
     }
+    exitScope();
+    exitScope();
     if (!current || current->type != RBRACE) {
         printf("Syntax Error: Expected '}' after loop body\n");
         exit(1);
     }
     match(RBRACE);
-    ASTNode *node = allocateNode(NODE_FOR);
+    NodeId node = allocateNode(NODE_FOR);
     if (!node) {
         printf("Memory Error: Failed to allocate memory for for loop node\n");
         exit(1);
     }
 
-    node->forNode.initialization = initialization;
-    node->forNode.condition = condition;
-    node->forNode.increment = increment;
-    node->forNode.body = body;
+    nodeData(node)->forNode.initialization = initialization;
+    nodeData(node)->forNode.condition = condition;
+    nodeData(node)->forNode.increment = increment;
+    nodeData(node)->forNode.body = body;
 
     return node;
 }
@@ -145,7 +152,7 @@ ASTNode* forLoop() {
  * 
  * @return The parsed do-while loop
  */
-ASTNode* doWhileLoop() {
+NodeId doWhileLoop() {
     
     match(DO);
     if (!current || current->type != LBRACE) {
@@ -153,7 +160,9 @@ ASTNode* doWhileLoop() {
         exit(1);
     }
     match(LBRACE);
-    ASTNode *body = statement();
+    enterScope();
+    NodeId body = statement();
+    exitScope();
     if (!body) {
         printf("Syntax Error: Invalid statement in do-while loop body\n");
         exit(1);
@@ -175,7 +184,7 @@ ASTNode* doWhileLoop() {
         exit(1);
     }
     match(LPAREN);
-    ASTNode *condition = parseCondition(1);
+    NodeId condition = parseExpression(0);
     if (!condition) {
         printf("Syntax Error: Invalid condition in do-while loop\n");
         exit(1);
@@ -186,13 +195,13 @@ ASTNode* doWhileLoop() {
         exit(1);
     }
     match(RPAREN);
-    ASTNode *node = allocateNode(NODE_DO_WHILE);
+    NodeId node = allocateNode(NODE_DO_WHILE);
     if (!node) {
         printf("Memory Error: Failed to allocate memory for do-while loop node\n");
         exit(1);
     }
-    node->doWhileNode.condition = condition;
-    node->doWhileNode.body = body;
+    nodeData(node)->doWhileNode.condition = condition;
+    nodeData(node)->doWhileNode.body = body;
 
     return node;
 }
@@ -4,16 +4,27 @@
 #include "header/parser.h"
 #include "../memory.h"
 #include "../symbol_table.h"
+#include "../log.h"
 
-#define MAX_STACK_SIZE 100
+#define INITIAL_STACK_SIZE 64
 
 struct Stack bracesStack = { .top = -1 };
 struct Stack parenStack = { .top = -1 };
 
+/**
+ * @brief Pushes an open bracket, doubling the stack when full so nesting
+ *        depth is only limited by memory.
+ */
 void push(struct Stack *stack, char item) {
-    if (stack->top >= MAX_STACK_SIZE - 1) {
-        printf("Error: Stack overflow\n");
-        exit(1);
+    if (stack->top >= stack->capacity - 1) {
+        int capacity = stack->capacity ? stack->capacity * 2 : INITIAL_STACK_SIZE;
+        char *items = realloc(stack->items, (size_t)capacity);
+        if (!items) {
+            printf("Error: Stack overflow\n");
+            exit(1);
+        }
+        stack->items = items;
+        stack->capacity = capacity;
     }
     stack->items[++(stack->top)] = item;
 }
@@ -29,36 +40,44 @@ int isEmpty(struct Stack *stack) {
     return stack->top < 0;
 }
 
+/**
+ * @brief Advances current to the next token in the token buffer, scanning
+ *        more of the source first when the buffer is scanned lazily.
+ *
+ * The buffer ends with an END token, and current stays on it once reached.
+ */
 void nextToken() {
-    if (current) {
-        current = current->next;
-        if (current) {
-            if (current->type == LBRACE) {
-                push(&bracesStack, '{');
-            } 
-            else if (current->type == RBRACE) {
-                char opener = pop(&bracesStack);
-                if (opener != '{') {
-                    printf("Syntax Error: Unmatched closing brace '}'\n");
-                    exit(1);
-                }
-            }
-            else if (current->type == LPAREN) {
-                push(&parenStack, '(');
-            }
-            else if (current->type == RPAREN) {
-                char opener = pop(&parenStack);
-                if (opener != '(') {
-                    printf("Syntax Error: Unmatched closing parenthesis ')'\n");
-                    exit(1);
-                }
-            }
+    if (!current || current->type == END) {
+        return;
+    }
+
+    if (tokenIndex + 1 == tokenCount) {
+        scanMoreTokens();
+    }
+    current = &tokens[++tokenIndex];
+    if (current->type == LBRACE) {
+        push(&bracesStack, '{');
+    } 
+    else if (current->type == RBRACE) {
+        char opener = pop(&bracesStack);
+        if (opener != '{') {
+            printf("Syntax Error: Unmatched closing brace '}'\n");
+            exit(1);
+        }
+    }
+    else if (current->type == LPAREN) {
+        push(&parenStack, '(');
+    }
+    else if (current->type == RPAREN) {
+        char opener = pop(&parenStack);
+        if (opener != '(') {
+            printf("Syntax Error: Unmatched closing parenthesis ')'\n");
+            exit(1);
         }
-        
-        printf("Next token is type: %s , value: %s\n", 
-               current ? tokenTypeToString(current->type) : "NULL", 
-               current ? current->value : "NULL");
     }
+    
+    LOG_TRACE(LOG_PARSER, "Next token is type: %s , value: " TOKEN_FMT "\n", 
+           tokenTypeToString(current->type), TOKEN_ARG(current));
 }
 
 void match(TokenType expected) {
@@ -68,7 +87,7 @@ void match(TokenType expected) {
     }
     else
     {
-        printf("Syntax Error: Unexpected token '%s'\n", current ? current->value : "NULL");
+        printf("Syntax Error: Unexpected token '" TOKEN_FMT "'\n", TOKEN_ARG(current));
         exit(1);
     }
 }
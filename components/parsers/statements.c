@@ -2,12 +2,11 @@
 #include "./header/parser.h"
 #include "./header/loops.h"
 #include "./header/expressions.h"
+#include "../log.h"
 
-#define MAX_VAR_NAME_LENGTH 50
+extern int evaluateExpression(NodeId expr);
 
-extern int evaluateExpression(ASTNode *expr);
-
-void updateOrInsertSymbol(const char *name, int value, VariableType type) {
+void updateOrInsertSymbol(InternId name, int value, VariableType type) {
     int index = lookupSymbol(name);
     if (index != -1) {
         symTable[index].value = value;
@@ -24,48 +23,43 @@ void updateOrInsertSymbol(const char *name, int value, VariableType type) {
  * 
  * @return The parsed statement AST node.
  */
-ASTNode* statement() {
-    printf("Parsing statement, current token: %s\n", current->value);
+NodeId statement() {
+    LOG_TRACE(LOG_PARSER, "Parsing statement, current token: " TOKEN_FMT "\n", TOKEN_ARG(current));
     
-    ASTNode* node = NULL;
+    NodeId node = NULL_NODE;
     
     switch (current->type) {
         case ID: {
-            int index = lookupSymbol(current->value);
+            InternId varName = current->id;
+            int index = lookupSymbol(varName);
             if (index != -1) {
-                char varName[MAX_VAR_NAME_LENGTH];
-                strcpy(varName, current->value);
                 nextToken();
                 if (current->type == ASSIGN) {
                     nextToken();
-                    ASTNode *expr = parseExpression(0);
+                    NodeId expr = parseExpression(0);
                     if (current->type != SEMICOLON) {
                         printf("Error: Missing ';' after assignment\n");
                         exit(1);
                     }
                     nextToken();
                     node = allocateNode(NODE_ASSIGN);
-                    strcpy(node->assign.name, varName);
-                    node->assign.expr = expr;
-                    printf("Assignment statement parsed successfully\n");
+                    nodeData(node)->assign.name = varName;
+                    nodeData(node)->assign.expr = expr;
+                    nodeData(node)->assign.symbol = index;
+                    LOG_DEBUG(LOG_PARSER, "Assignment statement parsed successfully\n");
                 } else {
                     printf("Error: Unexpected token after variable name\n");
                     exit(1);
                 }
             } else {
-                printf("Error: Variable '%s' not declared type: %s\n", current->value, tokenTypeToString(current->type));
+                printf("Error: Variable '%s' not declared type: %s\n", internedText(varName), tokenTypeToString(current->type));
                 exit(1);
             }
             break;
         }
 
         case VAR: {
-            VariableType varType = TYPE_NUMBER;
-            if (strcmp(current->value, "str") == 0) {
-                varType = TYPE_STRING;
-            } else if (strcmp(current->value, "log") == 0) {
-                varType = TYPE_BOOLEAN;
-            }
+            VariableType varType = (VariableType)current->varType;
             
             nextToken();
             if (current->type != ID) {
@@ -73,11 +67,10 @@ ASTNode* statement() {
                 exit(1);
             }
 
-            char varName[MAX_VAR_NAME_LENGTH];
-            strcpy(varName, current->value);
+            InternId varName = current->id;
             
-            if (lookupSymbol(varName) != -1) {
-                printf("Error: Variable '%s' already declared\n", varName);
+            if (lookupCurrentScope(varName) != -1) {
+                printf("Error: Variable '%s' already declared in this scope\n", internedText(varName));
                 exit(1);
             }
             
@@ -87,7 +80,7 @@ ASTNode* statement() {
                 exit(1);
             }
             nextToken();
-            ASTNode *expr = parseExpression(0);
+            NodeId expr = parseExpression(0);
             if (current->type != SEMICOLON) {
                 printf("Error: Missing ';' after variable declaration\n");
                 exit(1);
@@ -95,13 +88,15 @@ ASTNode* statement() {
             nextToken();
             
             node = allocateNode(NODE_VAR_DECL);
-            strcpy(node->varDecl.name, varName);
-            node->varDecl.type = varType;
-            node->varDecl.value = expr;
+            nodeData(node)->varDecl.name = varName;
+            nodeData(node)->varDecl.type = varType;
+            nodeData(node)->varDecl.value = expr;
             
-            insertSymbol(varName, 0, varType);
+            // Declared after its initializer, so `num x = x;` in a block
+            // still reads the outer x
+            nodeData(node)->varDecl.symbol = insertSymbol(varName, 0, varType);
             
-            printf("Variable declaration parsed successfully\n");
+            LOG_DEBUG(LOG_PARSER, "Variable declaration parsed successfully\n");
             break;
         }
 
@@ -137,40 +132,40 @@ ASTNode* statement() {
 
         case PRINT: {
             nextToken();
-            ASTNode *expr = parseExpression(0);
+            NodeId expr = parseExpression(0);
             if (current->type != SEMICOLON) {
                 printf("Error: Missing ';' after print statement\n");
                 exit(1);
             }
             nextToken();
             node = allocateNode(NODE_PRINT);
-            node->print.expr = expr;
-            printf("Statement parsed successfully\n");
+            nodeData(node)->print.expr = expr;
+            LOG_DEBUG(LOG_PARSER, "Statement parsed successfully\n");
             break;
         }
 
         default: {
-            printf("Error: Unexpected statement\n type: %s , value %s \n", tokenTypeToString(current->type) , current->value);
+            printf("Error: Unexpected statement\n type: %s , value " TOKEN_FMT " \n", tokenTypeToString(current->type) , TOKEN_ARG(current));
             exit(1);
         }
     }
     
     if (node) {
-        if (node->next == node) {
+        if (nodeNext(node) == node) {
             printf("Warning: Circular reference detected in node. Setting next to NULL.\n");
-            node->next = NULL;
+            setNodeNext(node, NULL_NODE);
         }
-        switch (node->type) {
+        switch (nodeType(node)) {
             case NODE_ASSIGN:
-                if (node->assign.expr == node) {
+                if (nodeData(node)->assign.expr == node) {
                     printf("Warning: Circular reference in assignment expression. Setting to NULL.\n");
-                    node->assign.expr = NULL;
+                    nodeData(node)->assign.expr = NULL_NODE;
                 }
                 break;
             case NODE_VAR_DECL:
-                if (node->varDecl.value == node) {
+                if (nodeData(node)->varDecl.value == node) {
                     printf("Warning: Circular reference in variable declaration. Setting value to NULL.\n");
-                    node->varDecl.value = NULL;
+                    nodeData(node)->varDecl.value = NULL_NODE;
                 }
                 break;
         }
@@ -0,0 +1,192 @@
+#include "source.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define SOURCE_READ_CHUNK 65536
+
+/**
+ * @brief Reads a stream into a growable buffer.
+ *
+ * Used for pipes and other inputs that cannot be mapped. The buffer doubles
+ * whenever it fills up, so the whole read stays linear in the input size.
+ *
+ * @return 1 on success, 0 on failure.
+ */
+static int readSourceStream(FILE *file, SourceBuffer *source) {
+    size_t capacity = SOURCE_READ_CHUNK;
+    size_t length = 0;
+    char *data = malloc(capacity);
+    if (!data) {
+        return 0;
+    }
+
+    for (;;) {
+        if (capacity - length < SOURCE_READ_CHUNK + SOURCE_PADDING) {
+            capacity *= 2;
+            char *grown = realloc(data, capacity);
+            if (!grown) {
+                free(data);
+                return 0;
+            }
+            data = grown;
+        }
+        size_t count = fread(data + length, 1, SOURCE_READ_CHUNK, file);
+        length += count;
+        if (count < SOURCE_READ_CHUNK) {
+            break;
+        }
+    }
+
+    if (ferror(file)) {
+        free(data);
+        return 0;
+    }
+
+    memset(data + length, 0, SOURCE_PADDING);
+    source->data = data;
+    source->length = length;
+    source->mapSize = 0;
+    source->mapped = 0;
+    return 1;
+}
+
+#ifndef _WIN32
+/**
+ * @brief Maps a regular file copy-on-write with NUL padding after the text.
+ *
+ * An anonymous mapping one page larger than needed is reserved first and the
+ * file is mapped over its start, so the bytes after the end of the file are
+ * always zero. The mapping is writable because flex temporarily terminates
+ * yytext inside the buffer it scans.
+ *
+ * @return 1 on success, 0 if the file could not be mapped.
+ */
+static int mapSource(int fd, size_t length, SourceBuffer *source) {
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pageSize <= 0) {
+        pageSize = 4096;
+    }
+    size_t mapSize = (length + SOURCE_PADDING + (size_t)pageSize - 1) & ~((size_t)pageSize - 1);
+
+    char *base = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return 0;
+    }
+
+    void *file = mmap(base, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (file == MAP_FAILED) {
+        munmap(base, mapSize);
+        return 0;
+    }
+
+#ifdef MADV_SEQUENTIAL
+    madvise(base, length, MADV_SEQUENTIAL);
+#endif
+
+    source->data = base;
+    source->length = length;
+    source->mapSize = mapSize;
+    source->mapped = 1;
+    return 1;
+}
+#endif
+
+/**
+ * @brief Loads a whole source file into memory in a single read.
+ *
+ * Regular files are memory-mapped; anything else (pipes, character devices,
+ * or a failed mapping) falls back to a buffered read. Either way the text is
+ * followed by SOURCE_PADDING NUL bytes so the scanner can use it directly.
+ *
+ * @param filename The file to load.
+ * @param source Filled in with the loaded buffer.
+ * @return 1 on success, 0 on failure.
+ */
+int loadSource(const char *filename, SourceBuffer *source) {
+    memset(source, 0, sizeof(*source));
+
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        int ok = mapSource(fd, (size_t)info.st_size, source);
+        if (ok) {
+            close(fd);
+            return 1;
+        }
+    }
+
+    FILE *file = fdopen(fd, "rb");
+    if (!file) {
+        close(fd);
+        return 0;
+    }
+#else
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        return 0;
+    }
+#endif
+
+    int ok = readSourceStream(file, source);
+    fclose(file);
+    return ok;
+}
+
+/**
+ * @brief Hands the pages of a mapped source that lie wholly before offset
+ *        back to the OS, once nothing points into them any more.
+ *
+ * The mapping stays in place, so a page that is touched again is read back
+ * from the file. Sources read into malloc'd memory are kept whole.
+ */
+void releaseSourceBefore(SourceBuffer *source, size_t offset) {
+#if !defined(_WIN32) && defined(MADV_DONTNEED)
+    if (!source->mapped) {
+        return;
+    }
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pageSize <= 0) {
+        pageSize = 4096;
+    }
+    size_t end = offset & ~((size_t)pageSize - 1);
+    if (end > source->released) {
+        madvise(source->data + source->released, end - source->released, MADV_DONTNEED);
+        source->released = end;
+    }
+#else
+    (void)source;
+    (void)offset;
+#endif
+}
+
+/**
+ * @brief Releases a buffer returned by loadSource.
+ */
+void freeSource(SourceBuffer *source) {
+    if (!source->data) {
+        return;
+    }
+#ifndef _WIN32
+    if (source->mapped) {
+        munmap(source->data, source->mapSize);
+    } else {
+        free(source->data);
+    }
+#else
+    free(source->data);
+#endif
+    memset(source, 0, sizeof(*source));
+}
@@ -0,0 +1,21 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stddef.h>
+
+// Number of NUL bytes kept after the source text so flex can scan it in place
+#define SOURCE_PADDING 2
+
+typedef struct {
+    char *data;       // Source text followed by SOURCE_PADDING NUL bytes
+    size_t length;    // Length of the source text, padding excluded
+    size_t mapSize;   // Size of the mapping when the file was mmapped
+    int mapped;       // 1 if data is a private file mapping, 0 if malloc'd
+    size_t released;  // Bytes at the start handed back by releaseSourceBefore
+} SourceBuffer;
+
+int loadSource(const char *filename, SourceBuffer *source);
+void releaseSourceBefore(SourceBuffer *source, size_t offset);
+void freeSource(SourceBuffer *source);
+
+#endif // SOURCE_H
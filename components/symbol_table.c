@@ -1,60 +1,251 @@
 #include "symbol_table.h"
-#include <string.h>
+#include "log.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-Symbol symTable[MAX_SYMBOLS];
+#define INITIAL_SYMBOL_CAPACITY 64
+#define INITIAL_SCOPE_CAPACITY 16
+
+// Dense array of declarations in order, iterated by codegen for .data
+Symbol *symTable = NULL;
 int symCount = 0;
+static int symCapacity = 0;
+
+// Open-addressing index from each name seen so far to the declaration that
+// is visible now. A slot keeps its name once used, so names are never
+// deleted; leaving a scope just points the binding back at what it shadowed.
+typedef struct {
+    InternId name;      // INTERN_NONE marks an empty slot
+    int binding;        // Visible symbol id, or -1 if none is in scope
+} SymbolSlot;
+
+static SymbolSlot *symSlots = NULL;
+static unsigned int slotCapacity = 0;
+static unsigned int slotCount = 0;
+
+// Shadow stack: the ids of the declarations in every open scope, innermost
+// last. scopeStarts[d] is the stack height when scope d + 1 was entered.
+static int *declStack = NULL;
+static int declCount = 0;
+static int *scopeStarts = NULL;
+static int scopeCapacity = 0;
+static int depth = 0;
+
+static int activeLocalSlots = 0;
+int maxLocalSlots = 0;
+
+static void *symbolAlloc(size_t size) {
+    void *memory = malloc(size);
+    if (!memory) {
+        printf("Fatal error: Memory allocation failed for %zu bytes in symbol table\n", size);
+        exit(1);
+    }
+    return memory;
+}
+
+static void *symbolRealloc(void *memory, size_t size) {
+    void *grown = realloc(memory, size);
+    if (!grown) {
+        printf("Fatal error: Memory allocation failed for %zu bytes in symbol table\n", size);
+        exit(1);
+    }
+    return grown;
+}
+
+/**
+ * @brief Returns the slot holding a name, or the empty slot where it belongs.
+ */
+static SymbolSlot *findSlot(InternId name) {
+    unsigned int slot = internedHash(name) & (slotCapacity - 1);
+    while (symSlots[slot].name != INTERN_NONE && symSlots[slot].name != name) {
+        slot = (slot + 1) & (slotCapacity - 1);
+    }
+    return &symSlots[slot];
+}
+
+/**
+ * @brief Rebuilds the slot index at the given power-of-two capacity.
+ */
+static void rehashSymbols(unsigned int capacity) {
+    SymbolSlot *oldSlots = symSlots;
+    unsigned int oldCapacity = slotCapacity;
+
+    symSlots = symbolAlloc(capacity * sizeof(SymbolSlot));
+    memset(symSlots, 0, capacity * sizeof(SymbolSlot));
+    slotCapacity = capacity;
+
+    for (unsigned int i = 0; i < oldCapacity; i++) {
+        if (oldSlots[i].name != INTERN_NONE) {
+            *findSlot(oldSlots[i].name) = oldSlots[i];
+        }
+    }
+    free(oldSlots);
+}
 
 void initSymbolTable() {
-    printf("DEBUG: Initializing symbol table...\n");
+    LOG_DEBUG(LOG_SYMBOLS, "Initializing symbol table...\n");
+    freeSymbolTable();
+    symCapacity = INITIAL_SYMBOL_CAPACITY;
+    symTable = symbolAlloc(symCapacity * sizeof(Symbol));
+    declStack = symbolAlloc(symCapacity * sizeof(int));
+    scopeCapacity = INITIAL_SCOPE_CAPACITY;
+    scopeStarts = symbolAlloc(scopeCapacity * sizeof(int));
+    rehashSymbols(INITIAL_SYMBOL_CAPACITY * 2);
+    LOG_DEBUG(LOG_SYMBOLS, "Symbol table initialized, symCount = %d\n", symCount);
+}
+
+/**
+ * @brief Releases the symbol table. initSymbolTable() must run before reuse.
+ */
+void freeSymbolTable() {
+    free(symTable);
+    free(symSlots);
+    free(declStack);
+    free(scopeStarts);
+    symTable = NULL;
+    symSlots = NULL;
+    declStack = NULL;
+    scopeStarts = NULL;
     symCount = 0;
-    for (int i = 0; i < MAX_SYMBOLS; i++) {
-        symTable[i].name[0] = '\0';
-        symTable[i].value = 0;
-        symTable[i].type = TYPE_UNKNOWN;
+    symCapacity = 0;
+    slotCapacity = 0;
+    slotCount = 0;
+    declCount = 0;
+    scopeCapacity = 0;
+    depth = 0;
+    activeLocalSlots = 0;
+    maxLocalSlots = 0;
+}
+
+/**
+ * @brief Opens a nested scope. O(1).
+ */
+void enterScope() {
+    if (!symTable) {
+        initSymbolTable();
     }
-    printf("DEBUG: Symbol table initialized, symCount = %d\n", symCount);
+    if (depth == scopeCapacity) {
+        scopeCapacity *= 2;
+        scopeStarts = symbolRealloc(scopeStarts, scopeCapacity * sizeof(int));
+    }
+    scopeStarts[depth++] = declCount;
+    LOG_TRACE(LOG_SYMBOLS, "Entered scope %d\n", depth);
 }
 
-int insertSymbol(const char* name, int value, VariableType type) {
-    printf("DEBUG: Inserting symbol: name='%s', value=%d, type=%d\n", name, value, type);
-    
-    if (symCount >= MAX_SYMBOLS) {
-        printf("Error: Symbol table full\n");
-        return -1;
+/**
+ * @brief Closes the innermost scope, unhiding whatever its declarations
+ *        shadowed. Costs O(1) per declaration made in the scope.
+ */
+void exitScope() {
+    if (depth == 0) {
+        printf("Error: No scope to exit\n");
+        exit(1);
     }
+    int start = scopeStarts[--depth];
+    while (declCount > start) {
+        Symbol *symbol = &symTable[declStack[--declCount]];
+        findSlot(symbol->name)->binding = symbol->shadowed;
+        if (symbol->slot) {
+            activeLocalSlots--;
+        }
+    }
+    LOG_TRACE(LOG_SYMBOLS, "Exited scope %d\n", depth + 1);
+}
+
+int scopeDepth() {
+    return depth;
+}
+
+/**
+ * @brief Declares a name in the innermost scope, hiding any outer declaration
+ *        of the same name until the scope closes.
+ *
+ * Declarations below global scope get a stack slot; slots are reused once
+ * their scope has closed.
+ *
+ * @return The new symbol's id (its index in symTable).
+ */
+int insertSymbol(InternId name, int value, VariableType type) {
+    LOG_DEBUG(LOG_SYMBOLS, "Inserting symbol: name='%s', value=%d, type=%d\n", internedText(name), value, type);
+
+    if (!symTable) {
+        initSymbolTable();
+    }
+    if (symCount == symCapacity) {
+        symCapacity *= 2;
+        symTable = symbolRealloc(symTable, symCapacity * sizeof(Symbol));
+        declStack = symbolRealloc(declStack, symCapacity * sizeof(int));
+    }
+    // Keep the load factor at or below one half
+    if ((slotCount + 1) * 2 > slotCapacity) {
+        rehashSymbols(slotCapacity * 2);
+    }
+
+    SymbolSlot *slot = findSlot(name);
+    if (slot->name == INTERN_NONE) {
+        slot->name = name;
+        slot->binding = -1;
+        slotCount++;
+    }
+
+    Symbol *symbol = &symTable[symCount];
+    symbol->name = name;
+    symbol->value = value;
+    symbol->type = type; 
+    symbol->depth = depth;
+    symbol->shadowed = slot->binding;
+    symbol->slot = 0;
+    if (depth > 0) {
+        symbol->slot = ++activeLocalSlots;
+        if (activeLocalSlots > maxLocalSlots) {
+            maxLocalSlots = activeLocalSlots;
+        }
+    }
+
+    slot->binding = symCount;
+    declStack[declCount++] = symCount;
     
-    strcpy(symTable[symCount].name, name);
-    symTable[symCount].value = value;
-    symTable[symCount].type = type; 
-    
-    printf("DEBUG: Symbol inserted at index %d\n", symCount);
+    LOG_DEBUG(LOG_SYMBOLS, "Symbol inserted at index %d, scope %d\n", symCount, depth);
     
     return symCount++;
 }
 
-int lookupSymbol(const char* name) {
-    for (int i = 0; i < symCount; i++) {
-        if (strcmp(symTable[i].name, name) == 0) {
-            return i;
-        }
+/**
+ * @brief Finds the innermost visible declaration of a name in expected O(1).
+ *
+ * @return The symbol's id, or -1 if no declaration is in scope.
+ */
+int lookupSymbol(InternId name) {
+    if (!symSlots) {
+        return -1;
     }
-    return -1;
+    SymbolSlot *slot = findSlot(name);
+    return slot->name == name ? slot->binding : -1;
+}
+
+/**
+ * @brief Like lookupSymbol(), but only matches declarations made in the
+ *        innermost scope. Used to reject redeclarations.
+ */
+int lookupCurrentScope(InternId name) {
+    int index = lookupSymbol(name);
+    return index != -1 && symTable[index].depth == depth ? index : -1;
 }
 
-int getSymbolValue(const char* name) {
+int getSymbolValue(InternId name) {
     int index = lookupSymbol(name);
     if (index == -1) {
-        printf("Error: Symbol '%s' not found\n", name);
+        printf("Error: Symbol '%s' not found\n", internedText(name));
         return 0;
     }
     return symTable[index].value;
 }
 
-VariableType getSymbolType(const char* name) {
+VariableType getSymbolType(InternId name) {
     int index = lookupSymbol(name);
     if (index == -1) {
-        printf("Error: Symbol '%s' not found\n", name);
+        printf("Error: Symbol '%s' not found\n", internedText(name));
         return TYPE_UNKNOWN;
     }
     return symTable[index].type;
@@ -1,8 +1,7 @@
 #ifndef SYMBOL_TABLE_H
 #define SYMBOL_TABLE_H
 
-#define MAX_SYMBOLS 100
-#define MAX_VAR_NAME_LENGTH 50
+#include "interner.h"
 
 typedef enum {
     TYPE_UNKNOWN = -1,
@@ -11,19 +10,33 @@ typedef enum {
     TYPE_BOOLEAN
 } VariableType;
 
+// One declaration. A name declared in several scopes has one Symbol per
+// declaration; the index into symTable is the symbol's id.
 typedef struct {
-    char name[MAX_VAR_NAME_LENGTH];
+    InternId name;
     int value;
     VariableType type;
+    int depth;      // Scope depth of the declaration, 0 for globals
+    int slot;       // Stack slot of a local ([rbp - 8 * slot]), 0 for globals
+    int shadowed;   // Symbol this declaration hides while in scope, or -1
 } Symbol;
 
-extern Symbol symTable[MAX_SYMBOLS];
+// Every declaration in order; symTable[lookupSymbol(name)] is the entry
+extern Symbol *symTable;
 extern int symCount;
 
+// Most stack slots live at once, for sizing the frame of block locals
+extern int maxLocalSlots;
+
 void initSymbolTable();
-int insertSymbol(const char* name, int value, VariableType type);
-int lookupSymbol(const char* name);
-int getSymbolValue(const char* name);
-VariableType getSymbolType(const char* name); 
+void freeSymbolTable();
+void enterScope();
+void exitScope();
+int scopeDepth();
+int insertSymbol(InternId name, int value, VariableType type);
+int lookupSymbol(InternId name);
+int lookupCurrentScope(InternId name);
+int getSymbolValue(InternId name);
+VariableType getSymbolType(InternId name); 
 
 #endif // SYMBOL_TABLE_H
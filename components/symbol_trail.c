@@ -0,0 +1,164 @@
+#include "symbol_trail.h"
+#include "ast_walk.h"
+#include "memory.h"
+
+#define INITIAL_TRAIL_CAPACITY 64
+
+/**
+ * @brief Returns 1 for the nodes that repeat their body.
+ */
+int isLoopNode(NodeId node) {
+    switch (nodeType(node)) {
+        case NODE_WHILE:
+        case NODE_DO_WHILE:
+        case NODE_FOR:
+        case NODE_FUNC_DEF:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Sizes the per symbol arrays for every symbol. New symbols start
+ *        unknown, with marks zeroed so no mark matches an epoch by accident.
+ */
+void reserveTrailSymbols(SymbolTrail *trail) {
+    if (symCount <= trail->symbolCapacity) {
+        return;
+    }
+    int capacity = trail->symbolCapacity ? trail->symbolCapacity : INITIAL_TRAIL_CAPACITY;
+    while (capacity < symCount) {
+        capacity *= 2;
+    }
+    trail->values = growArray(trail->values, capacity, sizeof(int), "trail symbols");
+    trail->known = growArray(trail->known, capacity, sizeof(int), "trail symbols");
+    trail->marks = growArray(trail->marks, capacity, sizeof(int), "trail symbols");
+    trail->slots = growArray(trail->slots, capacity, sizeof(int), "trail symbols");
+    int added = capacity - trail->symbolCapacity;
+    memset(trail->values + trail->symbolCapacity, 0, added * sizeof(int));
+    memset(trail->known + trail->symbolCapacity, 0, added * sizeof(int));
+    memset(trail->marks + trail->symbolCapacity, 0, added * sizeof(int));
+    trail->symbolCapacity = capacity;
+}
+
+/**
+ * @brief Makes every symbol unknown, holding value, and empties the trail.
+ */
+void forgetSymbols(SymbolTrail *trail, int value) {
+    for (int i = 0; i < symCount; i++) {
+        trail->values[i] = value;
+        trail->known[i] = 0;
+    }
+    trail->trailCount = 0;
+    trail->savedCount = 0;
+}
+
+/**
+ * @brief Sets a symbol's state, saving the old one on the trail. An unknown
+ *        symbol's value is reset to 0.
+ */
+void setSymbolState(SymbolTrail *trail, int symbol, int known, int value) {
+    if (trail->known[symbol] == known && (!known || trail->values[symbol] == value)) {
+        return;
+    }
+    trail->trail = reserveArray(trail->trail, trail->trailCount, &trail->trailCapacity, INITIAL_TRAIL_CAPACITY,
+                                sizeof(SymbolState), "trail entries");
+    SymbolState *entry = &trail->trail[trail->trailCount++];
+    entry->symbol = symbol;
+    entry->value = trail->values[symbol];
+    entry->known = trail->known[symbol];
+    trail->values[symbol] = known ? value : 0;
+    trail->known[symbol] = known;
+}
+
+/**
+ * @brief Restores every symbol to its state when the trail was mark long.
+ */
+void undoTrail(SymbolTrail *trail, int mark) {
+    while (trail->trailCount > mark) {
+        SymbolState *entry = &trail->trail[--trail->trailCount];
+        trail->values[entry->symbol] = entry->value;
+        trail->known[entry->symbol] = entry->known;
+    }
+}
+
+/**
+ * @brief Appends to saved the current state of every symbol changed since
+ *        the trail was mark long, once per symbol.
+ */
+void saveChangedSymbols(SymbolTrail *trail, int mark) {
+    int epoch = ++trail->epoch;
+    for (int i = trail->trailCount - 1; i >= mark; i--) {
+        int symbol = trail->trail[i].symbol;
+        if (trail->marks[symbol] == epoch) {
+            continue;
+        }
+        trail->marks[symbol] = epoch;
+        trail->saved = reserveArray(trail->saved, trail->savedCount, &trail->savedCapacity, INITIAL_TRAIL_CAPACITY,
+                                    sizeof(SymbolState), "saved branch states");
+        SymbolState *entry = &trail->saved[trail->savedCount++];
+        entry->symbol = symbol;
+        entry->value = trail->values[symbol];
+        entry->known = trail->known[symbol];
+    }
+}
+
+static WalkAction enterAssignments(NodeId node, void *context) {
+    LoopAssignments *loops = context;
+    if (nodeType(node) == NODE_ASSIGN || nodeType(node) == NODE_VAR_DECL) {
+        loops->symbols = reserveArray(loops->symbols, loops->count, &loops->capacity, INITIAL_TRAIL_CAPACITY,
+                                      sizeof(int), "loop assignments");
+        loops->symbols[loops->count++] = nodeType(node) == NODE_ASSIGN ? nodeData(node)->assign.symbol
+                                                                       : nodeData(node)->varDecl.symbol;
+    } else if (isLoopNode(node)) {
+        loops->ranges = reserveArray(loops->ranges, loops->rangeCount, &loops->rangeCapacity,
+                                     INITIAL_TRAIL_CAPACITY, sizeof(AssignRange), "loop assignment ranges");
+        loops->open = reserveArray(loops->open, loops->openCount, &loops->openCapacity, INITIAL_TRAIL_CAPACITY,
+                                   sizeof(int), "loop assignment ranges");
+        loops->ranges[loops->rangeCount].first = loops->count;
+        loops->open[loops->openCount++] = loops->rangeCount++;
+    }
+    return WALK_CHILDREN;
+}
+
+static void leaveAssignments(NodeId node, void *context) {
+    LoopAssignments *loops = context;
+    if (isLoopNode(node)) {
+        AssignRange *range = &loops->ranges[loops->open[--loops->openCount]];
+        range->end = loops->count;
+        range->after = loops->rangeCount;
+    }
+}
+
+static const AstVisitor assignmentVisitor = { enterAssignments, NULL, leaveAssignments, WALK_NEXT_TAIL };
+
+/**
+ * @brief Lists the symbols every loop under root assigns, nested loops
+ *        included, before a pass that needs them on entering the loop.
+ */
+void findLoopAssignments(LoopAssignments *loops, NodeId root) {
+    loops->count = 0;
+    loops->rangeCount = 0;
+    loops->openCount = 0;
+    loops->cursor = 0;
+    if (root) {
+        walkAST(root, &assignmentVisitor, loops);
+    }
+}
+
+/**
+ * @brief Returns the range of the loop a pass is entering. Loops must be
+ *        entered in the order of the walk that found them.
+ */
+int enterLoopAssignments(LoopAssignments *loops) {
+    return loops->cursor++;
+}
+
+/**
+ * @brief Steps over the range of a loop a pass does not walk into, and the
+ *        ranges of the loops nested in it.
+ */
+void skipLoopAssignments(LoopAssignments *loops) {
+    loops->cursor = loops->ranges[loops->cursor].after;
+}
@@ -0,0 +1,70 @@
+#ifndef SYMBOL_TRAIL_H
+#define SYMBOL_TRAIL_H
+
+#include "ast.h"
+
+// A symbol's state, either as it was before a pass changed it (on the
+// trail) or as a branch left it (in saved)
+typedef struct {
+    int symbol;
+    int value;
+    int known;
+} SymbolState;
+
+// What a pass knows about every symbol at the current point of its walk,
+// and every change to it, oldest first, so the branches of an if can be
+// undone and joined
+typedef struct {
+    int *values;
+    int *known;
+    // Per symbol scratch for collecting and joining branches: marks[s] is
+    // the epoch that last saw s and slots[s] where its state was put
+    int *marks;
+    int *slots;
+    int symbolCapacity;
+    int epoch;
+    SymbolState *trail;
+    int trailCount;
+    int trailCapacity;
+    SymbolState *saved;
+    int savedCount;
+    int savedCapacity;
+} SymbolTrail;
+
+// The assignments inside a loop: symbols[first] to [end - 1]. Ranges are
+// numbered in the order the loops are entered; after is the first range
+// that is not nested in this one.
+typedef struct {
+    int first;
+    int end;
+    int after;
+} AssignRange;
+
+// Symbols assigned by each assignment and declaration, in walk order, and
+// the slice of them inside each loop
+typedef struct {
+    int *symbols;
+    int count;
+    int capacity;
+    AssignRange *ranges;
+    int rangeCount;
+    int rangeCapacity;
+    int *open;
+    int openCount;
+    int openCapacity;
+    int cursor;     // Next range to hand out as the pass enters a loop
+} LoopAssignments;
+
+int isLoopNode(NodeId node);
+
+void reserveTrailSymbols(SymbolTrail *trail);
+void forgetSymbols(SymbolTrail *trail, int value);
+void setSymbolState(SymbolTrail *trail, int symbol, int known, int value);
+void undoTrail(SymbolTrail *trail, int mark);
+void saveChangedSymbols(SymbolTrail *trail, int mark);
+
+void findLoopAssignments(LoopAssignments *loops, NodeId root);
+int enterLoopAssignments(LoopAssignments *loops);
+void skipLoopAssignments(LoopAssignments *loops);
+
+#endif // SYMBOL_TRAIL_H
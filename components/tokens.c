@@ -1,31 +1,155 @@
 #include "tokens.h"
+#include "symbol_table.h"
+#include "log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>  
+#include <limits.h>
 
-Token* head = NULL;
+#define INITIAL_TOKEN_CAPACITY 1024
+
+Token* tokens = NULL;
+int tokenCount = 0;
+int tokenIndex = 0;
+static int tokenCapacity = 0;
 Token* current = NULL;
 
-extern FILE *yyin;
-extern int tokenizer();
+// Start and end of the source buffer the token slices point into
+static const char* tokenSource = NULL;
+static const char* tokenSourceEnd = NULL;
 
-void addToken(TokenType type, const char* value) {
-    Token* token = malloc(sizeof(Token));
-    token->type = type;
-    strcpy(token->value, value);
-    token->next = NULL;
-    
-    if (!head) {
-        head = token;
-        current = token;
-    } else {
-        Token* temp = head;
-        while (temp->next) {
-            temp = temp->next;
+// 1 while the source has tokens left to scan
+static int scanning = 0;
+
+extern int beginSourceScan(char *base, size_t length);
+extern int scanSourceStatement();
+
+/**
+ * @brief Decodes the integer value of a NUMBER lexeme.
+ */
+static int decodeNumber(const char* text, int length) {
+    long long value = 0;
+    for (int i = 0; i < length; i++) {
+        value = value * 10 + (text[i] - '0');
+        if (value > INT_MAX) {
+            printf("Error: Number literal '%.*s' is out of range\n", length, text);
+            exit(1);
+        }
+    }
+    return (int)value;
+}
+
+/**
+ * @brief Appends a token to the token buffer.
+ *
+ * The token records where its lexeme sits in the source buffer rather than
+ * copying it; literal payloads are decoded here once. The buffer doubles
+ * when full, so appending is amortized O(1).
+ *
+ * @param type The token type.
+ * @param text The lexeme, pointing into the buffer being tokenized.
+ * @param length The lexeme length in bytes.
+ */
+void addToken(TokenType type, const char* text, int length) {
+    if (tokenCount == tokenCapacity) {
+        int newCapacity = tokenCapacity ? tokenCapacity * 2 : INITIAL_TOKEN_CAPACITY;
+        Token* grown = realloc(tokens, (size_t)newCapacity * sizeof(Token));
+        if (!grown) {
+            printf("Fatal error: Memory allocation failed for %d tokens\n", newCapacity);
+            exit(1);
         }
-        temp->next = token;
+        tokens = grown;
+        tokenCapacity = newCapacity;
+    }
+
+    Token* token = &tokens[tokenCount++];
+    token->type = type;
+    token->offset = (unsigned int)(text - tokenSource);
+    token->length = (unsigned int)length;
+
+    switch (type) {
+        case NUMBER:
+            token->number = decodeNumber(text, length);
+            break;
+        case BOOLEAN_LITERAL:
+            token->boolean = text[0] == 't';
+            break;
+        case VAR:
+            token->varType = text[0] == 's' ? TYPE_STRING : text[0] == 'l' ? TYPE_BOOLEAN : TYPE_NUMBER;
+            break;
+        case ID:
+            token->id = internString(text, (size_t)length);
+            break;
+        case STRING_LITERAL:
+            token->id = internString(text + 1, (size_t)length - 2);
+            break;
+        default:
+            token->number = 0;
+            break;
+    }
+}
+
+/**
+ * @brief Returns the start of a token's lexeme. It is not NUL-terminated.
+ */
+const char* tokenText(const Token* token) {
+    return tokenSource + token->offset;
+}
+
+/**
+ * @brief Checks whether a token's lexeme is exactly the given text.
+ */
+int tokenEquals(const Token* token, const char* text) {
+    size_t length = strlen(text);
+    return token->length == length && memcmp(tokenText(token), text, length) == 0;
+}
+
+/**
+ * @brief Copies a token's lexeme into a NUL-terminated buffer.
+ *
+ * Exits with an error if the lexeme does not fit.
+ */
+void copyTokenText(const Token* token, char* dest, size_t size) {
+    if (token->length >= size) {
+        printf("Error: Identifier '" TOKEN_FMT "' is longer than %zu characters\n", TOKEN_ARG(token), size - 1);
+        exit(1);
     }
+    memcpy(dest, tokenText(token), token->length);
+    dest[token->length] = '\0';
+}
+
+/**
+ * @brief Positions current at the first token.
+ */
+void rewindTokens() {
+    tokenIndex = 0;
+    current = tokenCount > 0 ? &tokens[0] : NULL;
+}
+
+/**
+ * @brief Drops the tokens before current, which the parser is done with.
+ *
+ * Moves the rest to the front of the buffer, so a lazily scanned buffer
+ * only ever holds the statement being parsed.
+ */
+void dropParsedTokens() {
+    memmove(tokens, current, (size_t)(tokenCount - tokenIndex) * sizeof(Token));
+    tokenCount -= tokenIndex;
+    tokenIndex = 0;
+    current = tokens;
+}
+
+/**
+ * @brief Releases the token buffer.
+ */
+void freeTokens() {
+    free(tokens);
+    tokens = NULL;
+    tokenCount = 0;
+    tokenCapacity = 0;
+    tokenIndex = 0;
+    current = NULL;
 }
 
 const char* tokenTypeToString(TokenType type) {
@@ -63,14 +187,56 @@ const char* tokenTypeToString(TokenType type) {
     }
 }
 
-void tokenize(FILE *file) {
-    if (!file) {
-        perror("Failed to open source file");
+static void beginScan(SourceBuffer *source) {
+    if (!source || !source->data) {
+        printf("Error: No source buffer to tokenize\n");
+        exit(1);
+    }
+    tokenSource = source->data;
+    tokenSourceEnd = source->data + source->length;
+    if (!beginSourceScan(source->data, source->length)) {
+        printf("Error: Source buffer is missing its end-of-buffer padding\n");
         exit(1);
     }
-    rewind(file);
-    yyin = file;
-    tokenizer();
-    
-    printf("\nTokenizing completed!\n");
+    scanning = 1;
+}
+
+/**
+ * @brief Appends the tokens of the source up to and including the next ';'
+ *        or '}', and the END token once the source runs out.
+ *
+ * @return 1 if more tokens may follow, 0 once END has been added.
+ */
+int scanMoreTokens() {
+    if (!scanning) {
+        return 0;
+    }
+    if (scanSourceStatement()) {
+        return 1;
+    }
+    addToken(END, tokenSourceEnd, 0);
+    scanning = 0;
+    LOG_INFO(LOG_LEXER, "\nTokenizing completed!\n");
+    return 0;
+}
+
+/**
+ * @brief Scans the whole source into the token buffer.
+ */
+void tokenize(SourceBuffer *source) {
+    beginScan(source);
+    while (scanMoreTokens()) {
+    }
+    rewindTokens();
+}
+
+/**
+ * @brief Scans the source lazily: only the first statement's tokens are
+ *        read now, and nextToken() scans more as the parser reaches the end
+ *        of the buffer.
+ */
+void tokenizeLazily(SourceBuffer *source) {
+    beginScan(source);
+    scanMoreTokens();
+    rewindTokens();
 }
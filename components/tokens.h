@@ -2,6 +2,8 @@
 #define TOKENS_H
 
 #include <stdio.h>
+#include "source.h"
+#include "interner.h"
 
 typedef enum {
     UNKNOWN,
@@ -35,19 +37,49 @@ typedef enum {
     END
 } TokenType;
 
+// A token is a slice of the loaded source buffer plus a payload decoded once
+// by the lexer, so scanning allocates nothing per token.
 typedef struct Token {
     TokenType type;
-    char value[100];
-    struct Token* next;
+    unsigned int offset;    // Byte offset of the lexeme in the source
+    unsigned int length;    // Length of the lexeme in bytes
+    union {
+        // NUMBER: the decoded integer value
+        int number;
+
+        // BOOLEAN_LITERAL: 1 for true, 0 for false
+        int boolean;
+
+        // VAR: the declared VariableType (num, str or log)
+        int varType;
+
+        // ID: the interned name; STRING_LITERAL: the interned text between the quotes
+        InternId id;
+    };
 } Token;
 
-void addToken(TokenType type, const char* value);
+void addToken(TokenType type, const char* text, int length);
+const char* tokenText(const Token* token);
+int tokenEquals(const Token* token, const char* text);
+void copyTokenText(const Token* token, char* dest, size_t size);
 const char* tokenTypeToString(TokenType type);
-void tokenize(FILE *file);
+void tokenize(SourceBuffer *source);
+void tokenizeLazily(SourceBuffer *source);
+int scanMoreTokens();
+void rewindTokens();
+void dropParsedTokens();
+void freeTokens();
 
-extern Token* head;
+// Tokens live in one contiguous buffer ending with an END sentinel, or, when
+// scanned lazily, with the last token scanned so far; current always points
+// at tokens[tokenIndex] once parsing starts.
+extern Token* tokens;
+extern int tokenCount;
+extern int tokenIndex;
 extern Token* current;
 
-#endif // TOKENS_H
+// printf helpers for token slices, e.g. printf("'" TOKEN_FMT "'", TOKEN_ARG(current))
+#define TOKEN_FMT "%.*s"
+#define TOKEN_ARG(token) (int)(token)->length, tokenText(token)
 
-#define END_OF_FILE 999
+#endif // TOKENS_H
@@ -5,14 +5,14 @@
 #include "components/tokens.h"
 #include "components/ast.h"
 
-void tokenize(FILE *file);
-ASTNode* statement();
+void tokenize(SourceBuffer *source);
+NodeId statement();
 void nextToken();
-ASTNode* parseExpression(int minPrecedence);
-ASTNode* conditional();
-ASTNode* loop();
-ASTNode* doWhileLoop();
-ASTNode* forLoop();
-ASTNode* functionDef();
+NodeId parseExpression(int minPrecedence);
+NodeId conditional();
+NodeId loop();
+NodeId doWhileLoop();
+NodeId forLoop();
+NodeId functionDef();
 
 #endif // PARSER_H
@@ -1,34 +1,30 @@
 #include "semantic.h"
 #include "components/generator/codegen.h"
 #include "components/ast.h"
+#include "components/memory.h"
+#include "components/ast_walk.h"
 #include "components/symbol_table.h"
+#include "components/log.h"
+#include "components/optimizer/optimizer.h"
+#include "components/ir/ir.h"
 #include <stdio.h>
 #include <stdlib.h>
 
-#define MAX_VISITED_NODES 1000
-ASTNode* semanticVisitedNodes[MAX_VISITED_NODES];
-int semanticVisitedCount = 0;
+// Visit epoch of the current semantic walk
+static unsigned int semanticEpoch = 0;
 
-int semanticHasVisited(ASTNode* node) {
-    printf("Checking if node %p has been visited before\n", (void*)node);
-    for (int i = 0; i < semanticVisitedCount; i++) {
-        if (semanticVisitedNodes[i] == node) {
-            printf("Node %p has been visited before\n", (void*)node);
-            return 1;
-        }
-    }
-    printf("Node %p has not been visited before\n", (void*)node);
-    return 0;
+int semanticHasVisited(NodeId node) {
+    int visited = nodeVisited(node, semanticEpoch);
+    LOG_TRACE(LOG_SEMANTIC, "Node %u has %sbeen visited before\n", node, visited ? "" : "not ");
+    return visited;
 }
 
-void semanticMarkVisited(ASTNode* node) {
-    if (semanticVisitedCount < MAX_VISITED_NODES) {
-        semanticVisitedNodes[semanticVisitedCount++] = node;
-    }
+void semanticMarkVisited(NodeId node) {
+    markNodeVisited(node, semanticEpoch);
 }
 
 void semanticResetVisited() {
-    semanticVisitedCount = 0;
+    semanticEpoch = beginVisit();
 }
 
 const char* typeToString(int type) {
@@ -43,46 +39,50 @@ const char* typeToString(int type) {
 void dumpSymbolTable() {
     printf("=== SYMBOL TABLE DUMP ===\n");
     for (int i = 0; i < symCount; i++) {
-        printf("Symbol[%d]: name='%s', type=%d, value=%d\n", 
-               i, symTable[i].name, symTable[i].type, symTable[i].value);
+        printf("Symbol[%d]: name='%s', type=%d, value=%d, depth=%d, slot=%d\n", 
+               i, internedText(symTable[i].name), symTable[i].type, symTable[i].value,
+               symTable[i].depth, symTable[i].slot);
     }
     printf("========================\n");
 }
 
-void checkSemantic(ASTNode *node) {
-    if (!node) {
-        printf("Warning: Null node encountered in semantic analysis\n");
-        return;
-    }
+/**
+ * @brief Checks one node on entry. Expression types are already cached by
+ *        annotateTypes(), so no check needs the children walked first.
+ */
+static WalkAction enterSemantic(NodeId node, void *context) {
+    (void)context;
 
-    dumpSymbolTable();
+    if (LOG_ENABLED(LOG_SYMBOLS, LOG_LEVEL_TRACE)) {
+        dumpSymbolTable();
+    }
 
     if (semanticHasVisited(node)) {
         printf("Warning: Circular reference detected in AST. Skipping node.\n");
-        return;
+        return WALK_PRUNE;
     }
     
     semanticMarkVisited(node);
 
-    printf("Checking node type: %d\n", node->type);
+    LOG_TRACE(LOG_SEMANTIC, "Checking node type: %d\n", nodeType(node));
 
-    switch (node->type) {
+    switch (nodeType(node)) {
         case NODE_ASSIGN:
-            printf("Checking assignment to: %s\n", node->assign.name);
-            if (lookupSymbol(node->assign.name) == -1) { 
-                printf("Semantic Error: Variable '%s' not declared before assignment\n", node->assign.name);
+            LOG_DEBUG(LOG_SEMANTIC, "Checking assignment to: %s\n", internedText(nodeData(node)->assign.name));
+            if (nodeData(node)->assign.symbol < 0) { 
+                printf("Semantic Error: Variable '%s' not declared before assignment\n", internedText(nodeData(node)->assign.name));
                 exit(1);
             }
-            printf("Variable '%s' found in symbol table\n", node->assign.name);
+            LOG_DEBUG(LOG_SEMANTIC, "Variable '%s' found in symbol table\n", internedText(nodeData(node)->assign.name));
             
-            if (node->assign.expr) {
-                int exprType = getExprType(node->assign.expr);
-                int varType = getSymbolType(node->assign.name);
-                printf("Variable type: %d, Expression type: %d\n", varType, exprType);
+            if (nodeData(node)->assign.expr) {
+                int exprType = getExprType(nodeData(node)->assign.expr);
+                int varType = symTable[nodeData(node)->assign.symbol].type;
+                LOG_DEBUG(LOG_SEMANTIC, "Variable type: %d, Expression type: %d\n", varType, exprType);
                 
                 if (varType != exprType && exprType != TYPE_UNKNOWN) {
                     printf("Semantic Error: Type mismatch in assignment to '%s'. Cannot assign %s to %s\n", 
-                           node->assign.name, 
+                           internedText(nodeData(node)->assign.name), 
                            typeToString(exprType), 
                            typeToString(varType));
                     exit(1);
@@ -90,140 +90,148 @@ void checkSemantic(ASTNode *node) {
             } else {
                 printf("Warning: Null expression in assignment\n");
             }
-            
-            if (node->assign.expr) {
-                checkSemantic(node->assign.expr);
-            }
             break;
 
         case NODE_VAR_DECL:
-            printf("Checking variable declaration: %s\n", node->varDecl.name);
+            LOG_DEBUG(LOG_SEMANTIC, "Checking variable declaration: %s\n", internedText(nodeData(node)->varDecl.name));
             
-            if (node->varDecl.value) {
-                int declaredType = node->varDecl.type;
-                int valueType = getExprType(node->varDecl.value);
+            if (nodeData(node)->varDecl.value) {
+                int declaredType = nodeData(node)->varDecl.type;
+                int valueType = getExprType(nodeData(node)->varDecl.value);
                 
-                printf("Variable type: %d, Value type: %d\n", declaredType, valueType);
+                LOG_DEBUG(LOG_SEMANTIC, "Variable type: %d, Value type: %d\n", declaredType, valueType);
                 
                 if (declaredType != valueType && valueType != TYPE_UNKNOWN) {
                     printf("Semantic Error: Type mismatch in declaration of '%s'. Cannot assign %s to %s\n", 
-                           node->varDecl.name, 
+                           internedText(nodeData(node)->varDecl.name), 
                            typeToString(valueType), 
                            typeToString(declaredType));
                     exit(1);
                 }
-                
-                checkSemantic(node->varDecl.value);
             }
             break;
 
         case NODE_FUNC_CALL:
-            printf("Checking function call: %s\n", node->funcCall.name);
-            if (lookupSymbol(node->funcCall.name) == -1) { 
-                printf("Semantic Error: Function '%s' is not defined\n", node->funcCall.name);
+            LOG_DEBUG(LOG_SEMANTIC, "Checking function call: %s\n", internedText(nodeData(node)->funcCall.name));
+            if (lookupSymbol(nodeData(node)->funcCall.name) == -1) { 
+                printf("Semantic Error: Function '%s' is not defined\n", internedText(nodeData(node)->funcCall.name));
                 exit(1);
             }
             
-            printf("Function '%s' found in symbol table\n", node->funcCall.name);
-            
-            if (node->funcCall.args) {
-                checkSemantic(node->funcCall.args);
-            }
+            LOG_DEBUG(LOG_SEMANTIC, "Function '%s' found in symbol table\n", internedText(nodeData(node)->funcCall.name));
             break;
 
         case NODE_FUNC_DEF:
-            printf("Checking function definition: %s\n", node->funcDef.name);
-            if (node->funcDef.body) {
-                checkSemantic(node->funcDef.body);
-            }
+            LOG_DEBUG(LOG_SEMANTIC, "Checking function definition: %s\n", internedText(nodeData(node)->funcDef.name));
             break;
 
         case NODE_IF:
-            printf("Checking if statement\n");
-            if (node->ifNode.condition) {
-                checkSemantic(node->ifNode.condition);
-            }
-            if (node->ifNode.thenStmt) {
-                checkSemantic(node->ifNode.thenStmt);
-            }
-            if (node->ifNode.elseStmt) {
-                checkSemantic(node->ifNode.elseStmt);
-            }
+            LOG_DEBUG(LOG_SEMANTIC, "Checking if statement\n");
             break;
 
         case NODE_WHILE:
-            printf("Checking while loop\n");
-            if (node->whileNode.condition) {
-                checkSemantic(node->whileNode.condition);
-            }
-            if (node->whileNode.body) {
-                checkSemantic(node->whileNode.body);
-            }
+            LOG_DEBUG(LOG_SEMANTIC, "Checking while loop\n");
             break;
 
         case NODE_FOR:
-            printf("Checking for loop\n");
-            if (node->forNode.initialization) {
-                checkSemantic(node->forNode.initialization);
-            }
-            if (node->forNode.condition) {
-                checkSemantic(node->forNode.condition);
-            }
-            if (node->forNode.increment) {
-                checkSemantic(node->forNode.increment);
-            }
-            if (node->forNode.body) {
-                checkSemantic(node->forNode.body);
-            }
+            LOG_DEBUG(LOG_SEMANTIC, "Checking for loop\n");
             break;
 
         case NODE_DO_WHILE:
-            printf("Checking do-while loop\n");
-            if (node->doWhileNode.body) {
-                checkSemantic(node->doWhileNode.body);
-            }
-            if (node->doWhileNode.condition) {
-                checkSemantic(node->doWhileNode.condition);
-            }
+            LOG_DEBUG(LOG_SEMANTIC, "Checking do-while loop\n");
             break;
 
         case NODE_PRINT:
-            printf("Checking print statement\n");
-            if (node->print.expr) {
-                checkSemantic(node->print.expr);
-            }
+            LOG_DEBUG(LOG_SEMANTIC, "Checking print statement\n");
             break;
 
         case NODE_BINARY_OP:
-            printf("Checking binary operation: %c\n", node->binaryOp.op);
-            if (node->binaryOp.left) {
-                checkSemantic(node->binaryOp.left);
+            LOG_DEBUG(LOG_SEMANTIC, "Checking binary operation: %s\n", opCodeText(nodeData(node)->binaryOp.op));
+            if ((getExprType(nodeData(node)->binaryOp.left) != TYPE_NUMBER && getExprType(nodeData(node)->binaryOp.left) != TYPE_UNKNOWN) ||
+                (getExprType(nodeData(node)->binaryOp.right) != TYPE_NUMBER && getExprType(nodeData(node)->binaryOp.right) != TYPE_UNKNOWN)) {
+                printf("Semantic Error: Operator '%s' needs numbers, got %s and %s\n",
+                       opCodeText(nodeData(node)->binaryOp.op),
+                       typeToString(getExprType(nodeData(node)->binaryOp.left)),
+                       typeToString(getExprType(nodeData(node)->binaryOp.right)));
+                exit(1);
             }
-            if (node->binaryOp.right) {
-                checkSemantic(node->binaryOp.right);
+            break;
+
+        case NODE_RELATIONAL_OP: {
+            OpCode op = nodeData(node)->relOp.op;
+            int leftType = getExprType(nodeData(node)->relOp.left);
+            int rightType = getExprType(nodeData(node)->relOp.right);
+            LOG_DEBUG(LOG_SEMANTIC, "Checking relational operation: %s\n", opCodeText(op));
+
+            switch (op) {
+                case OP_EQ:
+                case OP_NE:
+                    if (leftType != rightType && leftType != TYPE_UNKNOWN && rightType != TYPE_UNKNOWN) {
+                        printf("Semantic Error: Cannot compare %s with %s using '%s'\n",
+                               typeToString(leftType), typeToString(rightType), opCodeText(op));
+                        exit(1);
+                    }
+                    break;
+                default:
+                    if ((leftType != TYPE_NUMBER && leftType != TYPE_UNKNOWN) ||
+                        (rightType != TYPE_NUMBER && rightType != TYPE_UNKNOWN)) {
+                        printf("Semantic Error: Operator '%s' needs numbers, got %s and %s\n",
+                               opCodeText(op), typeToString(leftType), typeToString(rightType));
+                        exit(1);
+                    }
+                    break;
             }
             break;
+        }
+
+        case NODE_LOGICAL_OP: {
+            OpCode op = nodeData(node)->logicalOp.op;
+            int leftType = getExprType(nodeData(node)->logicalOp.left);
+            int rightType = getExprType(nodeData(node)->logicalOp.right);
+            LOG_DEBUG(LOG_SEMANTIC, "Checking logical operation: %s\n", opCodeText(op));
+
+            // && and || compile to bitwise and/or, so only 0/1 operands are safe
+            if ((leftType != TYPE_BOOLEAN && leftType != TYPE_UNKNOWN) ||
+                (rightType != TYPE_BOOLEAN && rightType != TYPE_UNKNOWN)) {
+                printf("Semantic Error: Operator '%s' needs booleans, got %s and %s\n",
+                       opCodeText(op), typeToString(leftType), typeToString(rightType));
+                exit(1);
+            }
+            break;
+        }
 
         case NODE_NUMBER:
-            printf("Checking number: %d\n", node->number);
+            LOG_DEBUG(LOG_SEMANTIC, "Checking number: %d\n", nodeData(node)->number);
             break;
 
         case NODE_STRING_LITERAL:
-            printf("Checking string literal: %s\n", node->stringLiteral.value);
+            LOG_DEBUG(LOG_SEMANTIC, "Checking string literal: %s\n", internedText(nodeData(node)->stringLiteral.value));
             break;
 
         default:
-            printf("Warning: Unhandled node type %d in semantic analysis\n", node->type);
+            LOG_DEBUG(LOG_SEMANTIC, "Unhandled node type %d in semantic analysis\n", nodeType(node));
             break;
     }
 
-    // Check the next node in the list
-    printf("Checking next node\n");
-    if (node->next) {
-        checkSemantic(node->next);
-    } else {
-        printf("No more nodes to check\n");
+    return WALK_CHILDREN;
+}
+
+static const AstVisitor semanticVisitor = { enterSemantic, NULL, NULL, WALK_NEXT_TAIL };
+
+void checkSemantic(NodeId node) {
+    if (!node) {
+        printf("Warning: Null node encountered in semantic analysis\n");
+        return;
     }
+    walkAST(node, &semanticVisitor, NULL);
+}
+
+/**
+ * @brief Checks a single top-level statement, for --stream mode.
+ */
+void analyzeStatement(NodeId node) {
+    semanticResetVisited();
+    checkSemantic(node);
 }
 
 /**
@@ -231,10 +239,11 @@ void checkSemantic(ASTNode *node) {
  * 
  * @param root The root node of the AST.
  * @param outputFile The output file name for the assembly code.
+ * @param target EMIT_IR to write the textual IR instead of assembly.
  * @return void
  */
-void analyzeAndGenerateCode(ASTNode *root, const char *outputFile) {
-    printf("Starting semantic analysis...\n");
+void analyzeAndGenerateCode(NodeId root, const char *outputFile, EmitTarget target) {
+    LOG_INFO(LOG_SEMANTIC, "Starting semantic analysis...\n");
     
     if (!root) {
         printf("Error: AST is empty. No code to analyze.\n");
@@ -242,35 +251,75 @@ void analyzeAndGenerateCode(ASTNode *root, const char *outputFile) {
     }
     
     semanticResetVisited();
+    annotateTypes(NULL_NODE);
     
-    printf("Checking AST...\n");
+    LOG_DEBUG(LOG_SEMANTIC, "Checking AST...\n");
     checkSemantic(root);
     
-    printf("Semantic analysis completed successfully.\n");
+    LOG_INFO(LOG_SEMANTIC, "Semantic analysis completed successfully.\n");
+
+    astHead = optimizeAST(root, 1);
+    logOptimizerStats();
     
-    printf("Generating assembly code to: %s\n", outputFile);
+    if (target == EMIT_IR) {
+        LOG_INFO(LOG_IR, "Writing IR to: %s\n", outputFile);
+        lowerProgram(astHead);
+        verifyIR();
+        writeIR(outputFile);
+        freeIR();
+        return;
+    }
+
+    LOG_INFO(LOG_CODEGEN, "Generating assembly code to: %s\n", outputFile);
     
     generateAssembly(outputFile);
     
-    printf("Code generation completed successfully.\n");
+    LOG_INFO(LOG_CODEGEN, "Code generation completed successfully.\n");
 }
 
-int getExprType(ASTNode *expr) {
-    if (!expr) return TYPE_UNKNOWN;
-    
-    switch (expr->type) {
-        case NODE_NUMBER:
-            return TYPE_NUMBER;
-        case NODE_STRING_LITERAL:
-            return TYPE_STRING;
-        case NODE_BOOLEAN_LITERAL:
-            return TYPE_BOOLEAN;
-        case NODE_VAR_REF:
-            return getSymbolType(expr->varRef.name);
-        case NODE_BINARY_OP:
-            // Binary operations typically result in numbers
-            return TYPE_NUMBER;
-        default:
-            return TYPE_UNKNOWN;
+/**
+ * @brief Infers and caches the type of every expression node from the given
+ *        node to the end of the pool.
+ *
+ * The parser creates an expression's operands before the expression itself,
+ * so a single sweep in node order is bottom-up: no recursion, and each node
+ * is typed once. Variable references take their type from the symbol the
+ * parser resolved them to. Call this before checkSemantic(); later passes
+ * read the result with getExprType() or nodeValueType().
+ *
+ * @param first The first node to annotate; NULL_NODE means the whole pool.
+ */
+void annotateTypes(NodeId first) {
+    unsigned int end = nodePool.count;
+    for (NodeId node = first ? first : 1; node < end; node++) {
+        switch (nodeType(node)) {
+            case NODE_NUMBER:
+            case NODE_BINARY_OP:
+                setNodeValueType(node, TYPE_NUMBER);
+                break;
+            case NODE_STRING_LITERAL:
+                setNodeValueType(node, TYPE_STRING);
+                break;
+            case NODE_BOOLEAN_LITERAL:
+            case NODE_RELATIONAL_OP:
+            case NODE_LOGICAL_OP:
+            case NODE_COMPARISON_OP:
+                setNodeValueType(node, TYPE_BOOLEAN);
+                break;
+            case NODE_VAR_REF:
+                setNodeValueType(node, symTable[nodeData(node)->varRef.symbol].type);
+                break;
+            default:
+                break;
+        }
     }
+    LOG_DEBUG(LOG_SEMANTIC, "Annotated types of nodes %u to %u\n", first ? first : 1, end - 1);
+}
+
+/**
+ * @brief Returns the type annotateTypes() cached for an expression.
+ */
+int getExprType(NodeId expr) {
+    if (!expr) return TYPE_UNKNOWN;
+    return nodeValueType(expr);
 }
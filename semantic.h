@@ -3,10 +3,20 @@
 
 #include "components/ast.h"
 
-void checkSemantic(ASTNode *node);
+// What a whole-program compile writes
+typedef enum {
+    EMIT_ASSEMBLY,
+    EMIT_IR         // The textual IR, for --emit=ir
+} EmitTarget;
 
-void analyzeAndGenerateCode(ASTNode *root, const char *outputFile);
+void checkSemantic(NodeId node);
 
-int getExprType(ASTNode *expr);
+void annotateTypes(NodeId first);
+
+void analyzeStatement(NodeId node);
+
+void analyzeAndGenerateCode(NodeId root, const char *outputFile, EmitTarget target);
+
+int getExprType(NodeId expr);
 
 #endif // SEMANTIC_H
@@ -4,6 +4,13 @@
  * @brief Displays the help message.
  */
 void help(){
-    printf("cmpx <filename.cx> - Compiles the given file.\n");
+    printf("cmpx [options] <filename.cx> - Compiles the given file.\n");
     printf("-help - Displays this help message.\n");
-}
\ No newline at end of file
+    printf("-v, -vv, -vvv - Logs compiler progress at info, debug or trace level.\n");
+    printf("--log=<spec> - Sets log levels, e.g. --log=debug or --log=parser:trace,codegen:info.\n");
+    printf("               Categories: driver, lexer, parser, symbols, semantic, optimizer, ir, codegen.\n");
+    printf("               Levels: off, info, debug, trace.\n");
+    printf("--stream - Compiles one top-level statement at a time, releasing each one's AST\n");
+    printf("           before parsing the next. Skips the AST visualizer and JSON export.\n");
+    printf("--emit=asm|ir - Writes assembly (the default) or the SSA IR to <filename>.ir.\n");
+}
@@ -0,0 +1,173 @@
+/*
+ * Generates components/keywords.h, a perfect hash over the CX keywords.
+ *
+ * The hash is gperf-style: length plus an associated value for the first and
+ * last character, masked to the table size. The associated values are found
+ * by a deterministic search at build time, so the only thing to edit when a
+ * keyword is added is the list below.
+ *
+ * Usage: keyword_gen > components/keywords.h
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const char *name;
+    const char *type;
+} KeywordSpec;
+
+static const KeywordSpec keywords[] = {
+    { "num",   "VAR" },
+    { "log",   "VAR" },
+    { "str",   "VAR" },
+    { "if",    "IF" },
+    { "else",  "ELSE" },
+    { "while", "WHILE" },
+    { "for",   "FOR" },
+    { "do",    "DO" },
+    { "func",  "FUNC" },
+    { "call",  "CALL" },
+    { "print", "PRINT" },
+    { "true",  "BOOLEAN_LITERAL" },
+    { "false", "BOOLEAN_LITERAL" },
+};
+
+#define KEYWORD_COUNT ((int)(sizeof(keywords) / sizeof(keywords[0])))
+#define MAX_TABLE_SIZE 256
+#define MAX_ATTEMPTS 1000000
+
+static unsigned int asso[256];
+
+static unsigned int hashKeyword(const char *name, unsigned int mask) {
+    size_t length = strlen(name);
+    return ((unsigned int)length + asso[(unsigned char)name[0]] +
+            asso[(unsigned char)name[length - 1]]) & mask;
+}
+
+/**
+ * @brief Searches for associated values that make the hash collision-free.
+ *
+ * Uses a fixed-seed linear congruential generator so the output is the same
+ * on every build.
+ *
+ * @return 1 if a perfect hash was found for the given table size.
+ */
+static int findAssoValues(unsigned int tableSize) {
+    unsigned int seed = 12345;
+    unsigned int mask = tableSize - 1;
+
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+        memset(asso, 0, sizeof(asso));
+        for (int i = 0; i < KEYWORD_COUNT; i++) {
+            const char *name = keywords[i].name;
+            unsigned char first = (unsigned char)name[0];
+            unsigned char last = (unsigned char)name[strlen(name) - 1];
+            seed = seed * 1103515245u + 12345u;
+            asso[first] = (seed >> 16) & mask;
+            seed = seed * 1103515245u + 12345u;
+            asso[last] = (seed >> 16) & mask;
+        }
+
+        int used[MAX_TABLE_SIZE] = {0};
+        int ok = 1;
+        for (int i = 0; i < KEYWORD_COUNT && ok; i++) {
+            unsigned int slot = hashKeyword(keywords[i].name, mask);
+            if (used[slot]) {
+                ok = 0;
+            }
+            used[slot] = 1;
+        }
+        if (ok) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void) {
+    unsigned int tableSize = 16;
+    while (tableSize < KEYWORD_COUNT || !findAssoValues(tableSize)) {
+        tableSize *= 2;
+        if (tableSize > MAX_TABLE_SIZE) {
+            fprintf(stderr, "keyword_gen: no perfect hash found\n");
+            return 1;
+        }
+    }
+
+    size_t minLength = 255, maxLength = 0;
+    const KeywordSpec *table[MAX_TABLE_SIZE] = {0};
+    for (int i = 0; i < KEYWORD_COUNT; i++) {
+        size_t length = strlen(keywords[i].name);
+        if (length < minLength) minLength = length;
+        if (length > maxLength) maxLength = length;
+        table[hashKeyword(keywords[i].name, tableSize - 1)] = &keywords[i];
+    }
+
+    printf("/* Generated by utils/keyword_gen.c -- do not edit. */\n");
+    printf("#ifndef KEYWORDS_H\n#define KEYWORDS_H\n\n");
+    printf("#include <stddef.h>\n#include <string.h>\n#include \"tokens.h\"\n\n");
+    printf("#define KEYWORD_TABLE_SIZE %u\n", tableSize);
+    printf("#define KEYWORD_MIN_LENGTH %zu\n", minLength);
+    printf("#define KEYWORD_MAX_LENGTH %zu\n\n", maxLength);
+
+    printf("typedef struct {\n");
+    printf("    const char *name;\n");
+    printf("    unsigned char length;\n");
+    printf("    TokenType type;\n");
+    printf("} Keyword;\n\n");
+
+    printf("static const unsigned char keywordAsso[256] = {\n");
+    for (int i = 0; i < 256; i++) {
+        printf("%s%2u%s", i % 16 == 0 ? "    " : "", asso[i],
+               i == 255 ? "\n" : (i % 16 == 15 ? ",\n" : ", "));
+    }
+    printf("};\n\n");
+
+    printf("static const Keyword keywordTable[KEYWORD_TABLE_SIZE] = {\n");
+    for (unsigned int i = 0; i < tableSize; i++) {
+        if (table[i]) {
+            printf("    { \"%s\", %zu, %s },\n", table[i]->name, strlen(table[i]->name), table[i]->type);
+        } else {
+            printf("    { NULL, 0, UNKNOWN },\n");
+        }
+    }
+    printf("};\n\n");
+
+    printf("#ifdef KEYWORD_STRCMP_CHAIN\n");
+    printf("/**\n");
+    printf(" * @brief The strcmp chain the lexer used before the perfect hash, kept as\n");
+    printf(" *        the lexer_bench baseline. text must be NUL-terminated, as yytext is.\n");
+    printf(" *\n");
+    printf(" * @return The keyword entry, or NULL if the lexeme is not a keyword.\n");
+    printf(" */\n");
+    printf("static inline const Keyword *lookupKeyword(const char *text, int length) {\n");
+    printf("    (void)length;\n");
+    for (int i = 0; i < KEYWORD_COUNT; i++) {
+        unsigned int slot = hashKeyword(keywords[i].name, tableSize - 1);
+        printf("    if (strcmp(text, \"%s\") == 0) return &keywordTable[%u];\n", keywords[i].name, slot);
+    }
+    printf("    return NULL;\n");
+    printf("}\n");
+    printf("#else\n");
+    printf("/**\n");
+    printf(" * @brief Maps a lexeme to its keyword entry with one table probe and one memcmp.\n");
+    printf(" *\n");
+    printf(" * @return The keyword entry, or NULL if the lexeme is not a keyword.\n");
+    printf(" */\n");
+    printf("static inline const Keyword *lookupKeyword(const char *text, int length) {\n");
+    printf("    if (length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH) {\n");
+    printf("        return NULL;\n");
+    printf("    }\n");
+    printf("    unsigned int slot = ((unsigned int)length + keywordAsso[(unsigned char)text[0]] +\n");
+    printf("                         keywordAsso[(unsigned char)text[length - 1]]) & (KEYWORD_TABLE_SIZE - 1);\n");
+    printf("    const Keyword *keyword = &keywordTable[slot];\n");
+    printf("    if (keyword->length == length && memcmp(keyword->name, text, length) == 0) {\n");
+    printf("        return keyword;\n");
+    printf("    }\n");
+    printf("    return NULL;\n");
+    printf("}\n");
+    printf("#endif\n\n");
+    printf("#endif // KEYWORDS_H\n");
+    return 0;
+}
@@ -398,14 +398,15 @@ char *yytext;
 #include <string.h>
 #include "../components/tokens.h"
 #include "../components/symbol_table.h" 
-extern void addToken(TokenType type, const char* value);
-extern Token* head;
+#include "../components/keywords.h"
+#include "../components/log.h"
+extern void addToken(TokenType type, const char* text, int length);
 extern Token* current;
 
 #define yylex tokenizer
 
 int inVarDeclaration = 0;
-#line 409 "lex.yy.c"
+#line 410 "lex.yy.c"
 
 /* Macros after this point can all be overridden by user definitions in
  * section 1.
@@ -556,9 +557,9 @@ YY_DECL
 	register char *yy_cp, *yy_bp;
 	register int yy_act;
 
-#line 42 "lexer.l"
+#line 43 "lexer.l"
 
-#line 562 "lex.yy.c"
+#line 563 "lex.yy.c"
 
 	if ( yy_init )
 		{
@@ -643,152 +644,108 @@ do_action:	/* This label is used only to access EOF actions. */
 
 case 1:
 YY_RULE_SETUP
-#line 43 "lexer.l"
+#line 44 "lexer.l"
 { 
-                if (lookupSymbol(yytext) != -1) {
-                    printf("Error: Keyword '%s' is reserved and cannot be redefined\n", yytext);
-                    exit(1);
-                }
-                addToken(VAR, yytext); 
-                printf("TOKEN: KEYWORD, VALUE: %s\n", yytext); 
+                addToken(VAR, yytext, yyleng); 
+                LOG_TRACE(LOG_LEXER, "TOKEN: KEYWORD, VALUE: %s\n", yytext); 
             }  
 	YY_BREAK
 case 2:
 YY_RULE_SETUP
-#line 51 "lexer.l"
+#line 48 "lexer.l"
 {
-                char value[100];
-                strncpy(value, yytext + 1, strlen(yytext) - 2);
-                value[strlen(yytext) - 2] = '\0';
-                addToken(STRING_LITERAL, value);
-                printf("TOKEN: STRING_LITERAL, VALUE: %s\n", value);
+                addToken(STRING_LITERAL, yytext, yyleng);
+                LOG_TRACE(LOG_LEXER, "TOKEN: STRING_LITERAL, VALUE: %.*s\n", yyleng - 2, yytext + 1);
             }
 	YY_BREAK
 case 3:
 YY_RULE_SETUP
-#line 58 "lexer.l"
+#line 52 "lexer.l"
 {
-                if (strcmp(yytext, "num") == 0 || 
-                    strcmp(yytext, "log") == 0 || 
-                    strcmp(yytext, "str") == 0) {
-                    addToken(VAR, yytext);
-                    printf("TOKEN: KEYWORD, VALUE: %s\n", yytext);
-                }
-                else if (strcmp(yytext, "if") == 0) {
-                    addToken(IF, yytext);
-                    printf("TOKEN: IF, VALUE: %s\n", yytext);
-                }
-                else if (strcmp(yytext, "else") == 0) {
-                    addToken(ELSE, yytext);
-                    printf("TOKEN: ELSE, VALUE: %s\n", yytext);
-                }
-                else if (strcmp(yytext, "while") == 0) {
-                    addToken(WHILE, yytext);
-                    printf("TOKEN: WHILE, VALUE: %s\n", yytext);
-                }
-                else if (strcmp(yytext, "for") == 0) {
-                    addToken(FOR, yytext);
-                    printf("TOKEN: FOR, VALUE: %s\n", yytext);
-                }
-                else if (strcmp(yytext, "do") == 0) {
-                    addToken(DO, yytext);
-                    printf("TOKEN: DO, VALUE: %s\n", yytext);
-                }
-                else if (strcmp(yytext, "func") == 0) {
-                    addToken(FUNC, yytext);
-                    printf("TOKEN: FUNC, VALUE: %s\n", yytext);
-                }
-                else if (strcmp(yytext, "call") == 0) {
-                    addToken(CALL, yytext);
-                    printf("TOKEN: CALL, VALUE: %s\n", yytext);
-                }
-                else if (strcmp(yytext, "print") == 0) {
-                    addToken(PRINT, yytext);
-                    printf("TOKEN: PRINT, VALUE: %s\n", yytext);
-                }
-                else if (strcmp(yytext, "true") == 0 || strcmp(yytext, "false") == 0) {
-                    addToken(BOOLEAN_LITERAL, yytext);
-                    printf("TOKEN: BOOLEAN_LITERAL, VALUE: %s\n", yytext);
+                const Keyword *keyword = lookupKeyword(yytext, yyleng);
+                if (keyword) {
+                    addToken(keyword->type, yytext, yyleng);
+                    LOG_TRACE(LOG_LEXER, "TOKEN: %s, VALUE: %s\n", keyword->type == VAR ? "KEYWORD" : tokenTypeToString(keyword->type), yytext);
                 }
                 else {
-                    addToken(ID, yytext);
-                    printf("TOKEN: ID, VALUE: %s\n", yytext);
+                    addToken(ID, yytext, yyleng);
+                    LOG_TRACE(LOG_LEXER, "TOKEN: ID, VALUE: %s\n", yytext);
                 }
             }
 	YY_BREAK
 case 4:
 YY_RULE_SETUP
-#line 106 "lexer.l"
-{ addToken(NUMBER, yytext); printf("TOKEN: NUMBER, VALUE: %s\n", yytext); }  
+#line 63 "lexer.l"
+{ addToken(NUMBER, yytext, yyleng); LOG_TRACE(LOG_LEXER, "TOKEN: NUMBER, VALUE: %s\n", yytext); }  
 	YY_BREAK
 case 5:
 YY_RULE_SETUP
-#line 107 "lexer.l"
-{ addToken(ASSIGN, yytext); printf("TOKEN: ASSIGN, VALUE: %s\n", yytext); }  
+#line 64 "lexer.l"
+{ addToken(ASSIGN, yytext, yyleng); LOG_TRACE(LOG_LEXER, "TOKEN: ASSIGN, VALUE: %s\n", yytext); }  
 	YY_BREAK
 case 6:
 YY_RULE_SETUP
-#line 108 "lexer.l"
-{ addToken(OPERATOR, yytext); printf("TOKEN: OPERATOR, VALUE: %s\n", yytext); }  
+#line 65 "lexer.l"
+{ addToken(OPERATOR, yytext, yyleng); LOG_TRACE(LOG_LEXER, "TOKEN: OPERATOR, VALUE: %s\n", yytext); }  
 	YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 109 "lexer.l"
-{ addToken(SEMICOLON, yytext); printf("TOKEN: SEMICOLON, VALUE: %s\n", yytext); }  
+#line 66 "lexer.l"
+{ addToken(SEMICOLON, yytext, yyleng); LOG_TRACE(LOG_LEXER, "TOKEN: SEMICOLON, VALUE: %s\n", yytext); return 1; }  
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
-#line 110 "lexer.l"
-{ addToken(COMMA, yytext); printf("TOKEN: COMMA, VALUE: %s\n", yytext); }  
+#line 67 "lexer.l"
+{ addToken(COMMA, yytext, yyleng); LOG_TRACE(LOG_LEXER, "TOKEN: COMMA, VALUE: %s\n", yytext); }  
 	YY_BREAK
 case 9:
 YY_RULE_SETUP
-#line 112 "lexer.l"
-{ addToken(LBRACE, yytext); printf("TOKEN: LBRACE, VALUE: %s\n", yytext); }
+#line 69 "lexer.l"
+{ addToken(LBRACE, yytext, yyleng); LOG_TRACE(LOG_LEXER, "TOKEN: LBRACE, VALUE: %s\n", yytext); }
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 113 "lexer.l"
-{ addToken(RBRACE, yytext); printf("TOKEN: RBRACE, VALUE: %s\n", yytext); }
+#line 70 "lexer.l"
+{ addToken(RBRACE, yytext, yyleng); LOG_TRACE(LOG_LEXER, "TOKEN: RBRACE, VALUE: %s\n", yytext); return 1; }
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 114 "lexer.l"
-{ addToken(LPAREN, yytext); printf("TOKEN: LPAREN, VALUE: %s\n", yytext); }
+#line 71 "lexer.l"
+{ addToken(LPAREN, yytext, yyleng); LOG_TRACE(LOG_LEXER, "TOKEN: LPAREN, VALUE: %s\n", yytext); }
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 115 "lexer.l"
-{ addToken(RPAREN, yytext); printf("TOKEN: RPAREN, VALUE: %s\n", yytext); }
+#line 72 "lexer.l"
+{ addToken(RPAREN, yytext, yyleng); LOG_TRACE(LOG_LEXER, "TOKEN: RPAREN, VALUE: %s\n", yytext); }
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 117 "lexer.l"
-{ addToken(RELOP, yytext); printf("TOKEN: RELOP, VALUE: %s\n", yytext); }  
+#line 74 "lexer.l"
+{ addToken(RELOP, yytext, yyleng); LOG_TRACE(LOG_LEXER, "TOKEN: RELOP, VALUE: %s\n", yytext); }  
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 118 "lexer.l"
-{ addToken(AND, yytext); printf("TOKEN: AND, VALUE: %s\n", yytext); }  
+#line 75 "lexer.l"
+{ addToken(AND, yytext, yyleng); LOG_TRACE(LOG_LEXER, "TOKEN: AND, VALUE: %s\n", yytext); }  
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 119 "lexer.l"
-{ addToken(OR, yytext); printf("TOKEN: OR, VALUE: %s\n", yytext); }  
+#line 76 "lexer.l"
+{ addToken(OR, yytext, yyleng); LOG_TRACE(LOG_LEXER, "TOKEN: OR, VALUE: %s\n", yytext); }  
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 120 "lexer.l"
-{ printf("Skipping comment: %s\n", yytext); }  
+#line 77 "lexer.l"
+{ LOG_TRACE(LOG_LEXER, "Skipping comment: %s\n", yytext); }  
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 122 "lexer.l"
+#line 79 "lexer.l"
 { /* Do nothing */ }  
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 123 "lexer.l"
+#line 80 "lexer.l"
 { 
     printf("ERROR: Unrecognized character '%s'\n", yytext); 
     exit(0); 
@@ -796,10 +753,10 @@ YY_RULE_SETUP
 	YY_BREAK
 case 19:
 YY_RULE_SETUP
-#line 128 "lexer.l"
+#line 85 "lexer.l"
 ECHO;
 	YY_BREAK
-#line 803 "lex.yy.c"
+#line 760 "lex.yy.c"
 case YY_STATE_EOF(INITIAL):
 	yyterminate();
 
@@ -1685,7 +1642,42 @@ int main()
 	return 0;
 	}
 #endif
-#line 128 "lexer.l"
+#line 85 "lexer.l"
 
 
 int yywrap() { return 1; }
+
+// The source buffer being scanned, between beginSourceScan() and the end
+// of the source
+static YY_BUFFER_STATE sourceBuffer = NULL;
+
+/**
+ * @brief Starts scanning an in-memory source buffer without copying it.
+ *
+ * The buffer must be followed by two NUL bytes, as produced by loadSource().
+ * Flex reads straight from it instead of refilling through yyin.
+ *
+ * @return 1 if the scan started, 0 if the buffer lacked the NUL padding.
+ */
+int beginSourceScan(char *base, size_t length) {
+    sourceBuffer = yy_scan_buffer(base, (yy_size_t)(length + 2));
+    return sourceBuffer != NULL;
+}
+
+/**
+ * @brief Scans tokens up to and including the next ';' or '}'.
+ *
+ * @return 1 if the scan stopped there, 0 once the end of the source is
+ *         reached.
+ */
+int scanSourceStatement() {
+    if (!sourceBuffer) {
+        return 0;
+    }
+    if (tokenizer()) {
+        return 1;
+    }
+    yy_delete_buffer(sourceBuffer);
+    sourceBuffer = NULL;
+    return 0;
+}